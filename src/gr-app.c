@@ -33,6 +33,7 @@
 #include "gr-shell-search-provider.h"
 #include "gr-utils.h"
 #include "gr-logging.h"
+#include "gr-cache-index.h"
 
 
 struct _GrApp
@@ -383,6 +384,17 @@ gr_app_startup (GApplication *application)
         load_application_css (application);
 }
 
+static void
+gr_app_shutdown (GApplication *application)
+{
+        g_autoptr(GError) error = NULL;
+
+        if (!gr_cache_index_save (gr_cache_index_get_default (), &error))
+                g_warning ("Failed to save cache index: %s", error->message);
+
+        G_APPLICATION_CLASS (gr_app_parent_class)->shutdown (application);
+}
+
 static void
 gr_app_open (GApplication  *application,
              GFile        **files,
@@ -505,6 +517,7 @@ gr_app_class_init (GrAppClass *klass)
         object_class->finalize = gr_app_finalize;
 
         application_class->startup = gr_app_startup;
+        application_class->shutdown = gr_app_shutdown;
         application_class->activate = gr_app_activate;
         application_class->handle_local_options = gr_app_handle_local_options;
         application_class->open = gr_app_open;
@@ -0,0 +1,498 @@
+/* gr-cache-index.c:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "gr-cache-index.h"
+#include "gr-utils.h"
+
+/* Cache index
+ * -----------
+ *
+ * We used to find out whether a downloaded file needs to be fetched
+ * again by looking at its modification time, and recorded failed
+ * downloads as small files containing "failed". Opening a page full
+ * of recipes did a stat for every image and thumbnail.
+ *
+ * Now all we know about downloaded files is kept in one index: the
+ * URL, the validators the server sent, when it was fetched, its size
+ * and whether the download failed. The index is a serialized GVariant
+ * of type (ua(ssmsmsxtb)), with
+ *  - a format version
+ *  - an array of entries, sorted by key
+ *
+ * The file is mmapped, and lookups do a binary search in it. Changes
+ * are kept in a hash table, and merged into a new file a little while
+ * after the last change.
+ *
+ * Images are decoded in threads, so all access is under a lock.
+ */
+
+#define INDEX_VERSION 1
+#define INDEX_RECORD_TYPE "(ssmsmsxtb)"
+#define INDEX_TYPE "(ua" INDEX_RECORD_TYPE ")"
+
+#define SAVE_TIMEOUT 10
+
+struct _GrCacheIndex
+{
+        GMutex lock;
+
+        char *path;
+        GVariant *records;      /* mmapped, sorted by key */
+        GHashTable *changes;    /* key -> GrCacheEntry, or NULL if removed */
+
+        guint save_timeout;
+};
+
+GrCacheEntry *
+gr_cache_entry_copy (const GrCacheEntry *entry)
+{
+        GrCacheEntry *copy;
+
+        copy = g_new0 (GrCacheEntry, 1);
+        copy->url = g_strdup (entry->url);
+        copy->etag = g_strdup (entry->etag);
+        copy->last_modified = g_strdup (entry->last_modified);
+        copy->fetched = entry->fetched;
+        copy->size = entry->size;
+        copy->failed = entry->failed;
+
+        return copy;
+}
+
+void
+gr_cache_entry_free (GrCacheEntry *entry)
+{
+        g_free (entry->url);
+        g_free (entry->etag);
+        g_free (entry->last_modified);
+        g_free (entry);
+}
+
+static GVariant *
+map_index (const char *path)
+{
+        g_autoptr(GMappedFile) mapped = NULL;
+        g_autoptr(GBytes) bytes = NULL;
+        g_autoptr(GVariant) index = NULL;
+        g_autoptr(GError) error = NULL;
+        guint32 version;
+
+        mapped = g_mapped_file_new (path, FALSE, &error);
+        if (!mapped) {
+                if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+                        g_debug ("Failed to map cache index %s: %s", path, error->message);
+                return NULL;
+        }
+
+        bytes = g_mapped_file_get_bytes (mapped);
+        index = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (INDEX_TYPE), bytes, FALSE));
+
+        g_variant_get_child (index, 0, "u", &version);
+        if (version != INDEX_VERSION) {
+                g_debug ("Cache index %s has unknown version %u", path, version);
+                return NULL;
+        }
+
+        return g_variant_get_child_value (index, 1);
+}
+
+/**
+ * gr_cache_index_new:
+ * @path: the file to keep the index in
+ *
+ * Creates a cache index that is backed by @path. If @path
+ * exists, it is mmapped.
+ *
+ * Returns: (transfer full): a new #GrCacheIndex
+ */
+GrCacheIndex *
+gr_cache_index_new (const char *path)
+{
+        GrCacheIndex *index;
+
+        index = g_new0 (GrCacheIndex, 1);
+        g_mutex_init (&index->lock);
+        index->path = g_strdup (path);
+        index->records = map_index (path);
+        index->changes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, (GDestroyNotify)gr_cache_entry_free);
+
+        return index;
+}
+
+void
+gr_cache_index_free (GrCacheIndex *index)
+{
+        if (index->save_timeout) {
+                g_source_remove (index->save_timeout);
+                index->save_timeout = 0;
+        }
+
+        g_free (index->path);
+        g_clear_pointer (&index->records, g_variant_unref);
+        g_hash_table_unref (index->changes);
+        g_mutex_clear (&index->lock);
+        g_free (index);
+}
+
+/**
+ * gr_cache_index_get_default:
+ *
+ * Returns the index for the files in the user cache directory.
+ *
+ * Returns: (transfer none): the default #GrCacheIndex
+ */
+GrCacheIndex *
+gr_cache_index_get_default (void)
+{
+        static GrCacheIndex *index;
+
+        if (g_once_init_enter (&index)) {
+                g_autofree char *path = NULL;
+
+                path = g_build_filename (get_user_cache_dir (), "cache.index", NULL);
+                g_once_init_leave (&index, gr_cache_index_new (path));
+        }
+
+        return index;
+}
+
+static void
+entry_from_record (GVariant     *record,
+                   GrCacheEntry *entry)
+{
+        g_variant_get (record, INDEX_RECORD_TYPE,
+                       NULL,
+                       &entry->url,
+                       &entry->etag,
+                       &entry->last_modified,
+                       &entry->fetched,
+                       &entry->size,
+                       &entry->failed);
+}
+
+static GVariant *
+find_record (GVariant   *records,
+             const char *key)
+{
+        gsize lo, hi;
+
+        if (records == NULL)
+                return NULL;
+
+        lo = 0;
+        hi = g_variant_n_children (records);
+        while (lo < hi) {
+                gsize mid = lo + (hi - lo) / 2;
+                g_autoptr(GVariant) record = NULL;
+                const char *k;
+                int cmp;
+
+                record = g_variant_get_child_value (records, mid);
+                g_variant_get_child (record, 0, "&s", &k);
+
+                cmp = strcmp (key, k);
+                if (cmp == 0)
+                        return g_steal_pointer (&record);
+                else if (cmp < 0)
+                        hi = mid;
+                else
+                        lo = mid + 1;
+        }
+
+        return NULL;
+}
+
+/**
+ * gr_cache_index_lookup:
+ * @index: a #GrCacheIndex
+ * @key: the path of a cached file
+ *
+ * Returns what is known about the cached file at @key.
+ *
+ * Returns: (transfer full) (nullable): the entry for @key, or %NULL
+ */
+GrCacheEntry *
+gr_cache_index_lookup (GrCacheIndex *index,
+                       const char   *key)
+{
+        GrCacheEntry *entry = NULL;
+        GrCacheEntry *changed;
+        g_autoptr(GVariant) record = NULL;
+
+        g_mutex_lock (&index->lock);
+
+        if (g_hash_table_lookup_extended (index->changes, key, NULL, (gpointer *)&changed)) {
+                if (changed)
+                        entry = gr_cache_entry_copy (changed);
+        }
+        else {
+                record = find_record (index->records, key);
+                if (record) {
+                        entry = g_new0 (GrCacheEntry, 1);
+                        entry_from_record (record, entry);
+                }
+        }
+
+        g_mutex_unlock (&index->lock);
+
+        return entry;
+}
+
+static gboolean
+save_timeout (gpointer data)
+{
+        GrCacheIndex *index = data;
+        g_autoptr(GError) error = NULL;
+
+        index->save_timeout = 0;
+
+        if (!gr_cache_index_save (index, &error))
+                g_warning ("Failed to save cache index: %s", error->message);
+
+        return G_SOURCE_REMOVE;
+}
+
+/* Changes are only made on the main thread */
+static void
+schedule_save (GrCacheIndex *index)
+{
+        if (index->save_timeout == 0)
+                index->save_timeout = g_timeout_add_seconds (SAVE_TIMEOUT, save_timeout, index);
+}
+
+void
+gr_cache_index_update (GrCacheIndex       *index,
+                       const char         *key,
+                       const GrCacheEntry *entry)
+{
+        g_mutex_lock (&index->lock);
+        g_hash_table_insert (index->changes, g_strdup (key), gr_cache_entry_copy (entry));
+        g_mutex_unlock (&index->lock);
+
+        schedule_save (index);
+}
+
+void
+gr_cache_index_remove (GrCacheIndex *index,
+                       const char   *key)
+{
+        g_mutex_lock (&index->lock);
+        g_hash_table_insert (index->changes, g_strdup (key), NULL);
+        g_mutex_unlock (&index->lock);
+
+        schedule_save (index);
+}
+
+static GVariant *
+record_from_entry (const char         *key,
+                   const GrCacheEntry *entry)
+{
+        return g_variant_new (INDEX_RECORD_TYPE,
+                              key,
+                              entry->url ? entry->url : "",
+                              entry->etag,
+                              entry->last_modified,
+                              entry->fetched,
+                              entry->size,
+                              entry->failed);
+}
+
+static int
+compare_keys (gconstpointer a,
+              gconstpointer b)
+{
+        return strcmp (*(const char **)a, *(const char **)b);
+}
+
+/**
+ * gr_cache_index_save:
+ * @index: a #GrCacheIndex
+ * @error: return location for an error
+ *
+ * Merges the changes into the index file, and maps the new file.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+gr_cache_index_save (GrCacheIndex  *index,
+                     GError       **error)
+{
+        g_autoptr(GHashTable) records = NULL;
+        g_autoptr(GPtrArray) keys = NULL;
+        g_autoptr(GVariant) data = NULL;
+        GVariantBuilder builder;
+        GHashTableIter iter;
+        const char *key;
+        GrCacheEntry *entry;
+        gboolean result = TRUE;
+        guint i;
+
+        if (index->save_timeout) {
+                g_source_remove (index->save_timeout);
+                index->save_timeout = 0;
+        }
+
+        g_mutex_lock (&index->lock);
+
+        if (g_hash_table_size (index->changes) == 0)
+                goto out;
+
+        /* key -> record, pointing into the old index or the changes */
+        records = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_variant_unref);
+
+        if (index->records) {
+                gsize n = g_variant_n_children (index->records);
+
+                for (i = 0; i < n; i++) {
+                        GVariant *record;
+
+                        record = g_variant_get_child_value (index->records, i);
+                        g_variant_get_child (record, 0, "&s", &key);
+                        g_hash_table_insert (records, (gpointer)key, record);
+                }
+        }
+
+        g_hash_table_iter_init (&iter, index->changes);
+        while (g_hash_table_iter_next (&iter, (gpointer *)&key, (gpointer *)&entry)) {
+                if (entry)
+                        g_hash_table_insert (records, (gpointer)key,
+                                             g_variant_ref_sink (record_from_entry (key, entry)));
+                else
+                        g_hash_table_remove (records, key);
+        }
+
+        keys = g_ptr_array_new ();
+        g_hash_table_iter_init (&iter, records);
+        while (g_hash_table_iter_next (&iter, (gpointer *)&key, NULL))
+                g_ptr_array_add (keys, (gpointer)key);
+        g_ptr_array_sort (keys, compare_keys);
+
+        g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" INDEX_RECORD_TYPE));
+        for (i = 0; i < keys->len; i++)
+                g_variant_builder_add_value (&builder, g_hash_table_lookup (records, g_ptr_array_index (keys, i)));
+
+        data = g_variant_ref_sink (g_variant_new ("(u@a" INDEX_RECORD_TYPE ")",
+                                                  INDEX_VERSION,
+                                                  g_variant_builder_end (&builder)));
+
+        g_info ("Writing cache index %s with %u entries", index->path, keys->len);
+        if (!g_file_set_contents (index->path,
+                                  g_variant_get_data (data),
+                                  g_variant_get_size (data),
+                                  error)) {
+                result = FALSE;
+                goto out;
+        }
+
+        /* The records we wrote may point into the old mapping, so drop them first */
+        g_clear_pointer (&records, g_hash_table_unref);
+        g_clear_pointer (&index->records, g_variant_unref);
+        index->records = map_index (index->path);
+        g_hash_table_remove_all (index->changes);
+
+out:
+        g_mutex_unlock (&index->lock);
+
+        return result;
+}
+
+/**
+ * gr_cache_index_add_validators:
+ * @index: a #GrCacheIndex
+ * @key: the path of a cached file
+ * @headers: the request headers of a message that fetches @key
+ *
+ * Adds If-None-Match and If-Modified-Since headers, so that the
+ * server can tell us that our cached copy of @key is still good.
+ */
+void
+gr_cache_index_add_validators (GrCacheIndex       *index,
+                               const char         *key,
+                               SoupMessageHeaders *headers)
+{
+        g_autoptr(GrCacheEntry) entry = NULL;
+
+        entry = gr_cache_index_lookup (index, key);
+        if (entry == NULL || entry->failed)
+                return;
+
+        if (entry->etag)
+                soup_message_headers_append (headers, "If-None-Match", entry->etag);
+
+        if (entry->last_modified)
+                soup_message_headers_append (headers, "If-Modified-Since", entry->last_modified);
+        else if (entry->etag == NULL) {
+                SoupDate *date;
+                g_autofree char *mod_date = NULL;
+
+                date = soup_date_new_from_time_t ((time_t) entry->fetched);
+                mod_date = soup_date_to_string (date, SOUP_DATE_HTTP);
+                soup_message_headers_append (headers, "If-Modified-Since", mod_date);
+                soup_date_free (date);
+        }
+}
+
+/**
+ * gr_cache_index_update_from_message:
+ * @index: a #GrCacheIndex
+ * @key: the path of a cached file
+ * @url: the URL that @key was fetched from
+ * @msg: the finished message
+ *
+ * Records the outcome of fetching @key. For successful downloads,
+ * the caller is expected to have saved the response body at @key.
+ */
+void
+gr_cache_index_update_from_message (GrCacheIndex *index,
+                                    const char   *key,
+                                    const char   *url,
+                                    SoupMessage  *msg)
+{
+        g_autoptr(GrCacheEntry) old = NULL;
+        GrCacheEntry entry = { 0, };
+
+        entry.url = (char *)url;
+        entry.fetched = g_get_real_time () / G_USEC_PER_SEC;
+
+        if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+                old = gr_cache_index_lookup (index, key);
+                if (old) {
+                        entry.etag = old->etag;
+                        entry.last_modified = old->last_modified;
+                        entry.size = old->size;
+                }
+        }
+        else if (msg->status_code == SOUP_STATUS_OK) {
+                entry.etag = (char *)soup_message_headers_get_one (msg->response_headers, "ETag");
+                entry.last_modified = (char *)soup_message_headers_get_one (msg->response_headers, "Last-Modified");
+                entry.size = msg->response_body->length;
+        }
+        else {
+                entry.failed = TRUE;
+        }
+
+        gr_cache_index_update (index, key, &entry);
+}
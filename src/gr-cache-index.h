@@ -0,0 +1,68 @@
+/* gr-cache-index.h:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+        char     *url;
+        char     *etag;
+        char     *last_modified;
+        gint64    fetched;
+        guint64   size;
+        gboolean  failed;
+} GrCacheEntry;
+
+GrCacheEntry *gr_cache_entry_copy (const GrCacheEntry *entry);
+void          gr_cache_entry_free (GrCacheEntry       *entry);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrCacheEntry, gr_cache_entry_free)
+
+typedef struct _GrCacheIndex GrCacheIndex;
+
+GrCacheIndex *gr_cache_index_new                 (const char          *path);
+void          gr_cache_index_free                (GrCacheIndex        *index);
+GrCacheIndex *gr_cache_index_get_default         (void);
+
+GrCacheEntry *gr_cache_index_lookup              (GrCacheIndex        *index,
+                                                  const char          *key);
+void          gr_cache_index_update              (GrCacheIndex        *index,
+                                                  const char          *key,
+                                                  const GrCacheEntry  *entry);
+void          gr_cache_index_remove              (GrCacheIndex        *index,
+                                                  const char          *key);
+gboolean      gr_cache_index_save                (GrCacheIndex        *index,
+                                                  GError             **error);
+
+void          gr_cache_index_add_validators      (GrCacheIndex        *index,
+                                                  const char          *key,
+                                                  SoupMessageHeaders  *headers);
+void          gr_cache_index_update_from_message (GrCacheIndex        *index,
+                                                  const char          *key,
+                                                  const char          *url,
+                                                  SoupMessage         *msg);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrCacheIndex, gr_cache_index_free)
+
+G_END_DECLS
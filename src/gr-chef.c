@@ -36,6 +36,7 @@ struct _GrChef
         char *id;
         char *name;
         char *fullname;
+        char *cf_fullname;
         char *description;
         char *image_path;
 
@@ -65,6 +66,7 @@ gr_chef_finalize (GObject *object)
         g_free (self->id);
         g_free (self->name);
         g_free (self->fullname);
+        g_free (self->cf_fullname);
         g_free (self->description);
         g_free (self->image_path);
         g_free (self->translated_description);
@@ -131,7 +133,10 @@ gr_chef_set_property (GObject      *object,
 
         case PROP_FULLNAME:
                 g_free (self->fullname);
+                g_clear_pointer (&self->cf_fullname, g_free);
                 self->fullname = g_value_dup_string (value);
+                if (self->fullname)
+                        self->cf_fullname = g_utf8_casefold (self->fullname, -1);
                 break;
 
         case PROP_DESCRIPTION:
@@ -232,6 +237,13 @@ gr_chef_get_fullname (GrChef *chef)
         return chef->fullname;
 }
 
+/* The casefolded full name, for matching search terms against */
+const char *
+gr_chef_get_cf_fullname (GrChef *chef)
+{
+        return chef->cf_fullname;
+}
+
 const char *
 gr_chef_get_description (GrChef *chef)
 {
@@ -32,6 +32,7 @@ GrChef          *gr_chef_new             (void);
 const char      *gr_chef_get_id          (GrChef *chef);
 const char      *gr_chef_get_name        (GrChef *chef);
 const char      *gr_chef_get_fullname    (GrChef *chef);
+const char      *gr_chef_get_cf_fullname (GrChef *chef);
 const char      *gr_chef_get_description (GrChef *chef);
 const char      *gr_chef_get_image       (GrChef *chef);
 gboolean         gr_chef_is_readonly     (GrChef *chef);
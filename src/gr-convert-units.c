@@ -317,6 +317,59 @@ gr_convert_weight (double *amount, GrUnit *unit, GrPreferredUnit user_weight_uni
          *unit = unit1;
 }
 
+/* Amounts are added up in one base unit per dimension: millilitres
+ * for volumes and grams for weights. The imperial factors are derived
+ * from the teaspoon and the ounce, so that imperial amounts convert
+ * back without picking up rounding errors.
+ */
+#define TEASPOON_ML 4.92892
+#define OUNCE_G     28.3495
+
+static const struct {
+        GrUnit base;
+        double factor;
+} base_units[GR_LAST_UNIT + 1] = {
+        [GR_UNIT_MILLILITER]  = { GR_UNIT_MILLILITER, 1 },
+        [GR_UNIT_DECILITER]   = { GR_UNIT_MILLILITER, 100 },
+        [GR_UNIT_LITER]       = { GR_UNIT_MILLILITER, 1000 },
+        [GR_UNIT_TEASPOON]    = { GR_UNIT_MILLILITER, TEASPOON_ML },
+        [GR_UNIT_TABLESPOON]  = { GR_UNIT_MILLILITER, 3 * TEASPOON_ML },
+        [GR_UNIT_FLUID_OUNCE] = { GR_UNIT_MILLILITER, 6 * TEASPOON_ML },
+        [GR_UNIT_CUP]         = { GR_UNIT_MILLILITER, 48 * TEASPOON_ML },
+        [GR_UNIT_PINT]        = { GR_UNIT_MILLILITER, 96 * TEASPOON_ML },
+        [GR_UNIT_QUART]       = { GR_UNIT_MILLILITER, 192 * TEASPOON_ML },
+        [GR_UNIT_GALLON]      = { GR_UNIT_MILLILITER, 768 * TEASPOON_ML },
+        [GR_UNIT_GRAM]        = { GR_UNIT_GRAM, 1 },
+        [GR_UNIT_KILOGRAM]    = { GR_UNIT_GRAM, 1000 },
+        [GR_UNIT_OUNCE]       = { GR_UNIT_GRAM, OUNCE_G },
+        [GR_UNIT_POUND]       = { GR_UNIT_GRAM, 16 * OUNCE_G },
+        [GR_UNIT_STONE]       = { GR_UNIT_GRAM, 224 * OUNCE_G },
+};
+
+/**
+ * gr_convert_get_base_unit:
+ * @unit: a #GrUnit
+ * @factor: (out): return location for the conversion factor
+ *
+ * Returns the unit that amounts in @unit are added up in, and the
+ * factor to multiply them with. Units that can't be converted are
+ * their own base unit, with a factor of 1.
+ *
+ * Returns: the base unit for @unit
+ */
+GrUnit
+gr_convert_get_base_unit (GrUnit  unit,
+                          double *factor)
+{
+        if (unit <= GR_LAST_UNIT && base_units[unit].factor != 0) {
+                *factor = base_units[unit].factor;
+                return base_units[unit].base;
+        }
+
+        *factor = 1;
+        return unit;
+}
+
 void
 gr_convert_human_readable (double *amount, GrUnit *unit)
 {
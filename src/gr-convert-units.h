@@ -46,6 +46,7 @@ GrPreferredUnit     gr_convert_get_weight_unit          (void);
 void                gr_convert_temp                     (int *num, int *unit, int user_unit);
 void                gr_convert_volume                   (double *amount, GrUnit *unit, GrPreferredUnit user_volume_unit);
 void                gr_convert_weight                   (double *amount, GrUnit *unit, GrPreferredUnit user_weight_unit);
+GrUnit              gr_convert_get_base_unit            (GrUnit unit, double *factor);
 void                gr_convert_human_readable           (double *amount, GrUnit *unit);
 void                gr_convert_multiple_units           (double *amount1, GrUnit *unit1, double *amount2, GrUnit *unit2);
 void                gr_convert_format_for_display       (GString *s, double a1, GrUnit u1, double a2, GrUnit u2);
@@ -60,6 +60,8 @@ struct _GrCuisinePage
         int n_categories;
         Category *categories;
         Category *other;
+
+        GHashTable *tiles;      /* GrRecipe -> GtkFlowBoxChild */
 };
 
 G_DEFINE_TYPE (GrCuisinePage, gr_cuisine_page, GTK_TYPE_BOX)
@@ -114,6 +116,7 @@ cuisine_page_finalize (GObject *object)
 
         g_clear_pointer (&self->cuisine, g_free);
         g_clear_pointer (&self->categories, g_free);
+        g_hash_table_unref (self->tiles);
 
         G_OBJECT_CLASS (gr_cuisine_page_parent_class)->finalize (object);
 }
@@ -250,6 +253,8 @@ gr_cuisine_page_init (GrCuisinePage *page)
         gtk_widget_set_has_window (GTK_WIDGET (page), FALSE);
         gtk_widget_init_template (GTK_WIDGET (page));
 
+        page->tiles = g_hash_table_new (NULL, NULL);
+
         populate_initially (page);
         connect_store_signals (page);
 
@@ -285,6 +290,80 @@ gr_cuisine_page_new (void)
         return GTK_WIDGET (page);
 }
 
+static Category *
+find_category (GrCuisinePage *self,
+               GrRecipe      *recipe)
+{
+        const char *category;
+        int i;
+
+        category = gr_recipe_get_category (recipe);
+        for (i = 0; i < self->n_categories; i++) {
+                if (g_strcmp0 (self->categories[i].name, category) == 0)
+                        return &self->categories[i];
+        }
+
+        return self->other;
+}
+
+static void
+add_tile (GrCuisinePage *self,
+          GrRecipe      *recipe)
+{
+        GtkWidget *tile;
+        Category *c;
+
+        c = find_category (self, recipe);
+
+        gtk_widget_show (c->label);
+        gtk_widget_show (c->box);
+        c->filled = TRUE;
+
+        tile = gr_recipe_tile_new (recipe);
+        gtk_widget_show (tile);
+        gtk_container_add (GTK_CONTAINER (c->box), tile);
+
+        g_hash_table_insert (self->tiles, recipe, gtk_widget_get_parent (tile));
+}
+
+static void
+remove_tile (GrCuisinePage *self,
+             GrRecipe      *recipe)
+{
+        GtkWidget *item;
+        GtkWidget *box;
+        g_autoptr(GList) children = NULL;
+        int i;
+
+        item = g_hash_table_lookup (self->tiles, recipe);
+        if (!item)
+                return;
+
+        g_hash_table_remove (self->tiles, recipe);
+
+        box = gtk_widget_get_parent (item);
+        gtk_container_remove (GTK_CONTAINER (box), item);
+
+        children = gtk_container_get_children (GTK_CONTAINER (box));
+        if (children)
+                return;
+
+        for (i = 0; i < self->n_categories; i++) {
+                if (self->categories[i].box == box) {
+                        gtk_widget_hide (self->categories[i].label);
+                        gtk_widget_hide (self->categories[i].box);
+                        self->categories[i].filled = FALSE;
+                        break;
+                }
+        }
+}
+
+static gboolean
+has_recipes (GrCuisinePage *self)
+{
+        return g_hash_table_size (self->tiles) > 0;
+}
+
 void
 gr_cuisine_page_set_cuisine (GrCuisinePage *self,
                              const char    *cuisine)
@@ -293,7 +372,6 @@ gr_cuisine_page_set_cuisine (GrCuisinePage *self,
         g_autofree char **keys = NULL;
         guint length;
         int i, j;
-        gboolean has_recipe = FALSE;
         const char *description;
         GtkAdjustment *adj;
 
@@ -306,6 +384,7 @@ gr_cuisine_page_set_cuisine (GrCuisinePage *self,
         gtk_label_set_label (GTK_LABEL (self->cuisine_label), description);
         gtk_widget_set_visible (self->cuisine_label, description != NULL);
 
+        g_hash_table_remove_all (self->tiles);
         for (i = 0; i < self->n_categories; i++) {
                 container_remove_all (GTK_CONTAINER (self->categories[i].box));
                 gtk_widget_hide (self->categories[i].label);
@@ -318,38 +397,16 @@ gr_cuisine_page_set_cuisine (GrCuisinePage *self,
         keys = gr_recipe_store_get_recipe_keys (store, &length);
         for (j = 0; j < length; j++) {
                 g_autoptr(GrRecipe) recipe = NULL;
-                const char *cuisine2;
-                const char *category;
-                GtkWidget *tile;
-                Category *c;
 
                 recipe = gr_recipe_store_get_recipe (store, keys[j]);
-                cuisine2 = gr_recipe_get_cuisine (recipe);
-                category = gr_recipe_get_category (recipe);
 
-                if (g_strcmp0 (cuisine, cuisine2) != 0)
+                if (g_strcmp0 (cuisine, gr_recipe_get_cuisine (recipe)) != 0)
                         continue;
 
-                c = self->other;
-                for (i = 0; i < self->n_categories; i++) {
-                        if (strcmp (self->categories[i].name, category) == 0) {
-                                c = &self->categories[i];
-                                break;
-                        }
-                }
-
-                gtk_widget_show (c->label);
-                gtk_widget_show (c->box);
-                c->filled = TRUE;
-
-                tile = gr_recipe_tile_new (recipe);
-                gtk_widget_show (tile);
-                gtk_container_add (GTK_CONTAINER (c->box), tile);
-
-                has_recipe = TRUE;
+                add_tile (self, recipe);
         }
 
-        gtk_stack_set_visible_child_name (GTK_STACK (self->stack), has_recipe ? "cuisine" : "empty");
+        gtk_stack_set_visible_child_name (GTK_STACK (self->stack), has_recipes (self) ? "cuisine" : "empty");
 
         gtk_list_box_invalidate_filter (GTK_LIST_BOX (self->sidebar));
 
@@ -366,10 +423,62 @@ gr_cuisine_page_set_cuisine (GrCuisinePage *self,
         }
 }
 
+/* Applies a change to a single recipe to the page, so that changes
+ * to recipes of other cuisines cost nothing.
+ */
+static void
+recipe_changed (GrCuisinePage *page,
+                GrRecipe      *recipe)
+{
+        GtkWidget *item;
+        gboolean matches;
+
+        if (!gtk_widget_is_drawable (GTK_WIDGET (page)))
+                return;
+
+        item = g_hash_table_lookup (page->tiles, recipe);
+        matches = page->cuisine && g_strcmp0 (page->cuisine, gr_recipe_get_cuisine (recipe)) == 0;
+
+        if (!item && !matches)
+                return;
+
+        if (item && (!matches || gtk_widget_get_parent (item) != find_category (page, recipe)->box)) {
+                remove_tile (page, recipe);
+                item = NULL;
+        }
+
+        if (item) {
+                gr_recipe_tile_update (GR_RECIPE_TILE (gtk_bin_get_child (GTK_BIN (item))));
+                gtk_flow_box_child_changed (GTK_FLOW_BOX_CHILD (item));
+        }
+        else if (matches) {
+                add_tile (page, recipe);
+        }
+
+        gtk_stack_set_visible_child_name (GTK_STACK (page->stack), has_recipes (page) ? "cuisine" : "empty");
+        gtk_list_box_invalidate_filter (GTK_LIST_BOX (page->sidebar));
+}
+
+static void
+recipe_removed (GrCuisinePage *page,
+                GrRecipe      *recipe)
+{
+        if (!gtk_widget_is_drawable (GTK_WIDGET (page)))
+                return;
+
+        if (!g_hash_table_contains (page->tiles, recipe))
+                return;
+
+        remove_tile (page, recipe);
+
+        gtk_stack_set_visible_child_name (GTK_STACK (page->stack), has_recipes (page) ? "cuisine" : "empty");
+        gtk_list_box_invalidate_filter (GTK_LIST_BOX (page->sidebar));
+}
+
 static void
-cuisine_page_reload (GrCuisinePage *page)
+recipes_reloaded (GrCuisinePage *page)
 {
-        if (gtk_widget_is_drawable (GTK_WIDGET (page)))
+        if (gtk_widget_is_drawable (GTK_WIDGET (page)) && page->cuisine)
                 gr_cuisine_page_set_cuisine (page, page->cuisine);
 }
 
@@ -380,7 +489,8 @@ connect_store_signals (GrCuisinePage *page)
 
         store = gr_recipe_store_get ();
 
-        g_signal_connect_swapped (store, "recipe-added", G_CALLBACK (cuisine_page_reload), page);
-        g_signal_connect_swapped (store, "recipe-removed", G_CALLBACK (cuisine_page_reload), page);
-        g_signal_connect_swapped (store, "recipe-changed", G_CALLBACK (cuisine_page_reload), page);
+        g_signal_connect_swapped (store, "recipe-added", G_CALLBACK (recipe_changed), page);
+        g_signal_connect_swapped (store, "recipe-removed", G_CALLBACK (recipe_removed), page);
+        g_signal_connect_swapped (store, "recipe-changed", G_CALLBACK (recipe_changed), page);
+        g_signal_connect_swapped (store, "reloaded", G_CALLBACK (recipes_reloaded), page);
 }
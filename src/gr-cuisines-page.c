@@ -256,19 +256,28 @@ populate_seasonal (GrCuisinesPage *self)
         GtkWidget *tile;
         const char * const *names;
         int length;
+        GrRecipeStore *store;
+        int tiles;
 
         container_remove_all (GTK_CONTAINER (self->seasonal_box));
         container_remove_all (GTK_CONTAINER (self->seasonal_box2));
 
+        store = gr_recipe_store_get ();
+
         names = gr_season_get_names (&length);
+        tiles = 0;
         for (i = 0; i < length; i++) {
+                if (!gr_recipe_store_has_season (store, names[i]))
+                        continue;
+
                 tile = gr_category_tile_new_with_label (names[i], gr_season_get_title (names[i]));
                 gtk_widget_show (tile);
                 g_signal_connect (tile, "clicked", G_CALLBACK (seasonal_clicked), self);
-                if (i < 3)
+                if (tiles < 3)
                         gtk_container_add (GTK_CONTAINER (self->seasonal_box), tile);
                 else
                         gtk_container_add (GTK_CONTAINER (self->seasonal_box2), tile);
+                tiles++;
         }
 }
 
@@ -325,10 +334,14 @@ gr_cuisines_page_refresh (GrCuisinesPage *page)
 }
 
 static void
-cuisines_page_reload (GrCuisinesPage *page)
+overview_changed (GrCuisinesPage   *page,
+                  GrOverviewChange  change)
 {
-        if (gtk_widget_is_drawable (GTK_WIDGET (page)))
-                gr_cuisines_page_refresh (page);
+        if (change & GR_OVERVIEW_CUISINES)
+                populate_cuisines (page);
+
+        if (change & GR_OVERVIEW_SEASONS)
+                populate_seasonal (page);
 }
 
 static void
@@ -338,8 +351,6 @@ connect_store_signals (GrCuisinesPage *page)
 
         store = gr_recipe_store_get ();
 
-        g_signal_connect_swapped (store, "recipe-added", G_CALLBACK (cuisines_page_reload), page);
-        g_signal_connect_swapped (store, "recipe-removed", G_CALLBACK (cuisines_page_reload), page);
-        g_signal_connect_swapped (store, "recipe-changed", G_CALLBACK (cuisines_page_reload), page);
+        g_signal_connect_swapped (store, "overview-changed", G_CALLBACK (overview_changed), page);
         g_signal_connect_swapped (store, "reloaded", G_CALLBACK (gr_cuisines_page_refresh), page);
 }
@@ -53,7 +53,6 @@ struct _GrDetailsPage
         GrRecipe *recipe;
         GrChef *chef;
         GrIngredientsList *ingredients;
-        char *ing_text;
 
         GrRecipePrinter *printer;
         GrRecipeExporter *exporter;
@@ -281,7 +280,6 @@ details_page_finalize (GObject *object)
         g_clear_object (&self->ingredients);
         g_clear_object (&self->printer);
         g_clear_object (&self->exporter);
-        g_clear_pointer (&self->ing_text, g_free);
 
         G_OBJECT_CLASS (gr_details_page_parent_class)->finalize (object);
 }
@@ -501,7 +499,7 @@ populate_ingredients (GrDetailsPage *page,
                                      "editable-title", FALSE,
                                      "editable", FALSE,
                                      "scale", scale,
-                                     "ingredients", page->ing_text,
+                                     "ingredients-list", page->ingredients,
                                      NULL);
                 gtk_container_add (GTK_CONTAINER (page->ingredients_box), list);
         }
@@ -611,7 +609,6 @@ gr_details_page_set_recipe (GrDetailsPage *page,
         const char *meal;
         const char *season;
         double yield;
-        const char *ingredients;
         const char *instructions;
         const char *notes;
         const char *description;
@@ -634,7 +631,6 @@ gr_details_page_set_recipe (GrDetailsPage *page,
         cuisine = gr_recipe_get_cuisine (recipe);
         meal = gr_recipe_get_category (recipe);
         season = gr_recipe_get_season (recipe);
-        ingredients = gr_recipe_get_ingredients (recipe);
         notes = gr_recipe_get_translated_notes (recipe);
         instructions = gr_recipe_get_translated_instructions (recipe);
         description = gr_recipe_get_translated_description (recipe);
@@ -643,10 +639,8 @@ gr_details_page_set_recipe (GrDetailsPage *page,
         images = gr_recipe_get_images (recipe);
         gr_image_viewer_set_images (GR_IMAGE_VIEWER (page->recipe_image), images, index);
 
-        ing = gr_ingredients_list_new (ingredients);
+        ing = g_object_ref (gr_recipe_get_ingredients_list (recipe));
         g_set_object (&page->ingredients, ing);
-        g_free (page->ing_text);
-        page->ing_text = g_strdup (ingredients);
 
         populate_ingredients (page, 1.0);
 
@@ -431,11 +431,17 @@ gr_gourmet_format_import (GFile   *file,
 
         context = g_markup_parse_context_new (&parser, G_MARKUP_TREAT_CDATA_AS_TEXT, &data, NULL);
 
+        /* All recipes of the file are added, or none */
+        gr_recipe_store_begin_batch (data.store);
+
         if (!g_markup_parse_context_parse (context, contents, length, error)) {
+                gr_recipe_store_abort_batch (data.store);
                 parser_data_clear (&data);
                 return NULL;
         }
 
+        gr_recipe_store_commit_batch (data.store);
+
         recipes = data.recipes;
         data.recipes = NULL;
         parser_data_clear (&data);
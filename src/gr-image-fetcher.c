@@ -0,0 +1,356 @@
+/* gr-image-fetcher.c:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+
+#include "gr-image-fetcher.h"
+#include "gr-pixbuf-cache.h"
+#include "gr-cache-index.h"
+
+/* Image downloads
+ * ---------------
+ *
+ * Recipe and chef tiles each create their own GrImage, so the same
+ * image is often asked for by several of them at once. All downloads
+ * go through one fetcher per session, which keeps one request per
+ * URL and tells everybody who asked for it when it is done.
+ *
+ * Only a few requests are sent at a time. Thumbnails are sent before
+ * full-size images, and within each priority the most recent request
+ * goes first, since that is what was just scrolled into view. Requests
+ * whose callers have all been cancelled by the time their turn comes
+ * are dropped without being sent.
+ *
+ * The fetcher writes the downloaded image to the cache path and
+ * records the outcome in the cache index before calling back.
+ */
+
+#define DEFAULT_MAX_IN_FLIGHT 6
+
+typedef struct {
+        GCancellable *cancellable;
+        GrImageFetchCallback callback;
+        gpointer data;
+} Waiter;
+
+typedef struct {
+        GrImageFetcher *fetcher;
+        char *url;
+        char *cache_path;
+        GrFetchPriority priority;
+        GList *waiters;
+        SoupMessage *message;
+} Fetch;
+
+struct _GrImageFetcher
+{
+        SoupSession *session;
+        GrCacheIndex *index;
+        guint max_in_flight;
+        guint in_flight;
+
+        GHashTable *fetches;    /* url -> Fetch */
+        GQueue queued[GR_FETCH_PRIORITY_LOW + 1];
+};
+
+static void
+waiter_free (gpointer data)
+{
+        Waiter *waiter = data;
+
+        g_clear_object (&waiter->cancellable);
+        g_free (waiter);
+}
+
+static void
+fetch_free (gpointer data)
+{
+        Fetch *fetch = data;
+
+        g_free (fetch->url);
+        g_free (fetch->cache_path);
+        g_list_free_full (fetch->waiters, waiter_free);
+        g_clear_object (&fetch->message);
+        g_free (fetch);
+}
+
+GrImageFetcher *
+gr_image_fetcher_new (SoupSession  *session,
+                      GrCacheIndex *index,
+                      guint         max_in_flight)
+{
+        GrImageFetcher *fetcher;
+        int i;
+
+        fetcher = g_new0 (GrImageFetcher, 1);
+        fetcher->session = g_object_ref (session);
+        fetcher->index = index;
+        fetcher->max_in_flight = max_in_flight;
+        fetcher->fetches = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, fetch_free);
+        for (i = 0; i <= GR_FETCH_PRIORITY_LOW; i++)
+                g_queue_init (&fetcher->queued[i]);
+
+        return fetcher;
+}
+
+void
+gr_image_fetcher_free (GrImageFetcher *fetcher)
+{
+        int i;
+
+        /* Requests in flight keep a pointer to their Fetch */
+        g_return_if_fail (fetcher->in_flight == 0);
+
+        for (i = 0; i <= GR_FETCH_PRIORITY_LOW; i++)
+                g_queue_clear (&fetcher->queued[i]);
+        g_hash_table_unref (fetcher->fetches);
+        g_object_unref (fetcher->session);
+        g_free (fetcher);
+}
+
+/**
+ * gr_image_fetcher_get_for_session:
+ * @session: a #SoupSession
+ *
+ * Returns the fetcher that handles the image downloads for @session,
+ * creating it if necessary.
+ *
+ * Returns: (transfer none): the #GrImageFetcher for @session
+ */
+GrImageFetcher *
+gr_image_fetcher_get_for_session (SoupSession *session)
+{
+        GrImageFetcher *fetcher;
+
+        fetcher = g_object_get_data (G_OBJECT (session), "gr-image-fetcher");
+        if (fetcher == NULL) {
+                fetcher = gr_image_fetcher_new (session,
+                                                gr_cache_index_get_default (),
+                                                DEFAULT_MAX_IN_FLIGHT);
+                /* The fetcher lives as long as the session, so it is never freed */
+                g_object_set_data (G_OBJECT (session), "gr-image-fetcher", fetcher);
+        }
+
+        return fetcher;
+}
+
+guint
+gr_image_fetcher_get_in_flight (GrImageFetcher *fetcher)
+{
+        return fetcher->in_flight;
+}
+
+static gboolean
+has_waiters (Fetch *fetch)
+{
+        GList *l;
+
+        for (l = fetch->waiters; l; l = l->next) {
+                Waiter *waiter = l->data;
+
+                if (!g_cancellable_is_cancelled (waiter->cancellable))
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
+static void dispatch (GrImageFetcher *fetcher);
+
+static gboolean
+save_response (Fetch       *fetch,
+               SoupMessage *msg)
+{
+        GrCacheIndex *index = fetch->fetcher->index;
+        const char *cache_path = fetch->cache_path;
+
+        if (msg->status_code == SOUP_STATUS_CANCELLED) {
+                g_debug ("Download of %s cancelled", fetch->url);
+                return FALSE;
+        }
+
+        if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+                g_debug ("Image not modified");
+                gr_cache_index_update_from_message (index, cache_path, fetch->url, msg);
+                return TRUE;
+        }
+
+        if (msg->status_code == SOUP_STATUS_OK) {
+                g_autofree char *dir = NULL;
+
+                dir = g_path_get_dirname (cache_path);
+                g_mkdir_with_parents (dir, 0755);
+
+                g_debug ("Saving image to %s", cache_path);
+                if (!g_file_set_contents (cache_path, msg->response_body->data, msg->response_body->length, NULL)) {
+                        g_debug ("Saving image to %s failed", cache_path);
+                        gr_cache_index_remove (index, cache_path);
+                        return FALSE;
+                }
+
+                /* Only now, or a decode in a thread could put the old image back */
+                gr_pixbuf_cache_invalidate (gr_pixbuf_cache_get_default (), cache_path);
+                gr_cache_index_update_from_message (index, cache_path, fetch->url, msg);
+                return TRUE;
+        }
+
+        g_debug ("Got status %d, record failure to load %s", msg->status_code, fetch->url);
+        g_remove (cache_path);
+        gr_pixbuf_cache_invalidate (gr_pixbuf_cache_get_default (), cache_path);
+        gr_cache_index_update_from_message (index, cache_path, fetch->url, msg);
+
+        return FALSE;
+}
+
+static void
+fetch_done (SoupSession *session,
+            SoupMessage *msg,
+            gpointer     data)
+{
+        Fetch *fetch = data;
+        GrImageFetcher *fetcher = fetch->fetcher;
+        gboolean success;
+        GList *waiters, *l;
+
+        success = save_response (fetch, msg);
+
+        fetcher->in_flight--;
+
+        /* Callers may ask for the same URL again from their callback */
+        waiters = g_steal_pointer (&fetch->waiters);
+        g_hash_table_remove (fetcher->fetches, fetch->url);
+
+        for (l = g_list_last (waiters); l; l = l->prev) {
+                Waiter *waiter = l->data;
+
+                if (!g_cancellable_is_cancelled (waiter->cancellable))
+                        waiter->callback (success, waiter->data);
+        }
+        g_list_free_full (waiters, waiter_free);
+
+        dispatch (fetcher);
+}
+
+static Fetch *
+next_fetch (GrImageFetcher *fetcher)
+{
+        int i;
+
+        for (i = 0; i <= GR_FETCH_PRIORITY_LOW; i++) {
+                Fetch *fetch;
+
+                while ((fetch = g_queue_pop_head (&fetcher->queued[i])) != NULL) {
+                        if (has_waiters (fetch))
+                                return fetch;
+
+                        g_debug ("Dropping download of %s, nobody wants it anymore", fetch->url);
+                        g_hash_table_remove (fetcher->fetches, fetch->url);
+                }
+        }
+
+        return NULL;
+}
+
+static void
+dispatch (GrImageFetcher *fetcher)
+{
+        while (fetcher->in_flight < fetcher->max_in_flight) {
+                Fetch *fetch;
+                g_autoptr(SoupURI) uri = NULL;
+
+                fetch = next_fetch (fetcher);
+                if (fetch == NULL)
+                        break;
+
+                uri = soup_uri_new (fetch->url);
+                fetch->message = soup_message_new_from_uri (SOUP_METHOD_GET, uri);
+                gr_cache_index_add_validators (fetcher->index, fetch->cache_path,
+                                               fetch->message->request_headers);
+
+                g_debug ("Downloading %s", fetch->url);
+                fetcher->in_flight++;
+                soup_session_queue_message (fetcher->session, g_object_ref (fetch->message), fetch_done, fetch);
+        }
+}
+
+/**
+ * gr_image_fetcher_fetch:
+ * @fetcher: a #GrImageFetcher
+ * @url: the URL to download
+ * @cache_path: the file to save the download in
+ * @priority: how urgently the image is needed
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: function to call when the download is done
+ * @data: data to pass to @callback
+ *
+ * Downloads @url to @cache_path, asking the server to only send it
+ * if it changed since we last fetched it. If @url is already being downloaded,
+ * no new request is made, and @callback is called when the existing
+ * request is done.
+ *
+ * @callback is called with %TRUE if @cache_path holds the image, and
+ * it is not called at all if @cancellable is cancelled first.
+ */
+void
+gr_image_fetcher_fetch (GrImageFetcher       *fetcher,
+                        const char           *url,
+                        const char           *cache_path,
+                        GrFetchPriority       priority,
+                        GCancellable         *cancellable,
+                        GrImageFetchCallback  callback,
+                        gpointer              data)
+{
+        Fetch *fetch;
+        Waiter *waiter;
+
+        waiter = g_new0 (Waiter, 1);
+        waiter->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+        waiter->callback = callback;
+        waiter->data = data;
+
+        fetch = g_hash_table_lookup (fetcher->fetches, url);
+        if (fetch) {
+                g_debug ("Already downloading %s", url);
+                fetch->waiters = g_list_prepend (fetch->waiters, waiter);
+
+                /* Move the request forward if it is still queued */
+                if (fetch->message == NULL) {
+                        g_queue_remove (&fetcher->queued[fetch->priority], fetch);
+                        fetch->priority = MIN (fetch->priority, priority);
+                        g_queue_push_head (&fetcher->queued[fetch->priority], fetch);
+                }
+
+                return;
+        }
+
+        fetch = g_new0 (Fetch, 1);
+        fetch->fetcher = fetcher;
+        fetch->url = g_strdup (url);
+        fetch->cache_path = g_strdup (cache_path);
+        fetch->priority = priority;
+        fetch->waiters = g_list_prepend (NULL, waiter);
+
+        g_hash_table_insert (fetcher->fetches, fetch->url, fetch);
+        g_queue_push_head (&fetcher->queued[priority], fetch);
+
+        dispatch (fetcher);
+}
@@ -0,0 +1,57 @@
+/* gr-image-fetcher.h:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <libsoup/soup.h>
+#include "gr-cache-index.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+        GR_FETCH_PRIORITY_HIGH,
+        GR_FETCH_PRIORITY_LOW
+} GrFetchPriority;
+
+typedef struct _GrImageFetcher GrImageFetcher;
+
+typedef void (*GrImageFetchCallback) (gboolean success,
+                                      gpointer data);
+
+GrImageFetcher *gr_image_fetcher_new             (SoupSession          *session,
+                                                  GrCacheIndex         *index,
+                                                  guint                 max_in_flight);
+void            gr_image_fetcher_free            (GrImageFetcher       *fetcher);
+GrImageFetcher *gr_image_fetcher_get_for_session (SoupSession          *session);
+
+void            gr_image_fetcher_fetch           (GrImageFetcher       *fetcher,
+                                                  const char           *url,
+                                                  const char           *cache_path,
+                                                  GrFetchPriority       priority,
+                                                  GCancellable         *cancellable,
+                                                  GrImageFetchCallback  callback,
+                                                  gpointer              data);
+
+guint           gr_image_fetcher_get_in_flight   (GrImageFetcher       *fetcher);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrImageFetcher, gr_image_fetcher_free)
+
+G_END_DECLS
@@ -24,14 +24,28 @@
 
 #include "gr-image.h"
 #include "gr-utils.h"
+#include "gr-pixbuf-cache.h"
+#include "gr-image-fetcher.h"
+#include "gr-cache-index.h"
+#include "gr-settings.h"
 
 
+/* Each load that needs a download is a separate waiter for the fetcher.
+ * Its fetch cancellable is cancelled when the caller cancels the load,
+ * when the image goes away, or when the load has been answered, so the
+ * fetcher can drop downloads that nobody is waiting for anymore.
+ */
 typedef struct {
-        GtkImage *image;
+        GrImage *ri;
         int width;
         int height;
         gboolean fit;
+        int fetches;
         GCancellable *cancellable;
+        GCancellable *fetch_cancellable;
+        GCancellable *teardown;
+        gulong cancelled_id;
+        gulong teardown_id;
         GrImageCallback callback;
         gpointer data;
 } TaskData;
@@ -41,7 +55,14 @@ task_data_free (gpointer data)
 {
         TaskData *td = data;
 
+        g_cancellable_cancel (td->fetch_cancellable);
+        if (td->cancellable)
+                g_cancellable_disconnect (td->cancellable, td->cancelled_id);
+        g_cancellable_disconnect (td->teardown, td->teardown_id);
+
         g_clear_object (&td->cancellable);
+        g_clear_object (&td->fetch_cancellable);
+        g_clear_object (&td->teardown);
 
         g_free (td);
 }
@@ -53,8 +74,7 @@ struct _GrImage
         char *path;
 
         SoupSession *session;
-        SoupMessage *thumbnail_message;
-        SoupMessage *image_message;
+        GCancellable *cancellable;
         GList *pending;
 };
 
@@ -65,23 +85,16 @@ gr_image_finalize (GObject *object)
 {
         GrImage *ri = GR_IMAGE (object);
 
-        if (ri->thumbnail_message)
-                soup_session_cancel_message (ri->session,
-                                             ri->thumbnail_message,
-                                             SOUP_STATUS_CANCELLED);
-        g_clear_object (&ri->thumbnail_message);
-        if (ri->image_message)
-                soup_session_cancel_message (ri->session,
-                                             ri->image_message,
-                                             SOUP_STATUS_CANCELLED);
-        g_clear_object (&ri->image_message);
+        /* Downloads that other images are waiting for carry on */
+        g_cancellable_cancel (ri->cancellable);
+        g_list_free_full (ri->pending, task_data_free);
+        ri->pending = NULL;
+
+        g_clear_object (&ri->cancellable);
         g_clear_object (&ri->session);
         g_free (ri->path);
         g_free (ri->id);
 
-        g_list_free_full (ri->pending, task_data_free);
-        ri->pending = NULL;
-
         G_OBJECT_CLASS (gr_image_parent_class)->finalize (object);
 }
 
@@ -96,6 +109,7 @@ gr_image_class_init (GrImageClass *klass)
 static void
 gr_image_init (GrImage *image)
 {
+        image->cancellable = g_cancellable_new ();
 }
 
 GrImage *
@@ -141,19 +155,102 @@ gr_image_array_new (void)
         return g_ptr_array_new_with_free_func (g_object_unref);
 }
 
+static void
+update_cache_budget (GSettings     *settings,
+                     const char    *key,
+                     GrPixbufCache *cache)
+{
+        guint megabytes;
+
+        megabytes = g_settings_get_uint (settings, "image-cache-size");
+        gr_pixbuf_cache_set_budget (cache, (gsize) megabytes * 1024 * 1024);
+}
+
+/* Called on the main thread before any images are loaded */
+static void
+ensure_cache_budget (void)
+{
+        static gboolean initialized = FALSE;
+        GrPixbufCache *cache;
+        GSettings *settings;
+
+        if (initialized)
+                return;
+
+        cache = gr_pixbuf_cache_get_default ();
+        settings = gr_settings_get ();
+        update_cache_budget (settings, "image-cache-size", cache);
+        g_signal_connect (settings, "changed::image-cache-size",
+                          G_CALLBACK (update_cache_budget), cache);
+
+        initialized = TRUE;
+}
+
 static GdkPixbuf *
 load_pixbuf (const char *path,
              int         width,
              int         height,
              gboolean    fit)
 {
+        GrPixbufCache *cache;
+        GrPixbufCacheFlags flags;
         GdkPixbuf *pixbuf;
 
+        cache = gr_pixbuf_cache_get_default ();
+        flags = fit ? GR_PIXBUF_CACHE_FIT : 0;
+
+        pixbuf = gr_pixbuf_cache_lookup (cache, path, width, height, flags);
+        if (pixbuf)
+                return pixbuf;
+
         if (fit)
                 pixbuf = load_pixbuf_fit_size (path, width, height, FALSE);
         else
                 pixbuf = load_pixbuf_fill_size (path, width, height);
 
+        if (pixbuf)
+                gr_pixbuf_cache_insert (cache, path, width, height, flags, pixbuf);
+
+        return pixbuf;
+}
+
+/* Placeholder for an image that we don't have yet: the thumbnail,
+ * scaled up to the size of the image and blurred. The blur is not
+ * cheap, so the result is cached under the thumbnail path.
+ */
+static GdkPixbuf *
+load_blurred_thumbnail (const char *path,
+                        int         width,
+                        int         height,
+                        gboolean    fit)
+{
+        GrPixbufCache *cache;
+        GrPixbufCacheFlags flags;
+        g_autoptr(GdkPixbuf) thumbnail = NULL;
+        GdkPixbuf *pixbuf;
+        int w = 150, h = 150;
+
+        cache = gr_pixbuf_cache_get_default ();
+        flags = GR_PIXBUF_CACHE_BLURRED | (fit ? GR_PIXBUF_CACHE_FIT : 0);
+
+        pixbuf = gr_pixbuf_cache_lookup (cache, path, width, height, flags);
+        if (pixbuf)
+                return pixbuf;
+
+        if (width < height)
+                w = 150 * width / height;
+        else
+                h = 150 * height / width;
+
+        thumbnail = load_pixbuf (path, w, h, fit);
+        if (!thumbnail)
+                return NULL;
+
+        pixbuf = gdk_pixbuf_scale_simple (thumbnail, width, height, GDK_INTERP_BILINEAR);
+        pixbuf_blur (pixbuf, 5, 3);
+
+        gr_pixbuf_cache_insert (cache, path, width, height, flags, pixbuf);
+
         return pixbuf;
 }
 
@@ -180,16 +277,11 @@ get_thumbnail_url (GrImage *ri)
 static char *
 get_image_cache_path (GrImage *ri)
 {
-        char *filename;
-        g_autofree char *cache_dir = NULL;
         g_autofree char *basename = NULL;
 
+        /* The directory is created when the image is downloaded */
         basename = g_path_get_basename (ri->path);
-        filename = g_build_filename (get_user_cache_dir (), "images", ri->id,  basename, NULL);
-        cache_dir = g_path_get_dirname (filename);
-        g_mkdir_with_parents (cache_dir, 0755);
-
-        return filename;
+        return g_build_filename (get_user_cache_dir (), "images", ri->id,  basename, NULL);
 }
 
 char *
@@ -204,201 +296,345 @@ gr_image_get_cache_path (GrImage *ri)
 static char *
 get_thumbnail_cache_path (GrImage *ri)
 {
-        char *filename;
-        g_autofree char *cache_dir = NULL;
         g_autofree char *basename = NULL;
 
         basename = g_path_get_basename (ri->path);
-        filename = g_build_filename (get_user_cache_dir (), "thumbnails", ri->id, basename, NULL);
-        cache_dir = g_path_get_dirname (filename);
-        g_mkdir_with_parents (cache_dir, 0755);
-
-        return filename;
+        return g_build_filename (get_user_cache_dir (), "thumbnails", ri->id, basename, NULL);
 }
 
 static gboolean
-should_try_load (const char *path)
+should_try_load (const char *path,
+                 gboolean   *stale)
 {
-        g_autoptr(GFile) file = NULL;
-        g_autoptr(GFileInfo) info = NULL;
-        gboolean result = TRUE;
+        g_autoptr(GrCacheEntry) entry = NULL;
+        GTimeSpan age;
+        gboolean result;
 
-        // We create negative cache entries as almost empty files, and we
+        // We record failed downloads in the cache index, and we
         // limit our requests to once per day
         // And we want to retry cached images after 28 days, in case
         // they changed
 
-        file = g_file_new_for_path (path);
-        info = g_file_query_info (file,
-                                  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
-                                  G_FILE_ATTRIBUTE_TIME_MODIFIED,
-                                  G_FILE_QUERY_INFO_NONE,
-                                  NULL,
-                                  NULL);
-        if (info) {
-                goffset size;
-                GTimeVal tv;
-                g_autoptr(GDateTime) now = NULL;
-                g_autoptr(GDateTime) mtime = NULL;
-
-                size = g_file_info_get_size (info);
-                g_file_info_get_modification_time (info, &tv);
-
-                now = g_date_time_new_now_utc ();
-                mtime = g_date_time_new_from_timeval_utc (&tv);
-
-                if (size == 6) {
-                        result = g_date_time_difference (now, mtime) > G_TIME_SPAN_DAY;
-                }
-                else {
-                        result = g_date_time_difference (now, mtime) > 28 * G_TIME_SPAN_DAY;
-                }
-                g_debug ("Cached %s for %s is %s",
-                         size == 6 ? "failure" : "image",
-                         path,
-                         result ? "old, trying again" : "new enough");
+        entry = gr_cache_index_lookup (gr_cache_index_get_default (), path);
+        if (entry == NULL)
+                return TRUE;
+
+        // The file may have been deleted behind our back. Its validators
+        // would only get us a 304, so the entry has to go
+        if (!entry->failed && !g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+                g_debug ("Cached image for %s is gone, trying again", path);
+                *stale = TRUE;
+                return TRUE;
         }
 
+        age = (g_get_real_time () / G_USEC_PER_SEC - entry->fetched) * G_USEC_PER_SEC;
+
+        if (entry->failed)
+                result = age > G_TIME_SPAN_DAY;
+        else
+                result = age > 28 * G_TIME_SPAN_DAY;
+
+        g_debug ("Cached %s for %s is %s",
+                 entry->failed ? "failure" : "image",
+                 path,
+                 result ? "old, trying again" : "new enough");
+
         return result;
 }
 
 static void
-write_negative_cache_entry (const char *path)
+task_done (TaskData *td)
 {
-        if (!g_file_set_contents (path, "failed", 6, NULL))
-                g_warning ("Failed to write a negative cache entry for %s", path);
+        GrImage *ri = td->ri;
+
+        ri->pending = g_list_remove (ri->pending, td);
+        task_data_free (td);
 }
 
 static void
-update_image_timestamp (const char *path)
+thumbnail_fetched (gboolean success,
+                   gpointer data)
 {
-        g_autoptr(GFile) file = NULL;
-        g_autoptr(GDateTime) now = NULL;
-        guint64 mtime;
+        TaskData *td = data;
+        g_autofree char *cache_path = NULL;
+        g_autoptr(GdkPixbuf) pixbuf = NULL;
 
-        now = g_date_time_new_now_utc ();
-        mtime = (guint64)g_date_time_to_unix (now);
+        td->fetches--;
 
-        file = g_file_new_for_path (path);
-        g_file_set_attribute_uint64 (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime, 0, NULL, NULL);
-        g_debug ("updating timestamp for %s", path);
-}
+        if (success) {
+                cache_path = get_thumbnail_cache_path (td->ri);
+                g_debug ("Loading thumbnail for %s", td->ri->path);
 
-static void
-set_modified_request (SoupMessage *msg,
-                      const char  *path)
-{
-        g_autoptr(GFile) file = NULL;
-        g_autoptr(GFileInfo) info = NULL;
-
-        file = g_file_new_for_path (path);
-        info = g_file_query_info (file,
-                                  G_FILE_ATTRIBUTE_TIME_MODIFIED,
-                                  G_FILE_QUERY_INFO_NONE,
-                                  NULL,
-                                  NULL);
-        if (info) {
-                GTimeVal tv;
-                g_autoptr(GDateTime) mtime = NULL;
-                g_autofree char *mod_date = NULL;
-
-                g_file_info_get_modification_time (info, &tv);
-                mtime = g_date_time_new_from_timeval_utc (&tv);
-                mod_date = g_date_time_format (mtime, "%a, %d %b %Y %H:%M:%S %Z");
-                soup_message_headers_append (msg->request_headers, "If-Modified-Since", mod_date);
+                /* Big images get a blurred thumbnail until the real one arrives */
+                if (td->width > 150 || td->height > 150) {
+                        pixbuf = load_blurred_thumbnail (cache_path, td->width, td->height, td->fit);
+                        if (pixbuf)
+                                td->callback (td->ri, pixbuf, td->data);
+                }
+                else {
+                        pixbuf = load_pixbuf (cache_path, td->width, td->height, td->fit);
+                        td->callback (td->ri, pixbuf, td->data);
+                        td->fetches = 0;
+                }
         }
+
+        if (td->fetches == 0)
+                task_done (td);
 }
 
 static void
-set_image (SoupSession *session,
-           SoupMessage *msg,
-           gpointer     data)
+full_image_fetched (gboolean success,
+                    gpointer data)
 {
-        GrImage *ri = data;
+        TaskData *td = data;
         g_autofree char *cache_path = NULL;
-        GList *l;
+        g_autoptr(GdkPixbuf) pixbuf = NULL;
 
-        if (msg->status_code == SOUP_STATUS_CANCELLED || ri->session == NULL) {
-                g_debug ("Message cancelled");
-                return;
-        }
+        td->fetches--;
 
-        if (msg == ri->thumbnail_message)
-                cache_path = get_thumbnail_cache_path (ri);
-        else
-                cache_path = get_image_cache_path (ri);
+        if (success) {
+                cache_path = get_image_cache_path (td->ri);
+                g_debug ("Loading image for %s", td->ri->path);
 
-        if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
-                g_debug ("Image not modified");
-                update_image_timestamp (cache_path);
+                pixbuf = load_pixbuf (cache_path, td->width, td->height, td->fit);
+                td->callback (td->ri, pixbuf, td->data);
+                td->fetches = 0;
         }
-        else if (msg->status_code == SOUP_STATUS_OK) {
-                g_debug ("Saving image to %s", cache_path);
-                if (!g_file_set_contents (cache_path, msg->response_body->data, msg->response_body->length, NULL)) {
-                        g_debug ("Saving image to %s failed", cache_path);
-                        goto out;
+
+        if (td->fetches == 0)
+                task_done (td);
+}
+
+/* Decoding in the background
+ * --------------------------
+ *
+ * Decoding and scaling a JPEG takes long enough that doing it for a
+ * flow box full of tiles makes scrolling stutter, so we look for
+ * local and cached images in a thread. The paths are computed on the
+ * main thread, and the callback is delivered there as well, unless
+ * the load was cancelled in the meantime. Downloads are only started
+ * once we know what was found in the cache.
+ */
+
+typedef struct {
+        char *local_path;
+        char *image_cache_path;
+        char *thumbnail_cache_path;
+        int width;
+        int height;
+        gboolean fit;
+        gboolean do_thumbnail;
+        GrImageCallback callback;
+        gpointer data;
+
+        /* Results */
+        GdkPixbuf *pixbuf;
+        gboolean found_local;
+        gboolean need_image;
+        gboolean need_thumbnail;
+        gboolean image_stale;
+        gboolean thumbnail_stale;
+} LoadData;
+
+static void
+load_data_free (gpointer data)
+{
+        LoadData *ld = data;
+
+        g_free (ld->local_path);
+        g_free (ld->image_cache_path);
+        g_free (ld->thumbnail_cache_path);
+        g_clear_object (&ld->pixbuf);
+
+        g_free (ld);
+}
+
+static void
+decode_image (LoadData *ld)
+{
+        int width = ld->width;
+        int height = ld->height;
+        gboolean fit = ld->fit;
+
+        if (ld->local_path) {
+                ld->pixbuf = load_pixbuf (ld->local_path, width, height, fit);
+                if (ld->pixbuf) {
+                        g_debug ("Use local image for %s", ld->local_path);
+                        ld->found_local = TRUE;
+                        return;
                 }
         }
+
+        ld->need_thumbnail = ld->do_thumbnail && should_try_load (ld->thumbnail_cache_path, &ld->thumbnail_stale);
+        ld->need_image = should_try_load (ld->image_cache_path, &ld->image_stale);
+
+        /* A cached file that is there but doesn't load is no better
+         * than a missing one.
+         */
+        if (width <= 150 && height <= 150) {
+                ld->pixbuf = load_pixbuf (ld->thumbnail_cache_path, width, height, fit);
+                ld->need_image = FALSE;
+                if (!ld->pixbuf && ld->do_thumbnail &&
+                    g_file_test (ld->thumbnail_cache_path, G_FILE_TEST_IS_REGULAR))
+                        ld->need_thumbnail = ld->thumbnail_stale = TRUE;
+        }
         else {
-                g_autofree char *url = get_image_url (ri);
-                g_debug ("Got status %d, record failure to load %s", msg->status_code, url);
-                write_negative_cache_entry (cache_path);
-                goto out;
+                ld->pixbuf = load_pixbuf (ld->image_cache_path, width, height, fit);
+                if (!ld->pixbuf &&
+                    g_file_test (ld->image_cache_path, G_FILE_TEST_IS_REGULAR))
+                        ld->need_image = ld->image_stale = TRUE;
         }
 
-        g_debug ("Loading image for %s", ri->path);
+        if (ld->pixbuf) {
+                 g_debug ("Use cached %s for %s",
+                          width <= 150 && height <= 150 ? "thumbnail" : "image",
+                          ld->image_cache_path);
+        }
+        else if (ld->do_thumbnail) {
+                ld->pixbuf = load_blurred_thumbnail (ld->thumbnail_cache_path, width, height, fit);
+                if (ld->pixbuf) {
+                        g_debug ("Use cached blurred thumbnail for %s", ld->thumbnail_cache_path);
+                        ld->need_image = TRUE;
+                }
+        }
+}
+
+static void
+cancel_fetch (GCancellable *cancellable,
+              GCancellable *fetch_cancellable)
+{
+        g_cancellable_cancel (fetch_cancellable);
+}
 
+static void
+start_downloads (GrImage      *ri,
+                 LoadData     *ld,
+                 GCancellable *cancellable)
+{
+        GrImageFetcher *fetcher;
+        TaskData *td;
+        GList *l;
+        gboolean need_image = ld->need_image;
+        gboolean need_thumbnail = ld->need_thumbnail;
+
+        if (!need_thumbnail && !need_image)
+                return;
+
+        /* Fetch stale files without validators. The index is only
+         * changed on the main thread, which is why decode_image()
+         * leaves this to us.
+         */
+        if (ld->thumbnail_stale)
+                gr_cache_index_remove (gr_cache_index_get_default (), ld->thumbnail_cache_path);
+        if (ld->image_stale)
+                gr_cache_index_remove (gr_cache_index_get_default (), ld->image_cache_path);
+
+        /* Loads that were cancelled are never called back */
         l = ri->pending;
         while (l) {
                 GList *next = l->next;
-                TaskData *td = l->data;
-                g_autoptr(GdkPixbuf) pixbuf = NULL;
-
-                if (g_cancellable_is_cancelled (td->cancellable)) {
-                        ri->pending = g_list_remove (ri->pending, td);
-                        task_data_free (td);
-                }
-                else if (msg == ri->thumbnail_message &&
-                    (td->width > 150 || td->height > 150)) {
-                        g_autoptr(GdkPixbuf) tmp = NULL;
-                        int w, h;
-
-                        if (td->width < td->height) {
-                                h = 150;
-                                w = 150 * td->width / td->height;
-                        }
-                        else {
-                                w = 150;
-                                h = 150 * td->height / td->width;
-                        }
-
-                        tmp = load_pixbuf (cache_path, w, h, td->fit);
-                        pixbuf = gdk_pixbuf_scale_simple (tmp, td->width, td->height, GDK_INTERP_BILINEAR);
-                        pixbuf_blur (pixbuf, 5, 3);
-                        td->callback (ri, pixbuf, td->data);
-                }
-                else {
-                        pixbuf = load_pixbuf (cache_path, td->width, td->height, td->fit);
-                        td->callback (ri, pixbuf, td->data);
 
-                        ri->pending = g_list_remove (ri->pending, td);
+                td = l->data;
+                if (g_cancellable_is_cancelled (td->fetch_cancellable)) {
+                        ri->pending = g_list_delete_link (ri->pending, l);
                         task_data_free (td);
                 }
 
                 l = next;
         }
 
-out:
-        if (msg == ri->thumbnail_message)
-                g_clear_object (&ri->thumbnail_message);
-        else
-                g_clear_object (&ri->image_message);
+        td = g_new0 (TaskData, 1);
+        td->ri = ri;
+        td->width = ld->width;
+        td->height = ld->height;
+        td->fit = ld->fit;
+        td->callback = ld->callback;
+        td->data = ld->data;
+        td->fetch_cancellable = g_cancellable_new ();
+        td->teardown = g_object_ref (ri->cancellable);
+        td->teardown_id = g_cancellable_connect (td->teardown, G_CALLBACK (cancel_fetch),
+                                                 g_object_ref (td->fetch_cancellable),
+                                                 g_object_unref);
+        if (cancellable) {
+                td->cancellable = g_object_ref (cancellable);
+                td->cancelled_id = g_cancellable_connect (cancellable, G_CALLBACK (cancel_fetch),
+                                                          g_object_ref (td->fetch_cancellable),
+                                                          g_object_unref);
+        }
+
+        ri->pending = g_list_prepend (ri->pending, td);
+
+        fetcher = gr_image_fetcher_get_for_session (ri->session);
+
+        /* The fetcher makes one request per URL, however many loads wait for it */
+        if (need_thumbnail) {
+                g_autofree char *url = NULL;
+
+                url = get_thumbnail_url (ri);
+                g_debug ("Load thumbnail for %s from %s", ri->path, url);
+                td->fetches++;
+                gr_image_fetcher_fetch (fetcher, url, ld->thumbnail_cache_path,
+                                        GR_FETCH_PRIORITY_HIGH, td->fetch_cancellable,
+                                        thumbnail_fetched, td);
+                if (ld->width > 150 || ld->height > 150)
+                        need_image = TRUE;
+        }
+
+        if (need_image) {
+                g_autofree char *url = NULL;
 
-        if (ri->thumbnail_message || ri->image_message)
+                url = get_image_url (ri);
+                g_debug ("Load image for %s from %s", ri->path, url);
+                td->fetches++;
+                gr_image_fetcher_fetch (fetcher, url, ld->image_cache_path,
+                                        GR_FETCH_PRIORITY_LOW, td->fetch_cancellable,
+                                        full_image_fetched, td);
+        }
+}
+
+static void
+finish_load (GrImage      *ri,
+             LoadData     *ld,
+             GCancellable *cancellable)
+{
+        if (ld->pixbuf)
+                ld->callback (ri, ld->pixbuf, ld->data);
+
+        if (ld->found_local)
                 return;
 
-        g_list_free_full (ri->pending, task_data_free);
-        ri->pending = NULL;
+        start_downloads (ri, ld, cancellable);
+}
+
+static void
+decode_thread (GTask        *task,
+               gpointer      source_object,
+               gpointer      task_data,
+               GCancellable *cancellable)
+{
+        LoadData *ld = task_data;
+
+        if (!g_task_return_error_if_cancelled (task)) {
+                decode_image (ld);
+                g_task_return_boolean (task, TRUE);
+        }
+}
+
+static void
+decode_done (GObject      *source,
+             GAsyncResult *result,
+             gpointer      data)
+{
+        GrImage *ri = GR_IMAGE (source);
+        GTask *task = G_TASK (result);
+
+        /* The task checks the cancellable, so callers that cancelled
+         * their load don't get called back.
+         */
+        if (!g_task_propagate_boolean (task, NULL))
+                return;
+
+        finish_load (ri, g_task_get_task_data (task), g_task_get_cancellable (task));
 }
 
 static void
@@ -407,17 +643,12 @@ gr_image_load_full (GrImage         *ri,
                     int              height,
                     gboolean         fit,
                     gboolean         do_thumbnail,
+                    gboolean         in_thread,
                     GCancellable    *cancellable,
                     GrImageCallback  callback,
                     gpointer         data)
 {
-        TaskData *td;
-        g_autofree char *image_cache_path = NULL;
-        g_autofree char *thumbnail_cache_path = NULL;
-        g_autoptr(GdkPixbuf) pixbuf = NULL;
-        gboolean need_image;
-        gboolean need_thumbnail;
-        g_autofree char *local_path = NULL;
+        LoadData *ld;
 
         /* We store images in local recipes with an absolute path nowadays.
          * We used to store them as a relative path starting with images/,
@@ -428,97 +659,35 @@ gr_image_load_full (GrImage         *ri,
                 return;
         }
 
+        ensure_cache_budget ();
+
+        ld = g_new0 (LoadData, 1);
+        ld->width = width;
+        ld->height = height;
+        ld->fit = fit;
+        ld->do_thumbnail = do_thumbnail;
+        ld->callback = callback;
+        ld->data = data;
+
         if (ri->path[0] == '/')
-                local_path = g_strdup (ri->path);
+                ld->local_path = g_strdup (ri->path);
         else if (g_str_has_prefix (ri->path, "images/"))
-                local_path = g_build_filename (get_user_data_dir (), ri->path, NULL);
-
-        if (local_path) {
-                pixbuf = load_pixbuf (local_path, width, height, fit);
-                if (pixbuf) {
-                        g_debug ("Use local image for %s", ri->path);
-                        callback (ri, pixbuf, data);
-                        return;
-                }
-        }
+                ld->local_path = g_build_filename (get_user_data_dir (), ri->path, NULL);
 
-        image_cache_path = get_image_cache_path (ri);
-        thumbnail_cache_path = get_thumbnail_cache_path (ri);
+        ld->image_cache_path = get_image_cache_path (ri);
+        ld->thumbnail_cache_path = get_thumbnail_cache_path (ri);
 
-        need_thumbnail = do_thumbnail && should_try_load (thumbnail_cache_path);
-        need_image = should_try_load (image_cache_path);
+        if (in_thread) {
+                g_autoptr(GTask) task = NULL;
 
-        if (width <= 150 && height <= 150) {
-                pixbuf = load_pixbuf (thumbnail_cache_path, width, height, fit);
-                need_image = FALSE;
+                task = g_task_new (ri, cancellable, decode_done, NULL);
+                g_task_set_task_data (task, ld, load_data_free);
+                g_task_run_in_thread (task, decode_thread);
         }
         else {
-                pixbuf = load_pixbuf (image_cache_path, width, height, fit);
-        }
-
-        if (pixbuf) {
-                 g_debug ("Use cached %s for %s",
-                          width <= 150 && height <= 150 ? "thumbnail" : "image",
-                          ri->path);
-                callback (ri, pixbuf, data);
-        }
-        else if (do_thumbnail) {
-                int w = 150, h = 150;
-
-                if (width < height)
-                        w = 150 * width / height;
-                else
-                        h = 150 * height / width;
-
-                pixbuf = load_pixbuf (thumbnail_cache_path, w, h, fit);
-                if (pixbuf) {
-                        g_autoptr(GdkPixbuf) blurred = NULL;
-
-                        g_debug ("Use cached blurred thumbnail for %s", ri->path);
-                        blurred = gdk_pixbuf_scale_simple (pixbuf, width, height, GDK_INTERP_BILINEAR);
-                        pixbuf_blur (blurred, 5, 3);
-                        callback (ri, blurred, data);
-                        need_image = TRUE;
-                }
-        }
-
-        if (!need_thumbnail && !need_image)
-                return;
-
-        td = g_new0 (TaskData, 1);
-        td->width = width;
-        td->height = height;
-        td->fit = fit;
-        td->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
-        td->callback = callback;
-        td->data = data;
-
-        ri->pending = g_list_prepend (ri->pending, td);
-
-        if (need_thumbnail && ri->thumbnail_message == NULL) {
-                g_autofree char *url = NULL;
-                g_autoptr(SoupURI) base_uri = NULL;
-
-                url = get_thumbnail_url (ri);
-                base_uri = soup_uri_new (url);
-                ri->thumbnail_message = soup_message_new_from_uri (SOUP_METHOD_GET, base_uri);
-                set_modified_request (ri->thumbnail_message, thumbnail_cache_path);
-                g_debug ("Load thumbnail for %s from %s", ri->path, url);
-                soup_session_queue_message (ri->session, g_object_ref (ri->thumbnail_message), set_image, ri);
-                if (width > 150 || height > 150)
-                        need_image = TRUE;
-        }
-
-        if (need_image && ri->image_message == NULL) {
-                g_autofree char *url = NULL;
-                g_autoptr(SoupURI) base_uri = NULL;
-
-                url = get_image_url (ri);
-                base_uri = soup_uri_new (url);
-                ri->image_message = soup_message_new_from_uri (SOUP_METHOD_GET, base_uri);
-                set_modified_request (ri->image_message, image_cache_path);
-                g_debug ("Load image for %s from %s", ri->path, url);
-                soup_session_queue_message (ri->session, g_object_ref (ri->image_message), set_image, ri);
+                decode_image (ld);
+                finish_load (ri, ld, cancellable);
+                load_data_free (ld);
         }
 }
 
@@ -531,7 +700,7 @@ gr_image_load (GrImage         *ri,
                GrImageCallback  callback,
                gpointer         data)
 {
-        gr_image_load_full (ri, width, height, fit, TRUE, cancellable, callback, data);
+        gr_image_load_full (ri, width, height, fit, TRUE, TRUE, cancellable, callback, data);
 }
 
 void
@@ -569,7 +738,7 @@ gr_image_load_sync (GrImage   *ri,
         data.pixbuf = NULL;
         data.loop = g_main_loop_new (NULL, FALSE);
 
-        gr_image_load_full (ri, width, height, fit, FALSE, NULL, set_pixbuf, &data);
+        gr_image_load_full (ri, width, height, fit, FALSE, FALSE, NULL, set_pixbuf, &data);
         if (data.pixbuf == NULL)
                 g_main_loop_run (data.loop);
         g_main_loop_unref (data.loop);
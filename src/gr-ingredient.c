@@ -41,6 +41,23 @@ static char **names;
 static char **cf_names;
 static char **cf_en_names;
 
+/* Both casefolded forms of each name map to the position of the
+ * name plus one, and the translated names map to it as well, so
+ * lookups don't have to go through the whole list.
+ */
+static GHashTable *cf_index;
+static GHashTable *name_index;
+
+static void
+add_to_index (GHashTable *index,
+              const char *key,
+              int         pos)
+{
+        /* Keep the first entry, like a search from the start would */
+        if (!g_hash_table_contains (index, key))
+                g_hash_table_insert (index, (gpointer)key, GINT_TO_POINTER (pos + 1));
+}
+
 static void
 translate_names (void)
 {
@@ -52,14 +69,33 @@ translate_names (void)
         names = g_new0 (char *, G_N_ELEMENTS (names_));
         cf_names = g_new0 (char *, G_N_ELEMENTS (names_));
         cf_en_names = g_new0 (char *, G_N_ELEMENTS (names_));
+        cf_index = g_hash_table_new (g_str_hash, g_str_equal);
+        name_index = g_hash_table_new (g_str_hash, g_str_equal);
 
         for (i = 0; names_[i]; i++) {
                 names[i] = _(names_[i]);
                 cf_names[i] = g_utf8_casefold (names[i], -1);
                 cf_en_names[i] = g_utf8_casefold (names_[i], -1);
+
+                add_to_index (cf_index, cf_names[i], i);
+                add_to_index (cf_index, cf_en_names[i], i);
+                add_to_index (name_index, names[i], i);
         }
 }
 
+/* Returns the position of the name, or -1 */
+static int
+find_name (const char *text)
+{
+        g_autofree char *cf_text = NULL;
+
+        translate_names ();
+
+        cf_text = g_utf8_casefold (text, -1);
+
+        return GPOINTER_TO_INT (g_hash_table_lookup (cf_index, cf_text)) - 1;
+}
+
 const char **
 gr_ingredient_get_names (int *length)
 {
@@ -74,51 +110,34 @@ gr_ingredient_get_names (int *length)
 const char *
 gr_ingredient_find (const char *text)
 {
-        int i;
-        g_autofree char *cf_text = NULL;
+        int pos;
 
-        translate_names ();
+        pos = find_name (text);
 
-        cf_text = g_utf8_casefold (text, -1);
-
-        for (i = 0; names[i]; i++) {
-                if (strcmp (cf_text, cf_names[i]) == 0 ||
-                    strcmp (cf_text, cf_en_names[i]) == 0)
-                        return names[i];
-        }
-
-        return NULL;
+        return pos >= 0 ? names[pos] : NULL;
 }
 
 const char *
 gr_ingredient_get_id (const char *name)
 {
-        int i;
-        g_autofree char *cf_text = NULL;
+        int pos;
 
-        translate_names ();
+        pos = find_name (name);
 
-        cf_text = g_utf8_casefold (name, -1);
-
-        for (i = 0; names[i]; i++) {
-                if (strcmp (cf_text, cf_names[i]) == 0 ||
-                    strcmp (cf_text, cf_en_names[i]) == 0)
-                        return names_[i];
-        }
-
-        return NULL;
+        return pos >= 0 ? names_[pos] : NULL;
 }
 
 const char *
 gr_ingredient_get_negation (const char *name)
 {
-        int i;
+        int pos;
 
-        for (i = 0; names[i]; i++) {
-                if (g_strcmp0 (name, names[i]) == 0) {
-                        return _(negations[i]);
-                }
-        }
+        if (name == NULL)
+                return NULL;
+
+        translate_names ();
+
+        pos = GPOINTER_TO_INT (g_hash_table_lookup (name_index, name)) - 1;
 
-        return NULL;
+        return pos >= 0 ? _(negations[pos]) : NULL;
 }
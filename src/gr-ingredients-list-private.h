@@ -0,0 +1,51 @@
+/* gr-ingredients-list-private.h:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "gr-ingredients-list.h"
+#include "gr-unit.h"
+
+G_BEGIN_DECLS
+
+/* Only for gr-ingredients-list.c and the tests, which look at the
+ * parsed ingredients in the order of the text.
+ */
+
+typedef struct
+{
+        double amount;
+        GrUnit unit;
+        const char *name;
+        guint segment;
+} Ingredient;
+
+struct _GrIngredientsList
+{
+        GObject parent_instance;
+
+        char *text;
+        GArray *ingredients;       /* of Ingredient */
+        GPtrArray *segments;       /* segment position -> name */
+        GPtrArray *members;        /* segment position -> GArray of ingredient positions */
+        GHashTable *segment_index; /* name -> segment position */
+};
+
+G_END_DECLS
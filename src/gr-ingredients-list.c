@@ -20,83 +20,108 @@
 
 #include "config.h"
 
+#include <string.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 
 #include "gr-ingredients-list.h"
+#include "gr-ingredients-list-private.h"
 #include "gr-ingredient.h"
 #include "gr-number.h"
 #include "gr-unit.h"
 #include "gr-utils.h"
 
 
-typedef struct
-{
-        double amount;
-        GrUnit unit;
-        gchar *name;
-        gchar *segment;
-} Ingredient;
+/* Parsing
+ * -------
+ *
+ * The text is copied once, and split up in place, so the unknown
+ * ingredient names and the segment names all point into that copy.
+ * The ingredients are kept in an array, in the order of the text.
+ * Segments are interned: each distinct segment name gets a position,
+ * and for each segment we keep the positions of its ingredients, so
+ * looking at one segment doesn't require going through all of them.
+ */
 
-static void
-ingredient_free (Ingredient *ing)
+G_DEFINE_TYPE (GrIngredientsList, gr_ingredients_list, G_TYPE_OBJECT)
+
+static guint
+intern_segment (GrIngredientsList *ingredients,
+                const char        *segment)
 {
-        g_free (ing->name);
-        g_free (ing->segment);
-        g_free (ing);
+        gpointer value;
+        guint pos;
+
+        if (g_hash_table_lookup_extended (ingredients->segment_index, segment, NULL, &value))
+                return GPOINTER_TO_UINT (value);
+
+        pos = ingredients->segments->len;
+        g_ptr_array_add (ingredients->segments, (gpointer)segment);
+        g_ptr_array_add (ingredients->members, g_array_new (FALSE, FALSE, sizeof (guint)));
+        g_hash_table_insert (ingredients->segment_index, (gpointer)segment, GUINT_TO_POINTER (pos));
+
+        return pos;
 }
 
-struct _GrIngredientsList
+static int
+count_fields (const char *line)
 {
-        GObject parent_instance;
+        int n;
 
-        GList *ingredients;
-        GHashTable *segments;
-};
+        for (n = 1; *line; line++) {
+                if (*line == '\t')
+                        n++;
+        }
 
-G_DEFINE_TYPE (GrIngredientsList, gr_ingredients_list, G_TYPE_OBJECT)
+        return n;
+}
 
 static gboolean
 gr_ingredients_list_populate (GrIngredientsList  *ingredients,
                               const char         *text,
                               GError            **error)
 {
-        g_auto(GStrv) lines = NULL;
+        char *line;
+        char *next;
         int i;
 
-        lines = g_strsplit (text, "\n", 0);
+        ingredients->text = g_strdup (text);
 
-        for (i = 0; lines[i]; i++) {
-                g_auto(GStrv) fields = NULL;
+        for (i = 0, line = ingredients->text; line; i++, line = next) {
                 char *amount;
                 char *unit;
                 char *ingredient;
                 char *segment;
                 GrUnit u;
                 const char *s;
-                Ingredient *ing;
+                Ingredient ing;
+                guint pos;
                 g_autoptr(GError) local_error = NULL;
 
-                if (lines[i][0] == '\0')
+                next = strchr (line, '\n');
+                if (next)
+                        *next++ = '\0';
+
+                if (line[0] == '\0')
                         continue;
 
-                fields = g_strsplit (lines[i], "\t", 0);
-                if (g_strv_length (fields) != 4) {
-                        g_warning ("wrong number of fields, ignoring line %d: '%s'", i, lines[i]);
+                if (count_fields (line) != 4) {
+                        g_warning ("wrong number of fields, ignoring line %d: '%s'", i, line);
                         continue;
                 }
 
-                amount = fields[0];
-                unit = fields[1];
-                ingredient = fields[2];
-                segment = fields[3];
+                amount = line;
+                unit = strchr (amount, '\t');
+                *unit++ = '\0';
+                ingredient = strchr (unit, '\t');
+                *ingredient++ = '\0';
+                segment = strchr (ingredient, '\t');
+                *segment++ = '\0';
 
-                ing = g_new0 (Ingredient, 1);
-                ing->amount = 1.0;
+                ing.amount = 1.0;
                 if (amount[0] != '\0' &&
-                    !gr_number_parse (&ing->amount, &amount, &local_error)) {
+                    !gr_number_parse (&ing.amount, &amount, &local_error)) {
                         g_message ("failed to parse amount '%s': %s", amount, local_error->message);
-                        g_free (ing);
                         continue;
                 }
 
@@ -106,17 +131,15 @@ gr_ingredients_list_populate (GrIngredientsList  *ingredients,
                         g_message ("%s; using %s as-is", local_error->message, unit);
                 }
 
-                ing->unit = u;
-                ing->segment = g_strdup (segment);
+                ing.unit = u;
+                ing.segment = intern_segment (ingredients, segment);
 
                 s = gr_ingredient_find (ingredient);
-                if (s)
-                        ing->name = g_strdup (s);
-                else
-                        ing->name = g_strdup (ingredient);
+                ing.name = s ? s : ingredient;
 
-                g_hash_table_add (ingredients->segments, g_strdup (segment));
-                ingredients->ingredients = g_list_append (ingredients->ingredients, ing);
+                pos = ingredients->ingredients->len;
+                g_array_append_val (ingredients->ingredients, ing);
+                g_array_append_val (g_ptr_array_index (ingredients->members, ing.segment), pos);
         }
 
         return TRUE;
@@ -127,8 +150,11 @@ ingredients_list_finalize (GObject *object)
 {
         GrIngredientsList *self = GR_INGREDIENTS_LIST (object);
 
-        g_list_free_full (self->ingredients, (GDestroyNotify)ingredient_free);
-        g_hash_table_unref (self->segments);
+        g_free (self->text);
+        g_array_unref (self->ingredients);
+        g_ptr_array_unref (self->segments);
+        g_ptr_array_unref (self->members);
+        g_hash_table_unref (self->segment_index);
 
         G_OBJECT_CLASS (gr_ingredients_list_parent_class)->finalize (object);
 }
@@ -136,7 +162,10 @@ ingredients_list_finalize (GObject *object)
 static void
 gr_ingredients_list_init (GrIngredientsList *ingredients)
 {
-        ingredients->segments = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        ingredients->ingredients = g_array_new (FALSE, FALSE, sizeof (Ingredient));
+        ingredients->segments = g_ptr_array_new ();
+        ingredients->members = g_ptr_array_new_with_free_func ((GDestroyNotify)g_array_unref);
+        ingredients->segment_index = g_hash_table_new (g_str_hash, g_str_equal);
 }
 
 static void
@@ -169,6 +198,42 @@ gr_ingredients_list_validate (const char  *text,
         return gr_ingredients_list_populate (ingredients, text, error);
 }
 
+/* Returns the ingredient positions of the segment, or NULL */
+static GArray *
+find_segment (GrIngredientsList *ingredients,
+              const char        *segment)
+{
+        gpointer value;
+
+        if (segment == NULL ||
+            !g_hash_table_lookup_extended (ingredients->segment_index, segment, NULL, &value))
+                return NULL;
+
+        return g_ptr_array_index (ingredients->members, GPOINTER_TO_UINT (value));
+}
+
+static Ingredient *
+find_ingredient (GrIngredientsList *ingredients,
+                 const char        *segment,
+                 const char        *name)
+{
+        GArray *members;
+        guint i;
+
+        members = find_segment (ingredients, segment);
+        if (members == NULL)
+                return NULL;
+
+        for (i = 0; i < members->len; i++) {
+                Ingredient *ing = &g_array_index (ingredients->ingredients, Ingredient, g_array_index (members, guint, i));
+
+                if (g_strcmp0 (name, ing->name) == 0)
+                        return ing;
+        }
+
+        return NULL;
+}
+
 static void
 ingredient_scale_unit (Ingredient *ing, double scale, GString *s)
 {
@@ -198,12 +263,12 @@ gr_ingredients_list_scale (GrIngredientsList *ingredients,
                            int                denom)
 {
         GString *s;
-        GList *l;
+        guint i;
 
         s = g_string_new ("");
 
-        for (l = ingredients->ingredients; l; l = l->next) {
-                Ingredient *ing = (Ingredient *)l->data;
+        for (i = 0; i < ingredients->ingredients->len; i++) {
+                Ingredient *ing = &g_array_index (ingredients->ingredients, Ingredient, i);
 
                 ingredient_scale (ing, num, denom, s);
         }
@@ -214,22 +279,33 @@ gr_ingredients_list_scale (GrIngredientsList *ingredients,
 char **
 gr_ingredients_list_get_segments (GrIngredientsList *ingredients)
 {
-        return (char **)g_hash_table_get_keys_as_array (ingredients->segments, NULL);
+        char **ret;
+        guint i;
+
+        ret = g_new0 (char *, ingredients->segments->len + 1);
+        for (i = 0; i < ingredients->segments->len; i++)
+                ret[i] = g_ptr_array_index (ingredients->segments, i);
+
+        return ret;
 }
 
 char **
 gr_ingredients_list_get_ingredients (GrIngredientsList *ingredients,
                                      const char        *segment)
 {
+        GArray *members;
         char **ret;
-        int i;
-        GList *l;
+        guint i;
 
-        ret = g_new0 (char *, g_list_length (ingredients->ingredients) + 1);
-        for (i = 0, l = ingredients->ingredients; l; l = l->next) {
-                Ingredient *ing = (Ingredient *)l->data;
-                if (g_strcmp0 (segment, ing->segment) == 0)
-                        ret[i++] = g_strdup (ing->name);
+        members = find_segment (ingredients, segment);
+        if (members == NULL)
+                return g_new0 (char *, 1);
+
+        ret = g_new0 (char *, members->len + 1);
+        for (i = 0; i < members->len; i++) {
+                Ingredient *ing = &g_array_index (ingredients->ingredients, Ingredient, g_array_index (members, guint, i));
+
+                ret[i] = g_strdup (ing->name);
         }
 
         return ret;
@@ -241,23 +317,17 @@ gr_ingredients_list_scale_unit (GrIngredientsList *ingredients,
                                 const char        *name,
                                 double             scale)
 {
-        GList *l;
-
-        for (l = ingredients->ingredients; l; l = l->next) {
-                Ingredient *ing = (Ingredient *)l->data;
-
-                if (g_strcmp0 (segment, ing->segment) == 0 &&
-                    g_strcmp0 (name, ing->name) == 0) {
-                        GString *s;
+        Ingredient *ing;
+        GString *s;
 
-                        s = g_string_new ("");
-                        ingredient_scale_unit (ing, scale, s);
+        ing = find_ingredient (ingredients, segment, name);
+        if (ing == NULL)
+                return NULL;
 
-                        return g_string_free (s, FALSE);
-                }
-        }
+        s = g_string_new ("");
+        ingredient_scale_unit (ing, scale, s);
 
-        return NULL;
+        return g_string_free (s, FALSE);
 }
 
 GrUnit
@@ -265,18 +335,11 @@ gr_ingredients_list_get_unit (GrIngredientsList *ingredients,
                               const char        *segment,
                               const char        *name)
 {
-        GList *l;
-
-        for (l = ingredients->ingredients; l; l = l->next) {
-                Ingredient *ing = (Ingredient *)l->data;
+        Ingredient *ing;
 
-                if (g_strcmp0 (segment, ing->segment) == 0 &&
-                    g_strcmp0 (name, ing->name) == 0) {
-                        return ing->unit;
-                }
-        }
+        ing = find_ingredient (ingredients, segment, name);
 
-        return GR_UNIT_UNKNOWN;
+        return ing ? ing->unit : GR_UNIT_UNKNOWN;
 }
 
 double
@@ -284,18 +347,9 @@ gr_ingredients_list_get_amount (GrIngredientsList *ingredients,
                                 const char        *segment,
                                 const char        *name)
 {
-        GList *l;
-
-        for (l = ingredients->ingredients; l; l = l->next) {
-                Ingredient *ing = (Ingredient *)l->data;
+        Ingredient *ing;
 
-                if (g_strcmp0 (segment, ing->segment) == 0 &&
-                    g_strcmp0 (name, ing->name) == 0) {
-                        return ing->amount;
-                }
-        }
+        ing = find_ingredient (ingredients, segment, name);
 
-        return 0.0;
+        return ing ? ing->amount : 0.0;
 }
-
-
@@ -69,6 +69,7 @@ enum {
         PROP_EDITABLE,
         PROP_ACTIVE,
         PROP_INGREDIENTS,
+        PROP_INGREDIENTS_LIST,
         PROP_SCALE_NUM,
         PROP_SCALE_DENOM,
         PROP_SCALE
@@ -309,16 +310,17 @@ remove_list (GtkButton           *button,
 }
 
 static void
-gr_ingredients_viewer_set_ingredients (GrIngredientsViewer *viewer,
-                                       const char          *text)
+gr_ingredients_viewer_set_ingredients_list (GrIngredientsViewer *viewer,
+                                            GrIngredientsList   *ingredients)
 {
-        g_autoptr(GrIngredientsList) ingredients = NULL;
         g_auto(GStrv) ings = NULL;
         int i;
 
         container_remove_all (GTK_CONTAINER (viewer->list));
 
-        ingredients = gr_ingredients_list_new (text);
+        if (ingredients == NULL)
+                return;
+
         ings = gr_ingredients_list_get_ingredients (ingredients, viewer->title);
         for (i = 0; ings && ings[i]; i++) {
                 double amount;
@@ -347,6 +349,16 @@ gr_ingredients_viewer_set_ingredients (GrIngredientsViewer *viewer,
         }
 }
 
+static void
+gr_ingredients_viewer_set_ingredients (GrIngredientsViewer *viewer,
+                                       const char          *text)
+{
+        g_autoptr(GrIngredientsList) ingredients = NULL;
+
+        ingredients = gr_ingredients_list_new (text);
+        gr_ingredients_viewer_set_ingredients_list (viewer, ingredients);
+}
+
 static void
 gr_ingredients_viewer_set_title (GrIngredientsViewer *viewer,
                                  const char          *title)
@@ -625,6 +637,10 @@ gr_ingredients_viewer_set_property (GObject      *object,
                 gr_ingredients_viewer_set_ingredients (self, g_value_get_string (value));
                 break;
 
+          case PROP_INGREDIENTS_LIST:
+                gr_ingredients_viewer_set_ingredients_list (self, g_value_get_object (value));
+                break;
+
           default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
           }
@@ -685,6 +701,12 @@ gr_ingredients_viewer_class_init (GrIngredientsViewerClass *klass)
                                      G_PARAM_READWRITE);
         g_object_class_install_property (object_class, PROP_INGREDIENTS, pspec);
 
+        /* Lets users that already have the parsed ingredients avoid parsing them again */
+        pspec = g_param_spec_object ("ingredients-list", NULL, NULL,
+                                     GR_TYPE_INGREDIENTS_LIST,
+                                     G_PARAM_WRITABLE);
+        g_object_class_install_property (object_class, PROP_INGREDIENTS_LIST, pspec);
+
         pspec = g_param_spec_int ("scale-num", NULL, NULL,
                                   1, G_MAXINT, 1,
                                   G_PARAM_READWRITE);
@@ -26,6 +26,7 @@
 #include "gr-list-page.h"
 #include "gr-recipe-store.h"
 #include "gr-recipe.h"
+#include "gr-recipe-grid.h"
 #include "gr-recipe-tile.h"
 #include "gr-utils.h"
 #include "gr-season.h"
@@ -50,7 +51,7 @@ struct _GrListPage
 
         GtkWidget *top_box;
         GtkWidget *list_stack;
-        GtkWidget *flow_box;
+        GtkWidget *grid;
         GtkWidget *empty_title;
         GtkWidget *empty_subtitle;
 
@@ -63,7 +64,6 @@ struct _GrListPage
 
         gboolean show_shared;
 
-        int count;
         GrRecipeSearch *search;
 };
 
@@ -130,13 +130,39 @@ show_heading (GrListPage *self)
         }
 }
 
+static guint
+get_count (GrListPage *page)
+{
+        return g_list_model_get_n_items (gr_recipe_grid_get_model (GR_RECIPE_GRID (page->grid)));
+}
+
+static void
+add_recipe (GrListPage *page,
+            GrRecipe   *recipe)
+{
+        gr_recipe_grid_add (GR_RECIPE_GRID (page->grid), recipe);
+}
+
+static void
+remove_recipe (GrListPage *page,
+               GrRecipe   *recipe)
+{
+        gr_recipe_grid_remove_recipe (GR_RECIPE_GRID (page->grid), recipe);
+}
+
+static void
+clear_recipes (GrListPage *page)
+{
+        gr_recipe_grid_clear (GR_RECIPE_GRID (page->grid));
+        gr_recipe_grid_set_show_shared (GR_RECIPE_GRID (page->grid), page->show_shared);
+}
+
 static void
 search_started (GrRecipeSearch *search,
                 GrListPage     *page)
 {
-        container_remove_all (GTK_CONTAINER (page->flow_box));
+        clear_recipes (page);
         hide_heading (page);
-        page->count = 0;
 }
 
 static void
@@ -145,21 +171,12 @@ search_hits_added (GrRecipeSearch *search,
                    GrListPage     *page)
 {
         GList *l;
-        int count = page->count;
-
-        for (l = hits; l; l = l->next) {
-                GrRecipe *recipe = l->data;
-                GtkWidget *tile;
+        guint count = get_count (page);
 
-                tile = gr_recipe_tile_new (recipe);
-                gr_recipe_tile_set_show_shared (GR_RECIPE_TILE (tile), page->show_shared);
-                gtk_widget_show (tile);
-                gtk_container_add (GTK_CONTAINER (page->flow_box), tile);
+        for (l = hits; l; l = l->next)
+                add_recipe (page, l->data);
 
-                page->count++;
-        }
-
-        if (count == 0 && page->count > 0)
+        if (count == 0 && get_count (page) > 0)
                 show_heading (page);
 }
 
@@ -168,21 +185,10 @@ search_hits_removed (GrRecipeSearch *search,
                      GList          *hits,
                      GrListPage     *page)
 {
-        GList *children, *l;
-
-        children = gtk_container_get_children (GTK_CONTAINER (page->flow_box));
-        for (l = children; l; l = l->next) {
-                GtkWidget *item = l->data;
-                GtkWidget *tile;
-                GrRecipe *recipe;
+        GList *l;
 
-                tile = gtk_bin_get_child (GTK_BIN (item));
-                recipe = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile));
-                if (g_list_find (hits, recipe)) {
-                        gtk_container_remove (GTK_CONTAINER (page->flow_box), item);
-                        page->count--;
-                }
-        }
+        for (l = hits; l; l = l->next)
+                remove_recipe (page, l->data);
 }
 
 static void
@@ -191,53 +197,14 @@ search_finished (GrRecipeSearch *search,
 {
         show_heading (page);
         gtk_stack_set_visible_child_name (GTK_STACK (page->list_stack),
-                                          page->count > 0 ? "list" : "empty");
-}
-
-static int
-name_sort_func (GtkFlowBoxChild *child1,
-                GtkFlowBoxChild *child2,
-                gpointer         data)
-{
-        GtkWidget *tile1 = gtk_bin_get_child (GTK_BIN (child1));
-        GtkWidget *tile2 = gtk_bin_get_child (GTK_BIN (child2));
-        GrRecipe *recipe1 = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile1));
-        GrRecipe *recipe2 = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile2));
-        const char *name1 = gr_recipe_get_name (recipe1);
-        const char *name2 = gr_recipe_get_name (recipe2);
-
-        return strcmp (name1, name2);
-}
-
-static int
-date_sort_func (GtkFlowBoxChild *child1,
-                GtkFlowBoxChild *child2,
-                gpointer         data)
-{
-        GtkWidget *tile1 = gtk_bin_get_child (GTK_BIN (child1));
-        GtkWidget *tile2 = gtk_bin_get_child (GTK_BIN (child2));
-        GrRecipe *recipe1 = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile1));
-        GrRecipe *recipe2 = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile2));
-        GDateTime *mtime1 = gr_recipe_get_mtime (recipe1);
-        GDateTime *mtime2 = gr_recipe_get_mtime (recipe2);
-
-        return g_date_time_compare (mtime2, mtime1);
+                                          get_count (page) > 0 ? "list" : "empty");
 }
 
 static void
 gr_list_page_set_sort (GrListPage *page,
                        GrSortKey   sort)
 {
-        switch (sort) {
-        case SORT_BY_NAME:
-                gtk_flow_box_set_sort_func (GTK_FLOW_BOX (page->flow_box), name_sort_func, page, NULL);
-                break;
-        case SORT_BY_RECENCY:
-                gtk_flow_box_set_sort_func (GTK_FLOW_BOX (page->flow_box), date_sort_func, page, NULL);
-                break;
-        default:
-                g_assert_not_reached ();
-        }
+        gr_recipe_grid_set_sort (GR_RECIPE_GRID (page->grid), sort);
 }
 
 static void
@@ -257,6 +224,7 @@ gr_list_page_init (GrListPage *page)
 {
         gtk_widget_set_has_window (GTK_WIDGET (page), FALSE);
         gtk_widget_init_template (GTK_WIDGET (page));
+
         connect_store_signals (page);
 
         page->search = gr_recipe_search_new ();
@@ -280,7 +248,7 @@ gr_list_page_class_init (GrListPageClass *klass)
         gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/Recipes/gr-list-page.ui");
 
         gtk_widget_class_bind_template_child (widget_class, GrListPage, top_box);
-        gtk_widget_class_bind_template_child (widget_class, GrListPage, flow_box);
+        gtk_widget_class_bind_template_child (widget_class, GrListPage, grid);
         gtk_widget_class_bind_template_child (widget_class, GrListPage, list_stack);
         gtk_widget_class_bind_template_child (widget_class, GrListPage, empty_title);
         gtk_widget_class_bind_template_child (widget_class, GrListPage, empty_subtitle);
@@ -359,7 +327,7 @@ gr_list_page_populate_from_diet (GrListPage *self,
         gtk_label_set_label (GTK_LABEL (self->heading), gr_diet_get_label (diet));
         gtk_label_set_markup (GTK_LABEL (self->diet_description), gr_diet_get_description (diet));
 
-        container_remove_all (GTK_CONTAINER (self->flow_box));
+        clear_recipes (self);
         tmp = g_strdup_printf (_("No %s found"), get_category_title (diet));
         gtk_label_set_label (GTK_LABEL (self->empty_title), tmp);
         g_free (tmp);
@@ -376,6 +344,7 @@ gr_list_page_set_show_shared (GrListPage *self,
                               gboolean    show_shared)
 {
         self->show_shared = show_shared;
+        gr_recipe_grid_set_show_shared (GR_RECIPE_GRID (self->grid), show_shared);
 }
 
 void
@@ -427,7 +396,7 @@ gr_list_page_populate_from_chef (GrListPage *self,
 
         store = gr_recipe_store_get ();
 
-        container_remove_all (GTK_CONTAINER (self->flow_box));
+        clear_recipes (self);
         tmp = g_strdup_printf (_("No recipes by chef %s found"), name);
         gtk_label_set_label (GTK_LABEL (self->empty_title), tmp);
         g_free (tmp);
@@ -461,7 +430,7 @@ gr_list_page_populate_from_season (GrListPage *self,
         gtk_widget_hide (self->heading);
         gtk_widget_hide (self->diet_description);
 
-        container_remove_all (GTK_CONTAINER (self->flow_box));
+        clear_recipes (self);
         tmp = g_strdup_printf (_("No recipes for %s found"), gr_season_get_title (self->season));
         gtk_label_set_label (GTK_LABEL (self->empty_title), tmp);
         g_free (tmp);
@@ -485,7 +454,7 @@ gr_list_page_populate_from_favorites (GrListPage *self)
         gtk_widget_hide (self->heading);
         gtk_widget_hide (self->diet_description);
 
-        container_remove_all (GTK_CONTAINER (self->flow_box));
+        clear_recipes (self);
         gtk_label_set_label (GTK_LABEL (self->empty_title), _("No favorite recipes found"));
         gtk_label_set_label (GTK_LABEL (self->empty_subtitle), _("Use the ♥ button to mark recipes as favorites."));
 
@@ -506,7 +475,7 @@ gr_list_page_populate_from_all (GrListPage *self)
         gtk_widget_hide (self->heading);
         gtk_widget_hide (self->diet_description);
 
-        container_remove_all (GTK_CONTAINER (self->flow_box));
+        clear_recipes (self);
         gtk_label_set_label (GTK_LABEL (self->empty_title), _("No recipes found"));
         gtk_label_set_label (GTK_LABEL (self->empty_subtitle), _("Sorry about this."));
 
@@ -533,7 +502,7 @@ gr_list_page_populate_from_new (GrListPage *self)
         gtk_widget_hide (self->heading);
         gtk_widget_hide (self->diet_description);
 
-        container_remove_all (GTK_CONTAINER (self->flow_box));
+        clear_recipes (self);
         gtk_label_set_label (GTK_LABEL (self->empty_title), _("No new recipes"));
         gtk_label_set_label (GTK_LABEL (self->empty_subtitle), _("Sorry about this."));
 
@@ -554,7 +523,6 @@ gr_list_page_populate_from_list (GrListPage *self,
 {
         GrRecipeStore *store;
         GList *l;
-        gboolean empty;
 
         self->show_shared = FALSE;
 
@@ -568,28 +536,24 @@ gr_list_page_populate_from_list (GrListPage *self,
         gtk_widget_hide (self->heading);
         gtk_widget_hide (self->diet_description);
 
-        container_remove_all (GTK_CONTAINER (self->flow_box));
+        clear_recipes (self);
         gtk_label_set_label (GTK_LABEL (self->empty_title), _("No imported recipes found"));
         gtk_label_set_label (GTK_LABEL (self->empty_subtitle), _("Sorry about this."));
         gtk_stack_set_visible_child_name (GTK_STACK (self->list_stack), "empty");
 
-        empty = TRUE;
+        gr_recipe_search_stop (self->search);
 
         for (l = self->recipes; l; l = l->next) {
                 GrRecipe *recipe = l->data;
                 g_autoptr(GrRecipe) r2 = NULL;
 
                 r2 = gr_recipe_store_get_recipe (store, gr_recipe_get_id (recipe));
-                if (r2 == recipe) {
-                        GtkWidget *tile = gr_recipe_tile_new (recipe);
-                        gtk_widget_show (tile);
-                        gtk_container_add (GTK_CONTAINER (self->flow_box), tile);
-                        empty = FALSE;
-                }
+                if (r2 == recipe)
+                        add_recipe (self, recipe);
         }
 
         gtk_stack_set_visible_child_name (GTK_STACK (self->list_stack),
-                                          empty ? "empty" : "list");
+                                          get_count (self) > 0 ? "list" : "empty");
 }
 
 /* keep function this in sync with clear_data */
@@ -612,8 +576,65 @@ gr_list_page_repopulate (GrListPage *page)
                 gr_list_page_populate_from_new (page);
 }
 
+static gboolean
+page_shows_recipe (GrListPage *page,
+                   GrRecipe   *recipe)
+{
+        if (page->recipes)
+                return g_list_find (page->recipes, recipe) != NULL;
+
+        return gr_recipe_search_matches (page->search, recipe);
+}
+
+/* Applies a change to a single recipe to the page. While the search
+ * is still running, we can't tell whether it has seen the recipe yet,
+ * so we start over.
+ */
+static void
+recipe_changed (GrListPage *page,
+                GrRecipe   *recipe)
+{
+        GrRecipeGrid *grid = GR_RECIPE_GRID (page->grid);
+
+        if (!gtk_widget_is_drawable (GTK_WIDGET (page)))
+                return;
+
+        if (gr_recipe_search_is_running (page->search)) {
+                gr_list_page_repopulate (page);
+                return;
+        }
+
+        if (!page_shows_recipe (page, recipe))
+                remove_recipe (page, recipe);
+        else if (gr_recipe_grid_contains (grid, recipe))
+                gr_recipe_grid_update (grid, recipe);
+        else
+                add_recipe (page, recipe);
+
+        gtk_stack_set_visible_child_name (GTK_STACK (page->list_stack),
+                                          get_count (page) > 0 ? "list" : "empty");
+}
+
+static void
+recipe_removed (GrListPage *page,
+                GrRecipe   *recipe)
+{
+        if (!gtk_widget_is_drawable (GTK_WIDGET (page)))
+                return;
+
+        if (gr_recipe_search_is_running (page->search)) {
+                gr_list_page_repopulate (page);
+                return;
+        }
+
+        remove_recipe (page, recipe);
+
+        gtk_stack_set_visible_child_name (GTK_STACK (page->list_stack),
+                                          get_count (page) > 0 ? "list" : "empty");
+}
+
 static void
-repopulate (GrListPage *page)
+recipes_reloaded (GrListPage *page)
 {
         if (gtk_widget_is_drawable (GTK_WIDGET (page)))
                 gr_list_page_repopulate (page);
@@ -626,14 +647,15 @@ connect_store_signals (GrListPage *page)
 
         store = gr_recipe_store_get ();
 
-        g_signal_connect_swapped (store, "recipe-added", G_CALLBACK (repopulate), page);
-        g_signal_connect_swapped (store, "recipe-removed", G_CALLBACK (repopulate), page);
-        g_signal_connect_swapped (store, "recipe-changed", G_CALLBACK (repopulate), page);
+        g_signal_connect_swapped (store, "recipe-added", G_CALLBACK (recipe_changed), page);
+        g_signal_connect_swapped (store, "recipe-removed", G_CALLBACK (recipe_removed), page);
+        g_signal_connect_swapped (store, "recipe-changed", G_CALLBACK (recipe_changed), page);
+        g_signal_connect_swapped (store, "reloaded", G_CALLBACK (recipes_reloaded), page);
 }
 
 void
 gr_list_page_clear (GrListPage *self)
 {
         gr_recipe_search_stop (self->search);
-        container_remove_all (GTK_CONTAINER (self->flow_box));
+        clear_recipes (self);
 }
@@ -0,0 +1,292 @@
+/* gr-pixbuf-cache.c:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "gr-pixbuf-cache.h"
+
+/* Decoded images
+ * --------------
+ *
+ * The same recipe images are shown on many pages, at a handful of
+ * sizes, so we keep the decoded pixbufs around instead of decoding
+ * the files again every time. Entries are keyed by the path and the
+ * size and flags they were loaded with, and the least recently used
+ * ones are dropped once the pixbufs take up more than the budget.
+ * Blurred placeholders are kept under the path of the thumbnail they
+ * were made from, so they go away together with it.
+ *
+ * Images are decoded in threads, so all access is under a lock.
+ */
+
+#define DEFAULT_BUDGET (64 * 1024 * 1024)
+#define STATS_INTERVAL 100
+
+typedef struct {
+        char *key;
+        char *path;
+        GdkPixbuf *pixbuf;
+        gsize size;
+        GList *link;
+} Entry;
+
+struct _GrPixbufCache
+{
+        GMutex lock;
+
+        GHashTable *entries;    /* key -> Entry */
+        GQueue lru;             /* most recently used first */
+
+        gsize size;
+        gsize budget;
+
+        guint hits;
+        guint misses;
+};
+
+static void
+entry_free (gpointer data)
+{
+        Entry *entry = data;
+
+        g_free (entry->key);
+        g_free (entry->path);
+        g_object_unref (entry->pixbuf);
+        g_free (entry);
+}
+
+static char *
+make_key (const char         *path,
+          int                 width,
+          int                 height,
+          GrPixbufCacheFlags  flags)
+{
+        return g_strdup_printf ("%d:%d:%u:%s", width, height, flags, path);
+}
+
+/**
+ * gr_pixbuf_cache_new:
+ * @budget: the number of bytes that pixbufs may take up
+ *
+ * Creates a new, empty cache.
+ *
+ * Returns: (transfer full): a new #GrPixbufCache
+ */
+GrPixbufCache *
+gr_pixbuf_cache_new (gsize budget)
+{
+        GrPixbufCache *cache;
+
+        cache = g_new0 (GrPixbufCache, 1);
+        g_mutex_init (&cache->lock);
+        cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, entry_free);
+        g_queue_init (&cache->lru);
+        cache->budget = budget;
+
+        return cache;
+}
+
+void
+gr_pixbuf_cache_free (GrPixbufCache *cache)
+{
+        g_queue_clear (&cache->lru);
+        g_hash_table_unref (cache->entries);
+        g_mutex_clear (&cache->lock);
+        g_free (cache);
+}
+
+/**
+ * gr_pixbuf_cache_get_default:
+ *
+ * Returns the cache that is shared by all image loads.
+ *
+ * Returns: (transfer none): the default #GrPixbufCache
+ */
+GrPixbufCache *
+gr_pixbuf_cache_get_default (void)
+{
+        static GrPixbufCache *cache;
+
+        if (g_once_init_enter (&cache))
+                g_once_init_leave (&cache, gr_pixbuf_cache_new (DEFAULT_BUDGET));
+
+        return cache;
+}
+
+static void
+remove_entry (GrPixbufCache *cache,
+              Entry         *entry)
+{
+        g_queue_delete_link (&cache->lru, entry->link);
+        cache->size -= entry->size;
+        g_hash_table_remove (cache->entries, entry->key);
+}
+
+static void
+evict (GrPixbufCache *cache)
+{
+        while (cache->size > cache->budget && cache->lru.tail != NULL) {
+                Entry *entry = cache->lru.tail->data;
+
+                g_debug ("Dropping %s from the pixbuf cache", entry->key);
+                remove_entry (cache, entry);
+        }
+}
+
+void
+gr_pixbuf_cache_set_budget (GrPixbufCache *cache,
+                            gsize          budget)
+{
+        g_mutex_lock (&cache->lock);
+
+        cache->budget = budget;
+        evict (cache);
+
+        g_mutex_unlock (&cache->lock);
+}
+
+/**
+ * gr_pixbuf_cache_lookup:
+ * @cache: a #GrPixbufCache
+ * @path: the path of the image file
+ * @width: the width the image was loaded at
+ * @height: the height the image was loaded at
+ * @flags: how the image was loaded
+ *
+ * Looks for a pixbuf that was loaded from @path with the given
+ * parameters, and marks it as recently used.
+ *
+ * Returns: (transfer full) (nullable): the pixbuf, or %NULL
+ */
+GdkPixbuf *
+gr_pixbuf_cache_lookup (GrPixbufCache      *cache,
+                        const char         *path,
+                        int                 width,
+                        int                 height,
+                        GrPixbufCacheFlags  flags)
+{
+        g_autofree char *key = NULL;
+        GdkPixbuf *pixbuf = NULL;
+        Entry *entry;
+
+        key = make_key (path, width, height, flags);
+
+        g_mutex_lock (&cache->lock);
+
+        entry = g_hash_table_lookup (cache->entries, key);
+        if (entry) {
+                g_queue_unlink (&cache->lru, entry->link);
+                g_queue_push_head_link (&cache->lru, entry->link);
+                pixbuf = g_object_ref (entry->pixbuf);
+                cache->hits++;
+        }
+        else
+                cache->misses++;
+
+        if ((cache->hits + cache->misses) % STATS_INTERVAL == 0)
+                g_debug ("Pixbuf cache: %u hits, %u misses, %" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT " bytes used",
+                         cache->hits, cache->misses, cache->size, cache->budget);
+
+        g_mutex_unlock (&cache->lock);
+
+        return pixbuf;
+}
+
+void
+gr_pixbuf_cache_insert (GrPixbufCache      *cache,
+                        const char         *path,
+                        int                 width,
+                        int                 height,
+                        GrPixbufCacheFlags  flags,
+                        GdkPixbuf          *pixbuf)
+{
+        Entry *entry;
+        Entry *old;
+
+        entry = g_new0 (Entry, 1);
+        entry->key = make_key (path, width, height, flags);
+        entry->path = g_strdup (path);
+        entry->pixbuf = g_object_ref (pixbuf);
+        entry->size = (gsize) gdk_pixbuf_get_rowstride (pixbuf) * gdk_pixbuf_get_height (pixbuf);
+
+        g_mutex_lock (&cache->lock);
+
+        /* Two threads may have decoded the same image */
+        old = g_hash_table_lookup (cache->entries, entry->key);
+        if (old)
+                remove_entry (cache, old);
+
+        g_queue_push_head (&cache->lru, entry);
+        entry->link = cache->lru.head;
+        g_hash_table_insert (cache->entries, entry->key, entry);
+        cache->size += entry->size;
+
+        evict (cache);
+
+        g_mutex_unlock (&cache->lock);
+}
+
+/**
+ * gr_pixbuf_cache_invalidate:
+ * @cache: a #GrPixbufCache
+ * @path: the path of an image file
+ *
+ * Drops all pixbufs that were loaded from @path. This must be called
+ * whenever the file at @path is changed or removed.
+ */
+void
+gr_pixbuf_cache_invalidate (GrPixbufCache *cache,
+                            const char    *path)
+{
+        GList *l, *next;
+
+        g_mutex_lock (&cache->lock);
+
+        for (l = cache->lru.head; l; l = next) {
+                Entry *entry = l->data;
+
+                next = l->next;
+
+                if (strcmp (entry->path, path) == 0)
+                        remove_entry (cache, entry);
+        }
+
+        g_mutex_unlock (&cache->lock);
+}
+
+void
+gr_pixbuf_cache_get_stats (GrPixbufCache *cache,
+                           guint         *hits,
+                           guint         *misses,
+                           gsize         *size)
+{
+        g_mutex_lock (&cache->lock);
+
+        if (hits)
+                *hits = cache->hits;
+        if (misses)
+                *misses = cache->misses;
+        if (size)
+                *size = cache->size;
+
+        g_mutex_unlock (&cache->lock);
+}
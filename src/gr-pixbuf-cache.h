@@ -0,0 +1,60 @@
+/* gr-pixbuf-cache.h:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GrPixbufCache GrPixbufCache;
+
+typedef enum {
+        GR_PIXBUF_CACHE_FIT     = 1 << 0,
+        GR_PIXBUF_CACHE_BLURRED = 1 << 1
+} GrPixbufCacheFlags;
+
+GrPixbufCache *gr_pixbuf_cache_new         (gsize               budget);
+void           gr_pixbuf_cache_free        (GrPixbufCache      *cache);
+GrPixbufCache *gr_pixbuf_cache_get_default (void);
+
+void           gr_pixbuf_cache_set_budget  (GrPixbufCache      *cache,
+                                            gsize               budget);
+GdkPixbuf     *gr_pixbuf_cache_lookup      (GrPixbufCache      *cache,
+                                            const char         *path,
+                                            int                 width,
+                                            int                 height,
+                                            GrPixbufCacheFlags  flags);
+void           gr_pixbuf_cache_insert      (GrPixbufCache      *cache,
+                                            const char         *path,
+                                            int                 width,
+                                            int                 height,
+                                            GrPixbufCacheFlags  flags,
+                                            GdkPixbuf          *pixbuf);
+void           gr_pixbuf_cache_invalidate  (GrPixbufCache      *cache,
+                                            const char         *path);
+void           gr_pixbuf_cache_get_stats   (GrPixbufCache      *cache,
+                                            guint              *hits,
+                                            guint              *misses,
+                                            gsize              *size);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrPixbufCache, gr_pixbuf_cache_free)
+
+G_END_DECLS
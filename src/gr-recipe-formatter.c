@@ -94,7 +94,7 @@ gr_recipe_format (GrRecipe *recipe)
         g_string_append (s, "\n");
         g_string_append_printf (s, "%s\n", gr_recipe_get_translated_description (recipe));
 
-        ingredients = gr_ingredients_list_new (gr_recipe_get_ingredients (recipe));
+        ingredients = g_object_ref (gr_recipe_get_ingredients_list (recipe));
         segs = gr_ingredients_list_get_segments (ingredients);
         for (j = 0; segs[j]; j++) {
                 g_string_append (s, "\n");
@@ -0,0 +1,693 @@
+/* gr-recipe-grid.c:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "gr-recipe-grid.h"
+#include "gr-recipe-tile.h"
+
+/* Recipe grids
+ * ------------
+ *
+ * A grid of recipe tiles that only has tiles for the items in and
+ * near the visible part of the scrolled window it is in. The recipes
+ * are kept, in order, in a list model. When the view is scrolled or the
+ * model changes, tiles that fall out of the visible area are unbound
+ * and reused for the items that come into it, so the number of tiles
+ * and image loads depends on the size of the window, not on the
+ * number of recipes.
+ *
+ * All tiles have the same size, which lets us place items without
+ * measuring them, and gives the grid its full height for scrolling.
+ *
+ * The model is sorted by the name and mtime each recipe had when it
+ * was added, not by its current ones. That way the model stays sorted
+ * when recipes are edited, and a recipe can be found by binary search
+ * before gr_recipe_grid_update() moves it to its new place.
+ */
+
+#define N_COLUMNS 3
+#define SPACING 20
+#define EXTRA_ROWS 2
+
+typedef struct {
+        GtkWidget *tile;
+        guint position;
+} Cell;
+
+typedef struct {
+        char *name;
+        GDateTime *mtime;
+} SortKey;
+
+static SortKey *
+sort_key_new (GrRecipe *recipe)
+{
+        SortKey *key;
+
+        key = g_new (SortKey, 1);
+        key->name = g_strdup (gr_recipe_get_name (recipe));
+        key->mtime = g_date_time_ref (gr_recipe_get_mtime (recipe));
+
+        return key;
+}
+
+static void
+sort_key_free (gpointer data)
+{
+        SortKey *key = data;
+
+        g_free (key->name);
+        g_date_time_unref (key->mtime);
+        g_free (key);
+}
+
+struct _GrRecipeGrid
+{
+        GtkContainer parent_instance;
+
+        GListStore *model;
+        GHashTable *recipes;    /* recipe -> SortKey, for the recipes in the model */
+        GrSortKey sort;
+        gboolean show_shared;
+
+        GArray *cells;          /* Cell, bound tiles, by position */
+        GPtrArray *pool;        /* unbound tiles */
+
+        int tile_width;
+        int tile_height;
+
+        GtkAdjustment *vadjustment;
+        guint update_id;
+};
+
+G_DEFINE_TYPE (GrRecipeGrid, gr_recipe_grid, GTK_TYPE_CONTAINER)
+
+static int
+compare_recipes (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      data)
+{
+        GrRecipeGrid *grid = data;
+        SortKey *key1 = g_hash_table_lookup (grid->recipes, a);
+        SortKey *key2 = g_hash_table_lookup (grid->recipes, b);
+
+        switch (grid->sort) {
+        case SORT_BY_NAME:
+                return strcmp (key1->name, key2->name);
+        case SORT_BY_RECENCY:
+                return g_date_time_compare (key2->mtime, key1->mtime);
+        default:
+                g_assert_not_reached ();
+        }
+}
+
+static GtkWidget *
+acquire_tile (GrRecipeGrid *grid)
+{
+        GtkWidget *tile;
+
+        if (grid->pool->len > 0) {
+                tile = g_ptr_array_index (grid->pool, grid->pool->len - 1);
+                g_ptr_array_remove_index (grid->pool, grid->pool->len - 1);
+        }
+        else {
+                tile = gr_recipe_tile_new (NULL);
+                gtk_widget_set_parent (tile, GTK_WIDGET (grid));
+        }
+
+        gtk_widget_show (tile);
+        gtk_widget_set_child_visible (tile, TRUE);
+        gr_recipe_tile_set_show_shared (GR_RECIPE_TILE (tile), grid->show_shared);
+
+        return tile;
+}
+
+/* Unbinding the tile cancels its image load */
+static void
+release_tile (GrRecipeGrid *grid,
+              GtkWidget    *tile)
+{
+        gr_recipe_tile_set_recipe (GR_RECIPE_TILE (tile), NULL);
+        gtk_widget_set_child_visible (tile, FALSE);
+        g_ptr_array_add (grid->pool, tile);
+}
+
+/* Measured on a tile of our own, since we may have none yet */
+static void
+ensure_tile_size (GrRecipeGrid *grid)
+{
+        GtkWidget *tile;
+        GtkRequisition min;
+
+        if (grid->tile_width > 0)
+                return;
+
+        tile = g_object_ref_sink (gr_recipe_tile_new (NULL));
+        gtk_widget_show (tile);
+        gtk_widget_get_preferred_size (tile, &min, NULL);
+        gtk_widget_destroy (tile);
+        g_object_unref (tile);
+
+        grid->tile_width = min.width;
+        grid->tile_height = min.height;
+}
+
+static guint
+get_n_items (GrRecipeGrid *grid)
+{
+        return g_list_model_get_n_items (G_LIST_MODEL (grid->model));
+}
+
+static int
+get_n_rows (GrRecipeGrid *grid)
+{
+        return (get_n_items (grid) + N_COLUMNS - 1) / N_COLUMNS;
+}
+
+/* Finds the items whose rows are within EXTRA_ROWS of the part of
+ * the grid that is visible in the scrolled window.
+ */
+static void
+get_visible_range (GrRecipeGrid *grid,
+                   guint        *first,
+                   guint        *last)
+{
+        GtkWidget *viewport;
+        GtkWidget *content;
+        double top, bottom;
+        int row_height;
+        int first_row, last_row;
+        int y;
+
+        *first = *last = 0;
+
+        if (!grid->vadjustment || !gtk_widget_get_mapped (GTK_WIDGET (grid)))
+                return;
+
+        ensure_tile_size (grid);
+
+        viewport = gtk_widget_get_ancestor (GTK_WIDGET (grid), GTK_TYPE_VIEWPORT);
+        content = gtk_bin_get_child (GTK_BIN (viewport));
+        if (!gtk_widget_translate_coordinates (GTK_WIDGET (grid), content, 0, 0, NULL, &y))
+                return;
+
+        top = gtk_adjustment_get_value (grid->vadjustment) - y;
+        bottom = top + gtk_adjustment_get_page_size (grid->vadjustment);
+        row_height = grid->tile_height + SPACING;
+
+        first_row = MAX ((int) (top / row_height) - EXTRA_ROWS, 0);
+        last_row = MIN ((int) (bottom / row_height) + 1 + EXTRA_ROWS, get_n_rows (grid));
+
+        if (first_row >= last_row)
+                return;
+
+        *first = first_row * N_COLUMNS;
+        *last = MIN (last_row * N_COLUMNS, get_n_items (grid));
+}
+
+static void
+update_tiles (GrRecipeGrid *grid)
+{
+        g_autoptr(GHashTable) old = NULL;
+        GArray *cells;
+        GHashTableIter iter;
+        GtkWidget *tile;
+        guint first, last;
+        guint i;
+
+        get_visible_range (grid, &first, &last);
+
+        /* Tiles that show an item in the new range stay with their item */
+        old = g_hash_table_new (NULL, NULL);
+        for (i = 0; i < grid->cells->len; i++) {
+                Cell *cell = &g_array_index (grid->cells, Cell, i);
+
+                g_hash_table_insert (old, gr_recipe_tile_get_recipe (GR_RECIPE_TILE (cell->tile)), cell->tile);
+        }
+
+        cells = g_array_sized_new (FALSE, FALSE, sizeof (Cell), last - first);
+        for (i = first; i < last; i++) {
+                g_autoptr(GrRecipe) recipe = NULL;
+                Cell cell;
+
+                recipe = g_list_model_get_item (G_LIST_MODEL (grid->model), i);
+                cell.position = i;
+                cell.tile = g_hash_table_lookup (old, recipe);
+                if (cell.tile)
+                        g_hash_table_remove (old, recipe);
+                g_array_append_val (cells, cell);
+        }
+
+        g_hash_table_iter_init (&iter, old);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&tile))
+                release_tile (grid, tile);
+
+        for (i = 0; i < cells->len; i++) {
+                Cell *cell = &g_array_index (cells, Cell, i);
+                g_autoptr(GrRecipe) recipe = NULL;
+
+                if (cell->tile)
+                        continue;
+
+                recipe = g_list_model_get_item (G_LIST_MODEL (grid->model), cell->position);
+                cell->tile = acquire_tile (grid);
+                gr_recipe_tile_set_recipe (GR_RECIPE_TILE (cell->tile), recipe);
+        }
+
+        g_array_unref (grid->cells);
+        grid->cells = cells;
+
+        /* Keep no more spare tiles than we are using */
+        while (grid->pool->len > MAX (cells->len, N_COLUMNS)) {
+                tile = g_ptr_array_index (grid->pool, grid->pool->len - 1);
+                g_ptr_array_remove_index (grid->pool, grid->pool->len - 1);
+                gtk_widget_unparent (tile);
+        }
+
+        gtk_widget_queue_allocate (GTK_WIDGET (grid));
+}
+
+static gboolean
+update_idle (gpointer data)
+{
+        GrRecipeGrid *grid = data;
+
+        grid->update_id = 0;
+        update_tiles (grid);
+
+        return G_SOURCE_REMOVE;
+}
+
+/* Tiles are not changed during size allocation, scrolling or for
+ * each change of the model, but once, in an idle that runs before
+ * the next frame is drawn.
+ */
+static void
+queue_update (GrRecipeGrid *grid)
+{
+        if (grid->update_id == 0)
+                grid->update_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE + 10, update_idle, grid, NULL);
+}
+
+static void
+items_changed (GListModel   *model,
+               guint         position,
+               guint         removed,
+               guint         added,
+               GrRecipeGrid *grid)
+{
+        gtk_widget_queue_resize (GTK_WIDGET (grid));
+        queue_update (grid);
+}
+
+static void
+set_vadjustment (GrRecipeGrid  *grid,
+                 GtkAdjustment *vadjustment)
+{
+        if (grid->vadjustment == vadjustment)
+                return;
+
+        if (grid->vadjustment) {
+                g_signal_handlers_disconnect_by_func (grid->vadjustment, queue_update, grid);
+                g_clear_object (&grid->vadjustment);
+        }
+
+        if (vadjustment) {
+                grid->vadjustment = g_object_ref (vadjustment);
+                g_signal_connect_swapped (vadjustment, "value-changed", G_CALLBACK (queue_update), grid);
+                g_signal_connect_swapped (vadjustment, "changed", G_CALLBACK (queue_update), grid);
+        }
+}
+
+static void
+gr_recipe_grid_map (GtkWidget *widget)
+{
+        GrRecipeGrid *grid = GR_RECIPE_GRID (widget);
+        GtkWidget *viewport;
+
+        viewport = gtk_widget_get_ancestor (widget, GTK_TYPE_VIEWPORT);
+        if (viewport)
+                set_vadjustment (grid, gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (viewport)));
+
+        GTK_WIDGET_CLASS (gr_recipe_grid_parent_class)->map (widget);
+
+        queue_update (grid);
+}
+
+static void
+gr_recipe_grid_unmap (GtkWidget *widget)
+{
+        GrRecipeGrid *grid = GR_RECIPE_GRID (widget);
+
+        set_vadjustment (grid, NULL);
+
+        GTK_WIDGET_CLASS (gr_recipe_grid_parent_class)->unmap (widget);
+}
+
+static void
+gr_recipe_grid_get_preferred_width (GtkWidget *widget,
+                                    int       *minimum,
+                                    int       *natural)
+{
+        GrRecipeGrid *grid = GR_RECIPE_GRID (widget);
+
+        ensure_tile_size (grid);
+
+        *minimum = *natural = N_COLUMNS * grid->tile_width + (N_COLUMNS - 1) * SPACING;
+}
+
+static void
+gr_recipe_grid_get_preferred_height (GtkWidget *widget,
+                                     int       *minimum,
+                                     int       *natural)
+{
+        GrRecipeGrid *grid = GR_RECIPE_GRID (widget);
+        int rows;
+
+        ensure_tile_size (grid);
+
+        rows = get_n_rows (grid);
+        *minimum = *natural = rows > 0 ? rows * grid->tile_height + (rows - 1) * SPACING : 0;
+}
+
+static void
+gr_recipe_grid_size_allocate (GtkWidget     *widget,
+                              GtkAllocation *allocation)
+{
+        GrRecipeGrid *grid = GR_RECIPE_GRID (widget);
+        guint first, last;
+        int x;
+        guint i;
+
+        gtk_widget_set_allocation (widget, allocation);
+
+        ensure_tile_size (grid);
+
+        x = allocation->x + (allocation->width - (N_COLUMNS * grid->tile_width + (N_COLUMNS - 1) * SPACING)) / 2;
+
+        for (i = 0; i < grid->cells->len; i++) {
+                Cell *cell = &g_array_index (grid->cells, Cell, i);
+                GtkAllocation child;
+
+                child.x = x + (cell->position % N_COLUMNS) * (grid->tile_width + SPACING);
+                child.y = allocation->y + (cell->position / N_COLUMNS) * (grid->tile_height + SPACING);
+                child.width = grid->tile_width;
+                child.height = grid->tile_height;
+
+                gtk_widget_size_allocate (cell->tile, &child);
+        }
+
+        /* The grid may have moved within the scrolled window */
+        get_visible_range (grid, &first, &last);
+        if (grid->cells->len != last - first ||
+            (last > first && g_array_index (grid->cells, Cell, 0).position != first))
+                queue_update (grid);
+}
+
+static void
+gr_recipe_grid_forall (GtkContainer *container,
+                       gboolean      include_internals,
+                       GtkCallback   callback,
+                       gpointer      data)
+{
+        GrRecipeGrid *grid = GR_RECIPE_GRID (container);
+        g_autoptr(GPtrArray) children = NULL;
+        guint i;
+
+        /* The callback may remove children */
+        children = g_ptr_array_new ();
+        for (i = 0; i < grid->cells->len; i++)
+                g_ptr_array_add (children, g_array_index (grid->cells, Cell, i).tile);
+        for (i = 0; i < grid->pool->len; i++)
+                g_ptr_array_add (children, g_ptr_array_index (grid->pool, i));
+
+        for (i = 0; i < children->len; i++)
+                callback (g_ptr_array_index (children, i), data);
+}
+
+static void
+gr_recipe_grid_add_widget (GtkContainer *container,
+                           GtkWidget    *widget)
+{
+        g_warning ("Can't add children to a GrRecipeGrid, use gr_recipe_grid_add()");
+}
+
+static void
+gr_recipe_grid_remove_widget (GtkContainer *container,
+                              GtkWidget    *widget)
+{
+        GrRecipeGrid *grid = GR_RECIPE_GRID (container);
+        guint i;
+
+        for (i = 0; i < grid->cells->len; i++) {
+                if (g_array_index (grid->cells, Cell, i).tile == widget) {
+                        g_array_remove_index (grid->cells, i);
+                        break;
+                }
+        }
+
+        g_ptr_array_remove (grid->pool, widget);
+
+        gtk_widget_unparent (widget);
+}
+
+static void
+gr_recipe_grid_dispose (GObject *object)
+{
+        GrRecipeGrid *grid = GR_RECIPE_GRID (object);
+
+        if (grid->update_id) {
+                g_source_remove (grid->update_id);
+                grid->update_id = 0;
+        }
+
+        set_vadjustment (grid, NULL);
+
+        if (grid->model) {
+                g_signal_handlers_disconnect_by_func (grid->model, items_changed, grid);
+                g_clear_object (&grid->model);
+        }
+
+        G_OBJECT_CLASS (gr_recipe_grid_parent_class)->dispose (object);
+}
+
+static void
+gr_recipe_grid_finalize (GObject *object)
+{
+        GrRecipeGrid *grid = GR_RECIPE_GRID (object);
+
+        g_hash_table_unref (grid->recipes);
+        g_array_unref (grid->cells);
+        g_ptr_array_unref (grid->pool);
+
+        G_OBJECT_CLASS (gr_recipe_grid_parent_class)->finalize (object);
+}
+
+static void
+gr_recipe_grid_init (GrRecipeGrid *grid)
+{
+        gtk_widget_set_has_window (GTK_WIDGET (grid), FALSE);
+
+        grid->model = g_list_store_new (GR_TYPE_RECIPE);
+        g_signal_connect (grid->model, "items-changed", G_CALLBACK (items_changed), grid);
+        grid->recipes = g_hash_table_new_full (NULL, NULL, NULL, sort_key_free);
+        grid->cells = g_array_new (FALSE, FALSE, sizeof (Cell));
+        grid->pool = g_ptr_array_new ();
+        grid->sort = SORT_BY_NAME;
+}
+
+static void
+gr_recipe_grid_class_init (GrRecipeGridClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+        GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+        GtkContainerClass *container_class = GTK_CONTAINER_CLASS (klass);
+
+        object_class->dispose = gr_recipe_grid_dispose;
+        object_class->finalize = gr_recipe_grid_finalize;
+
+        widget_class->map = gr_recipe_grid_map;
+        widget_class->unmap = gr_recipe_grid_unmap;
+        widget_class->get_preferred_width = gr_recipe_grid_get_preferred_width;
+        widget_class->get_preferred_height = gr_recipe_grid_get_preferred_height;
+        widget_class->size_allocate = gr_recipe_grid_size_allocate;
+
+        container_class->add = gr_recipe_grid_add_widget;
+        container_class->remove = gr_recipe_grid_remove_widget;
+        container_class->forall = gr_recipe_grid_forall;
+}
+
+GtkWidget *
+gr_recipe_grid_new (void)
+{
+        return g_object_new (GR_TYPE_RECIPE_GRID, NULL);
+}
+
+void
+gr_recipe_grid_set_sort (GrRecipeGrid *grid,
+                         GrSortKey     sort)
+{
+        if (grid->sort == sort)
+                return;
+
+        grid->sort = sort;
+        g_list_store_sort (grid->model, compare_recipes, grid);
+}
+
+void
+gr_recipe_grid_set_show_shared (GrRecipeGrid *grid,
+                                gboolean      show_shared)
+{
+        guint i;
+
+        grid->show_shared = show_shared;
+
+        for (i = 0; i < grid->cells->len; i++)
+                gr_recipe_tile_set_show_shared (GR_RECIPE_TILE (g_array_index (grid->cells, Cell, i).tile), show_shared);
+}
+
+void
+gr_recipe_grid_add (GrRecipeGrid *grid,
+                    GrRecipe     *recipe)
+{
+        if (g_hash_table_contains (grid->recipes, recipe))
+                return;
+
+        g_hash_table_insert (grid->recipes, recipe, sort_key_new (recipe));
+        g_list_store_insert_sorted (grid->model, recipe, compare_recipes, grid);
+}
+
+/* Binary search for the first item that doesn't sort before @recipe,
+ * then look at the items that sort the same.
+ */
+static gboolean
+find_position (GrRecipeGrid *grid,
+               GrRecipe     *recipe,
+               guint        *position)
+{
+        GListModel *model = G_LIST_MODEL (grid->model);
+        guint lo, hi;
+        guint i;
+
+        lo = 0;
+        hi = get_n_items (grid);
+        while (lo < hi) {
+                guint mid = lo + (hi - lo) / 2;
+                g_autoptr(GrRecipe) item = g_list_model_get_item (model, mid);
+
+                if (compare_recipes (item, recipe, grid) < 0)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        for (i = lo; i < get_n_items (grid); i++) {
+                g_autoptr(GrRecipe) item = g_list_model_get_item (model, i);
+
+                if (item == recipe) {
+                        *position = i;
+                        return TRUE;
+                }
+
+                if (compare_recipes (item, recipe, grid) != 0)
+                        break;
+        }
+
+        return FALSE;
+}
+
+void
+gr_recipe_grid_remove_recipe (GrRecipeGrid *grid,
+                              GrRecipe     *recipe)
+{
+        guint position;
+        gboolean found;
+
+        if (!g_hash_table_contains (grid->recipes, recipe))
+                return;
+
+        found = find_position (grid, recipe, &position);
+        g_hash_table_remove (grid->recipes, recipe);
+        if (found)
+                g_list_store_remove (grid->model, position);
+}
+
+/**
+ * gr_recipe_grid_update:
+ * @grid: a #GrRecipeGrid
+ * @recipe: a #GrRecipe in @grid
+ *
+ * Moves @recipe to its new place after it has been changed, and
+ * updates its tile, if it has one.
+ */
+void
+gr_recipe_grid_update (GrRecipeGrid *grid,
+                       GrRecipe     *recipe)
+{
+        guint i;
+
+        if (!g_hash_table_contains (grid->recipes, recipe))
+                return;
+
+        for (i = 0; i < grid->cells->len; i++) {
+                GtkWidget *tile = g_array_index (grid->cells, Cell, i).tile;
+
+                if (gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile)) == recipe) {
+                        gr_recipe_tile_update (GR_RECIPE_TILE (tile));
+                        break;
+                }
+        }
+
+        g_object_ref (recipe);
+        gr_recipe_grid_remove_recipe (grid, recipe);
+        gr_recipe_grid_add (grid, recipe);
+        g_object_unref (recipe);
+}
+
+gboolean
+gr_recipe_grid_contains (GrRecipeGrid *grid,
+                         GrRecipe     *recipe)
+{
+        return g_hash_table_contains (grid->recipes, recipe);
+}
+
+void
+gr_recipe_grid_clear (GrRecipeGrid *grid)
+{
+        g_hash_table_remove_all (grid->recipes);
+        g_list_store_remove_all (grid->model);
+}
+
+/**
+ * gr_recipe_grid_get_model:
+ * @grid: a #GrRecipeGrid
+ *
+ * Returns the recipes in @grid, in the order they are shown.
+ *
+ * Returns: (transfer none): a #GListModel of #GrRecipe
+ */
+GListModel *
+gr_recipe_grid_get_model (GrRecipeGrid *grid)
+{
+        return G_LIST_MODEL (grid->model);
+}
@@ -92,6 +92,7 @@ struct _GrRecipeImporter
         GDateTime *recipe_mtime;
 
         GList *recipes;
+        gboolean in_batch;
 };
 
 G_DEFINE_TYPE (GrRecipeImporter, gr_recipe_importer, G_TYPE_OBJECT)
@@ -181,6 +182,12 @@ gr_recipe_importer_new (GtkWindow *parent)
 static void
 cleanup_import (GrRecipeImporter *importer)
 {
+        /* Recipes of an import that didn't finish are taken out again */
+        if (importer->in_batch) {
+                gr_recipe_store_abort_batch (gr_recipe_store_get ());
+                importer->in_batch = FALSE;
+        }
+
 #ifdef ENABLE_AUTOAR
         g_clear_object (&importer->extractor);
 #endif
@@ -474,6 +481,8 @@ next:
         id = importer->recipe_ids[importer->current_recipe];
 
         if (id == NULL) {
+                gr_recipe_store_commit_batch (store);
+                importer->in_batch = FALSE;
                 g_signal_emit (importer, done_signal, 0, importer->recipes);
                 cleanup_import (importer);
                 return TRUE;
@@ -568,6 +577,9 @@ import_recipes (GrRecipeImporter *importer)
         importer->recipes_keyfile = g_key_file_ref (keyfile);
         importer->recipe_ids = g_key_file_get_groups (keyfile, NULL);
 
+        gr_recipe_store_begin_batch (gr_recipe_store_get ());
+        importer->in_batch = TRUE;
+
         return import_next_recipe (importer);
 }
 
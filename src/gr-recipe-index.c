@@ -0,0 +1,381 @@
+/* gr-recipe-index.c:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "gr-recipe-index.h"
+
+/* A trigram index for substring search
+ * ------------------------------------
+ *
+ * Every text that is added to the index is broken up into byte trigrams,
+ * and for each trigram we keep a posting list of the items whose texts
+ * contain it. A text can only contain a term if it contains all of the
+ * trigrams of the term, so intersecting the posting lists of a term's
+ * trigrams gives a superset of the items that match it.
+ *
+ * Items are identified by small integer ordinals, and posting lists are
+ * kept as sorted arrays of ordinals, so they can be intersected by merging.
+ * We remember the trigrams of each item, so that it can be removed from
+ * the index even when its texts have changed in the meantime.
+ *
+ * Terms shorter than a trigram can't be looked up, and don't
+ * narrow the result.
+ */
+
+struct _GrRecipeIndex
+{
+        GHashTable *postings;      /* trigram -> GArray of sorted ordinals */
+        GHashTable *ordinals;      /* item -> ordinal + 1 */
+        GPtrArray  *items;         /* ordinal -> item, or NULL if unused */
+        GPtrArray  *trigrams;      /* ordinal -> GArray of trigrams */
+        GArray     *free_ordinals;
+};
+
+#define TRIGRAM(s) (((guint32)(guchar)(s)[0] << 16) | ((guint32)(guchar)(s)[1] << 8) | (guint32)(guchar)(s)[2])
+
+static void
+free_array (gpointer data)
+{
+        if (data)
+                g_array_unref (data);
+}
+
+GrRecipeIndex *
+gr_recipe_index_new (void)
+{
+        GrRecipeIndex *index;
+
+        index = g_new0 (GrRecipeIndex, 1);
+        index->postings = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, free_array);
+        index->ordinals = g_hash_table_new (g_direct_hash, g_direct_equal);
+        index->items = g_ptr_array_new ();
+        index->trigrams = g_ptr_array_new_with_free_func (free_array);
+        index->free_ordinals = g_array_new (FALSE, FALSE, sizeof (guint));
+
+        return index;
+}
+
+void
+gr_recipe_index_free (GrRecipeIndex *index)
+{
+        g_hash_table_unref (index->postings);
+        g_hash_table_unref (index->ordinals);
+        g_ptr_array_unref (index->items);
+        g_ptr_array_unref (index->trigrams);
+        g_array_unref (index->free_ordinals);
+        g_free (index);
+}
+
+void
+gr_recipe_index_clear (GrRecipeIndex *index)
+{
+        g_hash_table_remove_all (index->postings);
+        g_hash_table_remove_all (index->ordinals);
+        g_ptr_array_set_size (index->items, 0);
+        g_ptr_array_set_size (index->trigrams, 0);
+        g_array_set_size (index->free_ordinals, 0);
+}
+
+/* Returns the position of ordinal in the sorted array, or
+ * the position where it would have to be inserted.
+ */
+static guint
+posting_search (GArray *posting,
+                guint   ordinal,
+                gboolean *found)
+{
+        guint lo, hi;
+
+        lo = 0;
+        hi = posting->len;
+        while (lo < hi) {
+                guint mid = lo + (hi - lo) / 2;
+                guint value = g_array_index (posting, guint, mid);
+
+                if (value == ordinal) {
+                        *found = TRUE;
+                        return mid;
+                }
+                else if (value < ordinal)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        *found = FALSE;
+        return lo;
+}
+
+static void
+posting_insert (GrRecipeIndex *index,
+                guint32        trigram,
+                guint          ordinal)
+{
+        GArray *posting;
+        gboolean found;
+        guint pos;
+
+        posting = g_hash_table_lookup (index->postings, GUINT_TO_POINTER (trigram));
+        if (!posting) {
+                posting = g_array_new (FALSE, FALSE, sizeof (guint));
+                g_hash_table_insert (index->postings, GUINT_TO_POINTER (trigram), posting);
+        }
+
+        /* The common case is appending a new, largest ordinal */
+        if (posting->len == 0 || g_array_index (posting, guint, posting->len - 1) < ordinal) {
+                g_array_append_val (posting, ordinal);
+                return;
+        }
+
+        pos = posting_search (posting, ordinal, &found);
+        if (!found)
+                g_array_insert_val (posting, pos, ordinal);
+}
+
+static void
+posting_remove (GrRecipeIndex *index,
+                guint32        trigram,
+                guint          ordinal)
+{
+        GArray *posting;
+        gboolean found;
+        guint pos;
+
+        posting = g_hash_table_lookup (index->postings, GUINT_TO_POINTER (trigram));
+        if (!posting)
+                return;
+
+        pos = posting_search (posting, ordinal, &found);
+        if (found)
+                g_array_remove_index (posting, pos);
+
+        if (posting->len == 0)
+                g_hash_table_remove (index->postings, GUINT_TO_POINTER (trigram));
+}
+
+static void
+collect_trigrams (const char *text,
+                  GHashTable *set)
+{
+        gsize len, i;
+
+        if (text == NULL)
+                return;
+
+        len = strlen (text);
+        for (i = 0; i + 3 <= len; i++)
+                g_hash_table_add (set, GUINT_TO_POINTER (TRIGRAM (text + i)));
+}
+
+/**
+ * gr_recipe_index_add:
+ * @index: a #GrRecipeIndex
+ * @item: the item to add
+ * @texts: (array zero-terminated=1): the texts to index @item under
+ *
+ * Adds @item to the index. If it is already indexed, it is reindexed
+ * with the new texts. The index does not take a reference on @item.
+ */
+void
+gr_recipe_index_add (GrRecipeIndex  *index,
+                     gpointer        item,
+                     const char    **texts)
+{
+        g_autoptr(GHashTable) set = NULL;
+        GHashTableIter iter;
+        gpointer key;
+        GArray *trigrams;
+        guint ordinal;
+        int i;
+
+        gr_recipe_index_remove (index, item);
+
+        if (index->free_ordinals->len > 0) {
+                ordinal = g_array_index (index->free_ordinals, guint, index->free_ordinals->len - 1);
+                g_array_set_size (index->free_ordinals, index->free_ordinals->len - 1);
+                g_ptr_array_index (index->items, ordinal) = item;
+        }
+        else {
+                ordinal = index->items->len;
+                g_ptr_array_add (index->items, item);
+                g_ptr_array_add (index->trigrams, NULL);
+        }
+
+        g_hash_table_insert (index->ordinals, item, GUINT_TO_POINTER (ordinal + 1));
+
+        set = g_hash_table_new (g_direct_hash, g_direct_equal);
+        for (i = 0; texts[i]; i++)
+                collect_trigrams (texts[i], set);
+
+        trigrams = g_array_sized_new (FALSE, FALSE, sizeof (guint32), g_hash_table_size (set));
+        g_hash_table_iter_init (&iter, set);
+        while (g_hash_table_iter_next (&iter, &key, NULL)) {
+                guint32 trigram = GPOINTER_TO_UINT (key);
+
+                g_array_append_val (trigrams, trigram);
+                posting_insert (index, trigram, ordinal);
+        }
+
+        g_ptr_array_index (index->trigrams, ordinal) = trigrams;
+}
+
+void
+gr_recipe_index_remove (GrRecipeIndex *index,
+                        gpointer       item)
+{
+        GArray *trigrams;
+        guint ordinal;
+        guint i;
+
+        ordinal = GPOINTER_TO_UINT (g_hash_table_lookup (index->ordinals, item));
+        if (ordinal == 0)
+                return;
+
+        ordinal--;
+
+        trigrams = g_ptr_array_index (index->trigrams, ordinal);
+        for (i = 0; i < trigrams->len; i++)
+                posting_remove (index, g_array_index (trigrams, guint32, i), ordinal);
+
+        g_array_unref (trigrams);
+        g_ptr_array_index (index->trigrams, ordinal) = NULL;
+        g_ptr_array_index (index->items, ordinal) = NULL;
+        g_hash_table_remove (index->ordinals, item);
+        g_array_append_val (index->free_ordinals, ordinal);
+}
+
+static const char *
+get_indexed_text (const char *term)
+{
+        const char *prefixes[] = { "i+:", "i-:", "by:", "se:", "me:", "di:", "s+:", "s-:", NULL };
+        int i;
+
+        /* Names are part of the indexed text */
+        if (g_str_has_prefix (term, "na:"))
+                return term + 3;
+
+        for (i = 0; prefixes[i]; i++) {
+                if (g_str_has_prefix (term, prefixes[i]))
+                        return NULL;
+        }
+
+        return term;
+}
+
+static int
+compare_length (gconstpointer a,
+                gconstpointer b)
+{
+        GArray *pa = *(GArray **)a;
+        GArray *pb = *(GArray **)b;
+
+        return (int)pa->len - (int)pb->len;
+}
+
+/* Intersects the sorted arrays a and b into a */
+static void
+intersect (GArray *a,
+           GArray *b)
+{
+        guint i, j, k;
+
+        for (i = j = k = 0; i < a->len && j < b->len; ) {
+                guint x = g_array_index (a, guint, i);
+                guint y = g_array_index (b, guint, j);
+
+                if (x < y)
+                        i++;
+                else if (x > y)
+                        j++;
+                else {
+                        g_array_index (a, guint, k++) = x;
+                        i++;
+                        j++;
+                }
+        }
+
+        g_array_set_size (a, k);
+}
+
+/**
+ * gr_recipe_index_lookup:
+ * @index: a #GrRecipeIndex
+ * @terms: (array zero-terminated=1): search terms, as passed to gr_recipe_query_new()
+ *
+ * Finds the candidates for matching @terms. Every item that matches all
+ * terms is among the candidates, but candidates may not match, so they
+ * still need to be checked.
+ *
+ * Returns: (transfer container) (nullable): the candidates, or %NULL
+ *     if none of the terms can be looked up in the index
+ */
+GPtrArray *
+gr_recipe_index_lookup (GrRecipeIndex  *index,
+                        const char    **terms)
+{
+        g_autoptr(GPtrArray) postings = NULL;
+        g_autoptr(GArray) result = NULL;
+        GPtrArray *items;
+        int i;
+        guint j;
+
+        postings = g_ptr_array_new ();
+
+        for (i = 0; terms[i]; i++) {
+                const char *text;
+                gsize len;
+
+                text = get_indexed_text (terms[i]);
+                if (text == NULL)
+                        continue;
+
+                len = strlen (text);
+                for (j = 0; j + 3 <= len; j++) {
+                        GArray *posting;
+
+                        posting = g_hash_table_lookup (index->postings, GUINT_TO_POINTER (TRIGRAM (text + j)));
+                        if (!posting)
+                                return g_ptr_array_new ();
+
+                        g_ptr_array_add (postings, posting);
+                }
+        }
+
+        if (postings->len == 0)
+                return NULL;
+
+        /* Start with the shortest list, to keep the intermediate results small */
+        g_ptr_array_sort (postings, compare_length);
+
+        result = g_array_sized_new (FALSE, FALSE, sizeof (guint), ((GArray *)g_ptr_array_index (postings, 0))->len);
+        g_array_append_vals (result, ((GArray *)g_ptr_array_index (postings, 0))->data, ((GArray *)g_ptr_array_index (postings, 0))->len);
+
+        for (j = 1; j < postings->len && result->len > 0; j++)
+                intersect (result, g_ptr_array_index (postings, j));
+
+        items = g_ptr_array_sized_new (result->len);
+        for (j = 0; j < result->len; j++)
+                g_ptr_array_add (items, g_ptr_array_index (index->items, g_array_index (result, guint, j)));
+
+        return items;
+}
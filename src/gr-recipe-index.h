@@ -0,0 +1,43 @@
+/* gr-recipe-index.h:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GrRecipeIndex GrRecipeIndex;
+
+GrRecipeIndex *gr_recipe_index_new    (void);
+void           gr_recipe_index_free   (GrRecipeIndex  *index);
+
+void           gr_recipe_index_add    (GrRecipeIndex  *index,
+                                       gpointer        item,
+                                       const char    **texts);
+void           gr_recipe_index_remove (GrRecipeIndex  *index,
+                                       gpointer        item);
+void           gr_recipe_index_clear  (GrRecipeIndex  *index);
+GPtrArray     *gr_recipe_index_lookup (GrRecipeIndex  *index,
+                                       const char    **terms);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrRecipeIndex, gr_recipe_index_free)
+
+G_END_DECLS
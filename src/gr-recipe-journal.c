@@ -0,0 +1,286 @@
+/* gr-recipe-journal.c:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+#include "gr-recipe-journal.h"
+
+/* The recipe journal
+ * ------------------
+ *
+ * The journal is a sequence of entries, each a keyfile with a single
+ * group that holds an Id key plus either the complete keys of the recipe,
+ * or a Removed key. Since values can't contain newlines, complete entries
+ * are terminated by an empty line, which lets us recognize an entry
+ * that was cut short by a crash while it was being appended.
+ */
+
+/**
+ * gr_recipe_journal_add_entry:
+ * @entries: the entries to append to
+ * @entry: a keyfile with a single group for the entry
+ *
+ * Appends @entry to @entries, terminated by an empty line.
+ */
+void
+gr_recipe_journal_add_entry (GString  *entries,
+                             GKeyFile *entry)
+{
+        g_autofree char *data = NULL;
+
+        data = g_key_file_to_data (entry, NULL, NULL);
+        g_string_append (entries, data);
+        g_string_append_c (entries, '\n');
+}
+
+/**
+ * gr_recipe_journal_append:
+ * @path: the journal file
+ * @entries: entries, as built by gr_recipe_journal_add_entry()
+ * @length: the length of @entries
+ * @error: return location for an error
+ *
+ * Appends @entries to the journal at @path, creating it if needed.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+gr_recipe_journal_append (const char  *path,
+                          const char  *entries,
+                          gsize        length,
+                          GError     **error)
+{
+        g_autoptr(GFile) file = NULL;
+        g_autoptr(GFileOutputStream) stream = NULL;
+
+        file = g_file_new_for_path (path);
+        stream = g_file_append_to (file, G_FILE_CREATE_NONE, NULL, error);
+        if (!stream)
+                return FALSE;
+
+        if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream), entries, length, NULL, NULL, error))
+                return FALSE;
+
+        return g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, error);
+}
+
+/* Reads the journal at @path, and returns the length of the
+ * complete entries at its start, dropping a torn entry at the end.
+ */
+static gboolean
+read_entries (const char  *path,
+              char       **contents,
+              gsize       *length,
+              GError     **error)
+{
+        const char *end;
+
+        if (!g_file_get_contents (path, contents, length, error))
+                return FALSE;
+
+        end = g_strrstr_len (*contents, *length, "\n\n");
+        *length = end ? end - *contents + 2 : 0;
+
+        return TRUE;
+}
+
+static void
+apply_entry (GKeyFile *db,
+             GKeyFile *entry)
+{
+        g_autofree char *group = NULL;
+        g_autofree char *id = NULL;
+        g_auto(GStrv) keys = NULL;
+        int i;
+
+        group = g_key_file_get_start_group (entry);
+        if (!group)
+                return;
+
+        id = g_key_file_get_string (entry, group, "Id", NULL);
+        if (!id)
+                return;
+
+        g_key_file_remove_group (db, id, NULL);
+
+        if (g_key_file_get_boolean (entry, group, "Removed", NULL))
+                return;
+
+        keys = g_key_file_get_keys (entry, group, NULL, NULL);
+        for (i = 0; keys[i]; i++) {
+                g_autofree char *value = NULL;
+
+                if (strcmp (keys[i], "Id") == 0)
+                        continue;
+
+                value = g_key_file_get_value (entry, group, keys[i], NULL);
+                g_key_file_set_value (db, id, keys[i], value);
+        }
+}
+
+/**
+ * gr_recipe_journal_apply:
+ * @db: the recipe db to apply the journal to
+ * @path: the journal file
+ * @error: return location for an error
+ *
+ * Replays the entries in the journal at @path on top of @db, in order.
+ * A torn entry at the end of the journal is ignored.
+ *
+ * Returns: %TRUE if the journal could be read
+ */
+gboolean
+gr_recipe_journal_apply (GKeyFile    *db,
+                         const char  *path,
+                         GError     **error)
+{
+        g_autofree char *contents = NULL;
+        gsize length;
+        const char *p;
+        const char *end;
+
+        if (!read_entries (path, &contents, &length, error))
+                return FALSE;
+
+        /* Entry names repeat across compactions and runs, and groups
+         * of the same name would be merged if we loaded the journal as
+         * a whole. So load each entry by itself.
+         */
+        for (p = contents; p < contents + length; p = end + 2) {
+                g_autoptr(GKeyFile) entry = NULL;
+
+                end = g_strstr_len (p, contents + length - p, "\n\n");
+
+                entry = g_key_file_new ();
+                if (!g_key_file_load_from_data (entry, p, end - p + 1, G_KEY_FILE_NONE, error))
+                        return FALSE;
+
+                apply_entry (db, entry);
+        }
+
+        return TRUE;
+}
+
+/**
+ * gr_recipe_journal_concat:
+ * @path: the journal to append to
+ * @journal: the journal to move to the end of @path
+ * @error: return location for an error
+ *
+ * Moves the entries of @journal to the end of the journal at @path,
+ * and removes @journal. Torn entries at the end of either journal
+ * are dropped, so the result only holds complete entries. Nothing
+ * happens if @journal doesn't exist.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+gr_recipe_journal_concat (const char  *path,
+                          const char  *journal,
+                          GError     **error)
+{
+        g_autoptr(GError) local_error = NULL;
+        g_autoptr(GString) entries = NULL;
+        g_autofree char *contents = NULL;
+        g_autofree char *more = NULL;
+        gsize length;
+        gsize more_length;
+
+        if (!read_entries (journal, &more, &more_length, &local_error)) {
+                if (g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+                        return TRUE;
+                g_propagate_error (error, g_steal_pointer (&local_error));
+                return FALSE;
+        }
+
+        if (!read_entries (path, &contents, &length, &local_error)) {
+                if (!g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+                        g_propagate_error (error, g_steal_pointer (&local_error));
+                        return FALSE;
+                }
+                length = 0;
+        }
+
+        entries = g_string_sized_new (length + more_length);
+        if (length > 0)
+                g_string_append_len (entries, contents, length);
+        g_string_append_len (entries, more, more_length);
+
+        if (!g_file_set_contents (path, entries->str, entries->len, error))
+                return FALSE;
+
+        g_unlink (journal);
+
+        return TRUE;
+}
+
+/**
+ * gr_recipe_journal_compact:
+ * @dir: the directory containing recipes.db
+ * @journals: (array zero-terminated=1): the journals to fold in, oldest first
+ * @error: return location for an error
+ *
+ * Applies @journals to recipes.db in @dir, writes it back and removes
+ * the journals. Journals that don't exist are skipped.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+gr_recipe_journal_compact (const char  *dir,
+                           const char **journals,
+                           GError     **error)
+{
+        g_autoptr(GKeyFile) db = NULL;
+        g_autoptr(GError) local_error = NULL;
+        g_autofree char *path = NULL;
+        int i;
+
+        path = g_build_filename (dir, "recipes.db", NULL);
+
+        db = g_key_file_new ();
+        if (!g_key_file_load_from_file (db, path, G_KEY_FILE_NONE, &local_error)) {
+                if (!g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+                        g_propagate_error (error, g_steal_pointer (&local_error));
+                        return FALSE;
+                }
+                g_key_file_set_integer (db, "Metadata", "Version", 1);
+        }
+
+        for (i = 0; journals[i]; i++) {
+                g_clear_error (&local_error);
+                if (!gr_recipe_journal_apply (db, journals[i], &local_error) &&
+                    !g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+                        g_propagate_error (error, g_steal_pointer (&local_error));
+                        return FALSE;
+                }
+        }
+
+        if (!g_key_file_save_to_file (db, path, error))
+                return FALSE;
+
+        for (i = 0; journals[i]; i++)
+                g_unlink (journals[i]);
+
+        return TRUE;
+}
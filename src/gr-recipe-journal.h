@@ -0,0 +1,43 @@
+/* gr-recipe-journal.h:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void     gr_recipe_journal_add_entry (GString      *entries,
+                                      GKeyFile     *entry);
+gboolean gr_recipe_journal_append    (const char   *path,
+                                      const char   *entries,
+                                      gsize         length,
+                                      GError      **error);
+gboolean gr_recipe_journal_apply     (GKeyFile     *db,
+                                      const char   *path,
+                                      GError      **error);
+gboolean gr_recipe_journal_concat    (const char   *path,
+                                      const char   *journal,
+                                      GError      **error);
+gboolean gr_recipe_journal_compact   (const char   *dir,
+                                      const char  **journals,
+                                      GError      **error);
+
+G_END_DECLS
@@ -0,0 +1,461 @@
+/* gr-recipe-overview.c:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "gr-recipe-overview.h"
+
+/* Recipe overview
+ * ---------------
+ *
+ * The landing pages need to know which chefs, cuisines, seasons and
+ * diets have recipes, and which of today's recipes and picks exist,
+ * without looking at every recipe. We keep counts of recipes per
+ * author, per contributing author, per cuisine, per season and per
+ * combination of diets, and the sets of featured items.
+ *
+ * Adding, changing or removing an item costs a handful of hash table
+ * operations, and returns what the change means for the pages: which
+ * of the sets of keys gained or lost a member, and whether a featured
+ * item was involved. Changes that don't affect any of this, such as
+ * marking a recipe as favorite, return 0.
+ *
+ * Since items are changed in place, we remember what each item was
+ * counted under, so we can take it out again.
+ */
+
+#define N_DIET_MASKS 32
+
+typedef struct {
+        char *id;
+        char *author;
+        char *cuisine;
+        char *season;
+        GrDiets diets;
+        gboolean contributed;
+} Counted;
+
+struct _GrRecipeOverview
+{
+        GHashTable *counted;       /* item -> Counted */
+        GHashTable *authors;       /* key -> count */
+        GHashTable *contributors;
+        GHashTable *cuisines;
+        GHashTable *seasons;
+        guint diet_counts[N_DIET_MASKS];
+
+        GHashTable *todays;        /* set of ids */
+        GHashTable *picks;
+        GHashTable *today_items;   /* set of items */
+        GHashTable *pick_items;
+};
+
+static void
+counted_free (gpointer data)
+{
+        Counted *counted = data;
+
+        g_free (counted->id);
+        g_free (counted->author);
+        g_free (counted->cuisine);
+        g_free (counted->season);
+        g_free (counted);
+}
+
+static GHashTable *
+count_table_new (void)
+{
+        return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+GrRecipeOverview *
+gr_recipe_overview_new (void)
+{
+        GrRecipeOverview *overview;
+
+        overview = g_new0 (GrRecipeOverview, 1);
+        overview->counted = g_hash_table_new_full (NULL, NULL, NULL, counted_free);
+        overview->authors = count_table_new ();
+        overview->contributors = count_table_new ();
+        overview->cuisines = count_table_new ();
+        overview->seasons = count_table_new ();
+        overview->todays = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        overview->picks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        overview->today_items = g_hash_table_new (NULL, NULL);
+        overview->pick_items = g_hash_table_new (NULL, NULL);
+
+        return overview;
+}
+
+void
+gr_recipe_overview_free (GrRecipeOverview *overview)
+{
+        g_hash_table_unref (overview->counted);
+        g_hash_table_unref (overview->authors);
+        g_hash_table_unref (overview->contributors);
+        g_hash_table_unref (overview->cuisines);
+        g_hash_table_unref (overview->seasons);
+        g_hash_table_unref (overview->todays);
+        g_hash_table_unref (overview->picks);
+        g_hash_table_unref (overview->today_items);
+        g_hash_table_unref (overview->pick_items);
+        g_free (overview);
+}
+
+static guint
+count_get (GHashTable *table,
+           const char *key)
+{
+        if (!key)
+                return 0;
+
+        return GPOINTER_TO_UINT (g_hash_table_lookup (table, key));
+}
+
+static void
+count_add (GHashTable *table,
+           const char *key)
+{
+        if (!key)
+                return;
+
+        g_hash_table_insert (table, g_strdup (key), GUINT_TO_POINTER (count_get (table, key) + 1));
+}
+
+static void
+count_remove (GHashTable *table,
+              const char *key)
+{
+        guint count;
+
+        if (!key)
+                return;
+
+        count = count_get (table, key);
+        if (count > 1)
+                g_hash_table_insert (table, g_strdup (key), GUINT_TO_POINTER (count - 1));
+        else
+                g_hash_table_remove (table, key);
+}
+
+/* Moves one item from @old_key to @new_key, and returns
+ * whether a key appeared or disappeared.
+ */
+static gboolean
+count_move (GHashTable *table,
+            const char *old_key,
+            const char *new_key)
+{
+        gboolean changed;
+
+        if (g_strcmp0 (old_key, new_key) == 0)
+                return FALSE;
+
+        changed = (old_key && count_get (table, old_key) == 1) ||
+                  (new_key && count_get (table, new_key) == 0);
+
+        count_remove (table, old_key);
+        count_add (table, new_key);
+
+        return changed;
+}
+
+static gboolean
+update_featured (GHashTable *ids,
+                 GHashTable *items,
+                 gpointer    item,
+                 const char *id)
+{
+        gboolean was_featured;
+        gboolean is_featured;
+
+        was_featured = g_hash_table_contains (items, item);
+        is_featured = id && g_hash_table_contains (ids, id);
+
+        if (is_featured)
+                g_hash_table_add (items, item);
+        else if (was_featured)
+                g_hash_table_remove (items, item);
+
+        /* A featured item that changed may look different */
+        return was_featured || is_featured;
+}
+
+static char *
+replace_string (char       *old,
+                const char *new)
+{
+        if (g_strcmp0 (old, new) == 0)
+                return old;
+
+        g_free (old);
+        return g_strdup (new);
+}
+
+/* Moves @item from what it was counted under to @fields, or takes
+ * it out if @fields is %NULL.
+ */
+static GrOverviewChange
+update_item (GrRecipeOverview       *overview,
+             gpointer                item,
+             const GrOverviewFields *fields)
+{
+        static const GrOverviewFields none = { NULL, };
+        const GrOverviewFields *new = fields ? fields : &none;
+        Counted *counted;
+        gboolean was_counted;
+        GrOverviewChange change = 0;
+        guint old_mask, new_mask;
+
+        counted = g_hash_table_lookup (overview->counted, item);
+        was_counted = counted != NULL;
+
+        if (!was_counted && !fields)
+                return 0;
+
+        if (!was_counted) {
+                counted = g_new0 (Counted, 1);
+                g_hash_table_insert (overview->counted, item, counted);
+        }
+
+        old_mask = counted->diets % N_DIET_MASKS;
+        new_mask = new->diets % N_DIET_MASKS;
+        if (!was_counted || !fields || old_mask != new_mask) {
+                if (was_counted) {
+                        if (overview->diet_counts[old_mask] == 1)
+                                change |= GR_OVERVIEW_DIETS;
+                        overview->diet_counts[old_mask]--;
+                }
+                if (fields) {
+                        if (overview->diet_counts[new_mask] == 0)
+                                change |= GR_OVERVIEW_DIETS;
+                        overview->diet_counts[new_mask]++;
+                }
+        }
+
+        if (count_move (overview->authors, counted->author, new->author))
+                change |= GR_OVERVIEW_CHEFS;
+        if (count_move (overview->contributors,
+                        counted->contributed ? counted->author : NULL,
+                        new->contributed ? new->author : NULL))
+                change |= GR_OVERVIEW_CONTRIBUTORS;
+        if (count_move (overview->cuisines, counted->cuisine, new->cuisine))
+                change |= GR_OVERVIEW_CUISINES;
+        if (count_move (overview->seasons, counted->season, new->season))
+                change |= GR_OVERVIEW_SEASONS;
+
+        if (update_featured (overview->todays, overview->today_items, item, new->id))
+                change |= GR_OVERVIEW_TODAYS;
+        if (update_featured (overview->picks, overview->pick_items, item, new->id))
+                change |= GR_OVERVIEW_PICKS;
+
+        if (!fields) {
+                g_hash_table_remove (overview->counted, item);
+                return change;
+        }
+
+        counted->id = replace_string (counted->id, new->id);
+        counted->author = replace_string (counted->author, new->author);
+        counted->cuisine = replace_string (counted->cuisine, new->cuisine);
+        counted->season = replace_string (counted->season, new->season);
+        counted->diets = new->diets;
+        counted->contributed = new->contributed;
+
+        return change;
+}
+
+/**
+ * gr_recipe_overview_add:
+ * @overview: a #GrRecipeOverview
+ * @item: the item
+ * @fields: what to count @item under
+ *
+ * Adds @item to @overview, or updates it if it is already counted.
+ *
+ * Returns: the parts of the overview that changed
+ */
+GrOverviewChange
+gr_recipe_overview_add (GrRecipeOverview       *overview,
+                        gpointer                item,
+                        const GrOverviewFields *fields)
+{
+        return update_item (overview, item, fields);
+}
+
+/**
+ * gr_recipe_overview_remove:
+ * @overview: a #GrRecipeOverview
+ * @item: the item
+ *
+ * Removes @item from @overview.
+ *
+ * Returns: the parts of the overview that changed
+ */
+GrOverviewChange
+gr_recipe_overview_remove (GrRecipeOverview *overview,
+                           gpointer          item)
+{
+        return update_item (overview, item, NULL);
+}
+
+void
+gr_recipe_overview_clear (GrRecipeOverview *overview)
+{
+        g_hash_table_remove_all (overview->counted);
+        g_hash_table_remove_all (overview->authors);
+        g_hash_table_remove_all (overview->contributors);
+        g_hash_table_remove_all (overview->cuisines);
+        g_hash_table_remove_all (overview->seasons);
+        memset (overview->diet_counts, 0, sizeof (overview->diet_counts));
+        g_hash_table_remove_all (overview->today_items);
+        g_hash_table_remove_all (overview->pick_items);
+}
+
+static void
+set_ids (GHashTable         *ids,
+         const char * const *strv)
+{
+        int i;
+
+        g_hash_table_remove_all (ids);
+        for (i = 0; strv && strv[i]; i++)
+                g_hash_table_add (ids, g_strdup (strv[i]));
+}
+
+/**
+ * gr_recipe_overview_set_featured:
+ * @overview: a #GrRecipeOverview
+ * @todays: (nullable): the ids of today's recipes
+ * @picks: (nullable): the ids of the picks
+ *
+ * Sets the ids of the featured items. This looks at every item.
+ */
+void
+gr_recipe_overview_set_featured (GrRecipeOverview   *overview,
+                                 const char * const *todays,
+                                 const char * const *picks)
+{
+        GHashTableIter iter;
+        gpointer item;
+        Counted *counted;
+
+        set_ids (overview->todays, todays);
+        set_ids (overview->picks, picks);
+
+        g_hash_table_remove_all (overview->today_items);
+        g_hash_table_remove_all (overview->pick_items);
+
+        g_hash_table_iter_init (&iter, overview->counted);
+        while (g_hash_table_iter_next (&iter, &item, (gpointer *)&counted)) {
+                update_featured (overview->todays, overview->today_items, item, counted->id);
+                update_featured (overview->picks, overview->pick_items, item, counted->id);
+        }
+}
+
+guint
+gr_recipe_overview_get_chef_count (GrRecipeOverview *overview,
+                                   const char       *author)
+{
+        return count_get (overview->authors, author);
+}
+
+guint
+gr_recipe_overview_get_cuisine_count (GrRecipeOverview *overview,
+                                      const char       *cuisine)
+{
+        return count_get (overview->cuisines, cuisine);
+}
+
+guint
+gr_recipe_overview_get_season_count (GrRecipeOverview *overview,
+                                     const char       *season)
+{
+        return count_get (overview->seasons, season);
+}
+
+gboolean
+gr_recipe_overview_has_diet (GrRecipeOverview *overview,
+                             GrDiets           diet)
+{
+        int mask;
+
+        for (mask = 0; mask < N_DIET_MASKS; mask++) {
+                if ((mask & diet) == diet && overview->diet_counts[mask] > 0)
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
+char **
+gr_recipe_overview_get_contributors (GrRecipeOverview *overview,
+                                     guint            *length)
+{
+        return (char **)g_hash_table_get_keys_as_array (overview->contributors, length);
+}
+
+char **
+gr_recipe_overview_get_cuisines (GrRecipeOverview *overview,
+                                 guint            *length)
+{
+        return (char **)g_hash_table_get_keys_as_array (overview->cuisines, length);
+}
+
+static GPtrArray *
+get_items (GHashTable *items)
+{
+        GPtrArray *result;
+        GHashTableIter iter;
+        gpointer item;
+
+        result = g_ptr_array_sized_new (g_hash_table_size (items));
+
+        g_hash_table_iter_init (&iter, items);
+        while (g_hash_table_iter_next (&iter, &item, NULL))
+                g_ptr_array_add (result, item);
+
+        return result;
+}
+
+/**
+ * gr_recipe_overview_get_todays:
+ * @overview: a #GrRecipeOverview
+ *
+ * Returns: (transfer container): the items that are today's recipes
+ */
+GPtrArray *
+gr_recipe_overview_get_todays (GrRecipeOverview *overview)
+{
+        return get_items (overview->today_items);
+}
+
+/**
+ * gr_recipe_overview_get_picks:
+ * @overview: a #GrRecipeOverview
+ *
+ * Returns: (transfer container): the items that are picks
+ */
+GPtrArray *
+gr_recipe_overview_get_picks (GrRecipeOverview *overview)
+{
+        return get_items (overview->pick_items);
+}
@@ -0,0 +1,79 @@
+/* gr-recipe-overview.h:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include "gr-diet.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+        GR_OVERVIEW_CHEFS        = 1 << 0,
+        GR_OVERVIEW_CONTRIBUTORS = 1 << 1,
+        GR_OVERVIEW_CUISINES     = 1 << 2,
+        GR_OVERVIEW_SEASONS      = 1 << 3,
+        GR_OVERVIEW_DIETS        = 1 << 4,
+        GR_OVERVIEW_TODAYS       = 1 << 5,
+        GR_OVERVIEW_PICKS        = 1 << 6
+} GrOverviewChange;
+
+typedef struct {
+        const char *id;
+        const char *author;
+        const char *cuisine;
+        const char *season;
+        GrDiets     diets;
+        gboolean    contributed;
+} GrOverviewFields;
+
+typedef struct _GrRecipeOverview GrRecipeOverview;
+
+GrRecipeOverview *gr_recipe_overview_new          (void);
+void              gr_recipe_overview_free         (GrRecipeOverview       *overview);
+
+GrOverviewChange  gr_recipe_overview_add          (GrRecipeOverview       *overview,
+                                                   gpointer                item,
+                                                   const GrOverviewFields *fields);
+GrOverviewChange  gr_recipe_overview_remove       (GrRecipeOverview       *overview,
+                                                   gpointer                item);
+void              gr_recipe_overview_clear        (GrRecipeOverview       *overview);
+void              gr_recipe_overview_set_featured (GrRecipeOverview       *overview,
+                                                   const char * const     *todays,
+                                                   const char * const     *picks);
+
+guint             gr_recipe_overview_get_chef_count    (GrRecipeOverview *overview,
+                                                        const char       *author);
+guint             gr_recipe_overview_get_cuisine_count (GrRecipeOverview *overview,
+                                                        const char       *cuisine);
+guint             gr_recipe_overview_get_season_count  (GrRecipeOverview *overview,
+                                                        const char       *season);
+gboolean          gr_recipe_overview_has_diet          (GrRecipeOverview *overview,
+                                                        GrDiets           diet);
+char            **gr_recipe_overview_get_contributors  (GrRecipeOverview *overview,
+                                                        guint            *length);
+char            **gr_recipe_overview_get_cuisines      (GrRecipeOverview *overview,
+                                                        guint            *length);
+GPtrArray        *gr_recipe_overview_get_todays        (GrRecipeOverview *overview);
+GPtrArray        *gr_recipe_overview_get_picks         (GrRecipeOverview *overview);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrRecipeOverview, gr_recipe_overview_free)
+
+G_END_DECLS
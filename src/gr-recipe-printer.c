@@ -187,7 +187,7 @@ begin_print (GtkPrintOperation *operation,
 
         g_string_truncate (s, 0);
 
-        ingredients = gr_ingredients_list_new (gr_recipe_get_ingredients (printer->recipe));
+        ingredients = g_object_ref (gr_recipe_get_ingredients_list (printer->recipe));
         segs = gr_ingredients_list_get_segments (ingredients);
 
         layout = gtk_print_context_create_pango_layout (context);
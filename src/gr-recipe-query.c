@@ -0,0 +1,322 @@
+/* gr-recipe-query.c:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gr-recipe-query.h"
+#include "gr-recipe-store.h"
+#include "gr-chef.h"
+
+/* Compiled queries
+ * ----------------
+ *
+ * A search checks the same terms against every recipe, so we look at
+ * the prefixes of the terms only once, and turn them into predicates:
+ * a spiciness range, a set of diet masks, exact author and season
+ * strings, and lists of substrings for the category, name, ingredients
+ * and free text. The predicates are checked cheapest first, so most
+ * recipes are rejected by comparing a few integers.
+ *
+ * Matching a recipe does not allocate.
+ */
+
+struct _GrRecipeQuery
+{
+        char **terms;
+
+        gboolean never;
+
+        int min_spiciness;
+        int max_spiciness;
+
+        GArray *diets;
+        const char *author;
+        const char *season;
+
+        GPtrArray *categories;
+        GPtrArray *names;
+        GPtrArray *with_ingredients;
+        GPtrArray *without_ingredients;
+        GPtrArray *texts;
+
+        GHashTable *chef_names;
+};
+
+static GrDiets
+parse_diets (const char *term)
+{
+        struct { GrDiets diet; const char *term; } diets[] = {
+                { GR_DIET_GLUTEN_FREE, "gluten-free" },
+                { GR_DIET_NUT_FREE,    "nut-free" },
+                { GR_DIET_VEGAN,       "vegan" },
+                { GR_DIET_VEGETARIAN,  "vegetarian" },
+                { GR_DIET_MILK_FREE,   "milk-free" },
+                { 0, NULL }
+        };
+        GrDiets d = 0;
+        int j;
+
+        for (j = 0; diets[j].term; j++) {
+                if (strstr (diets[j].term, term))
+                        d |= diets[j].diet;
+        }
+
+        return d;
+}
+
+/* Two different exact values can never both match */
+static void
+set_exact (GrRecipeQuery  *query,
+           const char    **field,
+           const char     *value)
+{
+        if (*field && strcmp (*field, value) != 0)
+                query->never = TRUE;
+
+        *field = value;
+}
+
+/**
+ * gr_recipe_query_new:
+ * @terms: (array zero-terminated=1): search terms
+ *
+ * Compiles @terms into a query. Terms are assumed to be casefolded
+ * where appropriate. Terms with a prefix such as "by:", "se:", "di:",
+ * "i+:" or "s+:" match a single field; other terms match the name,
+ * description, ingredients or chef name.
+ *
+ * Returns: (transfer full): a new #GrRecipeQuery
+ */
+GrRecipeQuery *
+gr_recipe_query_new (const char **terms)
+{
+        GrRecipeQuery *query;
+        int i;
+
+        query = g_new0 (GrRecipeQuery, 1);
+        query->terms = g_strdupv ((char **)terms);
+        query->min_spiciness = G_MININT;
+        query->max_spiciness = G_MAXINT;
+        query->diets = g_array_new (FALSE, FALSE, sizeof (GrDiets));
+        query->categories = g_ptr_array_new ();
+        query->names = g_ptr_array_new ();
+        query->with_ingredients = g_ptr_array_new ();
+        query->without_ingredients = g_ptr_array_new ();
+        query->texts = g_ptr_array_new ();
+
+        for (i = 0; query->terms[i]; i++) {
+                const char *term = query->terms[i];
+
+                if (g_str_has_prefix (term, "i+:"))
+                        g_ptr_array_add (query->with_ingredients, (gpointer)(term + 3));
+                else if (g_str_has_prefix (term, "i-:"))
+                        g_ptr_array_add (query->without_ingredients, (gpointer)(term + 3));
+                else if (g_str_has_prefix (term, "by:"))
+                        set_exact (query, &query->author, term + 3);
+                else if (g_str_has_prefix (term, "se:"))
+                        set_exact (query, &query->season, term + 3);
+                else if (g_str_has_prefix (term, "me:"))
+                        g_ptr_array_add (query->categories, (gpointer)(term + 3));
+                else if (g_str_has_prefix (term, "di:")) {
+                        GrDiets d;
+
+                        d = parse_diets (term + 3);
+                        if (d == 0)
+                                query->never = TRUE;
+                        g_array_append_val (query->diets, d);
+                }
+                else if (g_str_has_prefix (term, "na:"))
+                        g_ptr_array_add (query->names, (gpointer)(term + 3));
+                else if (g_str_has_prefix (term, "s+:"))
+                        query->min_spiciness = MAX (query->min_spiciness, atoi (term + 3));
+                else if (g_str_has_prefix (term, "s-:"))
+                        query->max_spiciness = MIN (query->max_spiciness, atoi (term + 3));
+                else
+                        g_ptr_array_add (query->texts, (gpointer)term);
+        }
+
+        return query;
+}
+
+void
+gr_recipe_query_free (GrRecipeQuery *query)
+{
+        g_strfreev (query->terms);
+        g_array_unref (query->diets);
+        g_ptr_array_unref (query->categories);
+        g_ptr_array_unref (query->names);
+        g_ptr_array_unref (query->with_ingredients);
+        g_ptr_array_unref (query->without_ingredients);
+        g_ptr_array_unref (query->texts);
+        g_clear_pointer (&query->chef_names, g_hash_table_unref);
+        g_free (query);
+}
+
+/**
+ * gr_recipe_query_set_chef_names:
+ * @query: a #GrRecipeQuery
+ * @chef_names: a hash table mapping chef ids to casefolded full names
+ *
+ * Makes @query look up chef names in @chef_names instead of asking
+ * the recipe store, so that it can be used outside the main thread.
+ */
+void
+gr_recipe_query_set_chef_names (GrRecipeQuery *query,
+                                GHashTable    *chef_names)
+{
+        g_clear_pointer (&query->chef_names, g_hash_table_unref);
+        query->chef_names = g_hash_table_ref (chef_names);
+}
+
+static gboolean
+contains_all (const char *text,
+              GPtrArray  *terms)
+{
+        guint i;
+
+        for (i = 0; i < terms->len; i++) {
+                if (!text || strstr (text, g_ptr_array_index (terms, i)) == NULL)
+                        return FALSE;
+        }
+
+        return TRUE;
+}
+
+static gboolean
+contains_none (const char *text,
+               GPtrArray  *terms)
+{
+        guint i;
+
+        if (!text)
+                return TRUE;
+
+        for (i = 0; i < terms->len; i++) {
+                if (strstr (text, g_ptr_array_index (terms, i)) != NULL)
+                        return FALSE;
+        }
+
+        return TRUE;
+}
+
+/**
+ * gr_recipe_query_matches:
+ * @query: a #GrRecipeQuery
+ * @recipe: a #GrRecipe
+ *
+ * Returns whether @recipe matches all the terms of @query.
+ *
+ * Returns: %TRUE if @recipe matches
+ */
+gboolean
+gr_recipe_query_matches (GrRecipeQuery *query,
+                         GrRecipe      *recipe)
+{
+        const char *cf_name;
+        const char *cf_description;
+        const char *cf_ingredients;
+        const char *cf_fullname;
+        g_autoptr(GrChef) chef = NULL;
+        gboolean chef_looked_up;
+        GrDiets diets;
+        int spiciness;
+        guint i;
+
+        if (query->never)
+                return FALSE;
+
+        spiciness = gr_recipe_get_spiciness (recipe);
+        if (spiciness < query->min_spiciness || spiciness > query->max_spiciness)
+                return FALSE;
+
+        diets = gr_recipe_get_diets (recipe);
+        for (i = 0; i < query->diets->len; i++) {
+                if (!(diets & g_array_index (query->diets, GrDiets, i)))
+                        return FALSE;
+        }
+
+        if (query->author &&
+            g_strcmp0 (gr_recipe_get_author (recipe), query->author) != 0)
+                return FALSE;
+
+        if (query->season &&
+            g_strcmp0 (gr_recipe_get_season (recipe), query->season) != 0)
+                return FALSE;
+
+        if (!contains_all (gr_recipe_get_category (recipe), query->categories))
+                return FALSE;
+
+        /* Queries with their own chef names are used outside the main thread */
+        if (query->chef_names) {
+                if (!gr_recipe_peek_search_texts (recipe, &cf_name, &cf_description, &cf_ingredients))
+                        cf_name = cf_description = cf_ingredients = NULL;
+        }
+        else
+                gr_recipe_get_search_texts (recipe, &cf_name, &cf_description, &cf_ingredients);
+
+        /* A recipe without a name is not excluded by name terms */
+        if (cf_name && !contains_all (cf_name, query->names))
+                return FALSE;
+
+        if (!contains_all (gr_recipe_get_ingredients (recipe), query->with_ingredients))
+                return FALSE;
+
+        if (!contains_none (gr_recipe_get_ingredients (recipe), query->without_ingredients))
+                return FALSE;
+
+        cf_fullname = NULL;
+        chef_looked_up = FALSE;
+
+        for (i = 0; i < query->texts->len; i++) {
+                const char *term = g_ptr_array_index (query->texts, i);
+
+                if (cf_name && strstr (cf_name, term) != NULL)
+                        continue;
+
+                if (cf_description && strstr (cf_description, term) != NULL)
+                        continue;
+
+                if (cf_ingredients && strstr (cf_ingredients, term) != NULL)
+                        continue;
+
+                /* Only look at the chef when the recipe itself doesn't match */
+                if (!chef_looked_up) {
+                        const char *author = gr_recipe_get_author (recipe);
+
+                        if (author && query->chef_names)
+                                cf_fullname = g_hash_table_lookup (query->chef_names, author);
+                        else if (author)
+                                chef = gr_recipe_store_get_chef (gr_recipe_store_get (), author);
+                        if (chef)
+                                cf_fullname = gr_chef_get_cf_fullname (chef);
+                        chef_looked_up = TRUE;
+                }
+
+                if (cf_fullname && strstr (cf_fullname, term) != NULL)
+                        continue;
+
+                return FALSE;
+        }
+
+        return TRUE;
+}
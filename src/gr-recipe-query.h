@@ -0,0 +1,40 @@
+/* gr-recipe-query.h:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include "gr-recipe.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GrRecipeQuery GrRecipeQuery;
+
+GrRecipeQuery *gr_recipe_query_new     (const char    **terms);
+void           gr_recipe_query_free    (GrRecipeQuery  *query);
+gboolean       gr_recipe_query_matches (GrRecipeQuery  *query,
+                                        GrRecipe       *recipe);
+
+void           gr_recipe_query_set_chef_names (GrRecipeQuery *query,
+                                               GHashTable    *chef_names);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrRecipeQuery, gr_recipe_query_free)
+
+G_END_DECLS
@@ -0,0 +1,484 @@
+/* gr-recipe-snapshot.c:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "gr-recipe-snapshot.h"
+#include "gr-number.h"
+#include "gr-utils.h"
+
+/* Recipe snapshots
+ * ----------------
+ *
+ * A snapshot is a compiled, binary form of a recipes.db keyfile. It is
+ * a serialized GVariant of type (uxta<record>), with
+ *  - a format version
+ *  - the mtime of the keyfile it was compiled from (in nanoseconds)
+ *  - the size of the keyfile it was compiled from
+ *  - an array of records, one per recipe
+ *
+ * The snapshot is mmapped, and GVariant only looks at the parts of the
+ * file that are actually accessed, so fields that are never needed are
+ * never read. Strings are returned as pointers into the mapping.
+ *
+ * The snapshot is stored in native byte order. A snapshot that was written
+ * on a machine with a different byte order fails the version check and is
+ * regenerated.
+ *
+ * Missing optional keys are stored as Nothing. Timestamps are stored as
+ * unix times, so they don't have to be parsed again at load time.
+ */
+
+#define SNAPSHOT_VERSION 2
+
+#define SNAPSHOT_TYPE "(uxta" GR_RECIPE_SNAPSHOT_RECORD_TYPE ")"
+
+static gboolean
+parse_yield (const char  *text,
+             double      *amount,
+             char       **unit)
+{
+        char *tmp;
+        const char *str;
+
+        g_clear_pointer (unit, g_free);
+
+        tmp = (char *)text;
+        skip_whitespace (&tmp);
+        str = tmp;
+        if (!gr_number_parse (amount, &tmp, NULL)) {
+                *unit = g_strdup (str);
+                return FALSE;
+        }
+
+        skip_whitespace (&tmp);
+        if (tmp)
+                *unit = g_strdup (tmp);
+
+        return TRUE;
+}
+
+/* Returns FALSE if the recipe should be skipped. A missing key
+ * is not an error, and leaves *value untouched.
+ */
+static gboolean
+get_optional_string (GKeyFile    *keyfile,
+                     const char  *group,
+                     const char  *key,
+                     char       **value)
+{
+        g_autoptr(GError) error = NULL;
+        char *s;
+
+        s = g_key_file_get_string (keyfile, group, key, &error);
+        if (error) {
+                if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
+                        g_warning ("Failed to load recipe %s: %s", group, error->message);
+                        return FALSE;
+                }
+                return TRUE;
+        }
+
+        g_free (*value);
+        *value = s;
+
+        return TRUE;
+}
+
+static gboolean
+get_optional_int (GKeyFile   *keyfile,
+                  const char *group,
+                  const char *key,
+                  int        *value)
+{
+        g_autoptr(GError) error = NULL;
+        int i;
+
+        i = g_key_file_get_integer (keyfile, group, key, &error);
+        if (error) {
+                if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
+                        g_warning ("Failed to load recipe %s: %s", group, error->message);
+                        return FALSE;
+                }
+                return TRUE;
+        }
+
+        *value = i;
+
+        return TRUE;
+}
+
+static gboolean
+get_optional_time (GKeyFile   *keyfile,
+                   const char *group,
+                   const char *key,
+                   gboolean   *has_value,
+                   gint64     *value)
+{
+        g_autofree char *s = NULL;
+        g_autoptr(GDateTime) dt = NULL;
+
+        *has_value = FALSE;
+
+        if (!get_optional_string (keyfile, group, key, &s))
+                return FALSE;
+
+        if (s == NULL)
+                return TRUE;
+
+        dt = date_time_from_string (s);
+        if (!dt) {
+                g_warning ("Failed to load recipe %s: Couldn't parse %s key", group, key);
+                return FALSE;
+        }
+
+        *has_value = TRUE;
+        *value = g_date_time_to_unix (dt);
+
+        return TRUE;
+}
+
+static GVariant *
+compile_recipe (GKeyFile   *keyfile,
+                const char *group)
+{
+        g_autofree char *name = g_strdup ("unknown");
+        g_autofree char *author = g_strdup ("anonymous");
+        g_autofree char *description = NULL;
+        g_autofree char *cuisine = NULL;
+        g_autofree char *season = NULL;
+        g_autofree char *category = NULL;
+        g_autofree char *prep_time = NULL;
+        g_autofree char *cook_time = NULL;
+        g_autofree char *ingredients = NULL;
+        g_autofree char *instructions = NULL;
+        g_autofree char *notes = NULL;
+        g_autofree char *yield_str = NULL;
+        g_autofree char *yield_unit = NULL;
+        g_auto(GStrv) paths = NULL;
+        g_autoptr(GError) error = NULL;
+        const char *empty[] = { NULL };
+        double yield;
+        int serves = 0;
+        int spiciness = 0;
+        int diets = 0;
+        int default_image = 0;
+        gboolean has_ctime, has_mtime;
+        gint64 ctime = 0, mtime = 0;
+
+        if (!get_optional_string (keyfile, group, "Name", &name) ||
+            !get_optional_string (keyfile, group, "Author", &author) ||
+            !get_optional_string (keyfile, group, "Description", &description) ||
+            !get_optional_string (keyfile, group, "Cuisine", &cuisine) ||
+            !get_optional_string (keyfile, group, "Season", &season) ||
+            !get_optional_string (keyfile, group, "Category", &category) ||
+            !get_optional_string (keyfile, group, "PrepTime", &prep_time) ||
+            !get_optional_string (keyfile, group, "CookTime", &cook_time) ||
+            !get_optional_string (keyfile, group, "Ingredients", &ingredients) ||
+            !get_optional_string (keyfile, group, "Instructions", &instructions) ||
+            !get_optional_string (keyfile, group, "Notes", &notes))
+                return NULL;
+
+        paths = g_key_file_get_string_list (keyfile, group, "Images", NULL, &error);
+        if (error) {
+                if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
+                        g_warning ("Failed to load recipe %s: %s", group, error->message);
+                        return NULL;
+                }
+                g_clear_error (&error);
+        }
+
+        if (!get_optional_int (keyfile, group, "DefaultImage", &default_image) ||
+            !get_optional_int (keyfile, group, "Serves", &serves) ||
+            !get_optional_string (keyfile, group, "Yield", &yield_str))
+                return NULL;
+
+        /* A missing yield unit is turned into a translated "servings" at load time */
+        if (!yield_str) {
+                yield = (double)serves;
+        }
+        else if (!parse_yield (yield_str, &yield, &yield_unit)) {
+                g_warning ("Failed to load recipe %s: bad yield", group);
+                return NULL;
+        }
+
+        if (!get_optional_int (keyfile, group, "Spiciness", &spiciness) ||
+            !get_optional_int (keyfile, group, "Diets", &diets) ||
+            !get_optional_time (keyfile, group, "Created", &has_ctime, &ctime) ||
+            !get_optional_time (keyfile, group, "Modified", &has_mtime, &mtime))
+                return NULL;
+
+        return g_variant_new ("(msmsmsmsmsmsmsmsmsmsmsms@asiiidmsmxmx)",
+                              group,
+                              name,
+                              author,
+                              description,
+                              cuisine,
+                              season,
+                              category,
+                              prep_time,
+                              cook_time,
+                              ingredients,
+                              instructions,
+                              notes,
+                              g_variant_new_strv (paths ? (const char * const *)paths : empty, -1),
+                              default_image,
+                              spiciness,
+                              diets,
+                              yield,
+                              yield_unit,
+                              has_ctime, ctime,
+                              has_mtime, mtime);
+}
+
+static GVariant *
+compile_snapshot (const char  *keyfile_path,
+                  gint64       keyfile_mtime,
+                  guint64      keyfile_size,
+                  GError     **error)
+{
+        g_autoptr(GKeyFile) keyfile = NULL;
+        g_autoptr(GError) local_error = NULL;
+        g_auto(GStrv) groups = NULL;
+        GVariantBuilder builder;
+        gsize length;
+        int version;
+        int i;
+
+        keyfile = g_key_file_new ();
+
+        if (!g_key_file_load_from_file (keyfile, keyfile_path, G_KEY_FILE_NONE, error))
+                return NULL;
+
+        version = g_key_file_get_integer (keyfile, "Metadata", "Version", &local_error);
+        if (local_error) {
+                if (g_error_matches (local_error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND) ||
+                    g_error_matches (local_error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_GROUP_NOT_FOUND)) {
+                        g_info ("No metadata found, assuming version 1");
+                        version = 1;
+                }
+                else {
+                        g_propagate_error (error, g_steal_pointer (&local_error));
+                        return NULL;
+                }
+        }
+        if (version != 1) {
+                g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE,
+                             "Don't know how to handle recipe db version %d", version);
+                return NULL;
+        }
+
+        g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" GR_RECIPE_SNAPSHOT_RECORD_TYPE));
+
+        groups = g_key_file_get_groups (keyfile, &length);
+        for (i = 0; i < length; i++) {
+                GVariant *record;
+
+                if (strcmp (groups[i], "Metadata") == 0)
+                        continue;
+
+                record = compile_recipe (keyfile, groups[i]);
+                if (record)
+                        g_variant_builder_add_value (&builder, record);
+        }
+
+        return g_variant_new ("(uxt@a" GR_RECIPE_SNAPSHOT_RECORD_TYPE ")",
+                              SNAPSHOT_VERSION,
+                              keyfile_mtime,
+                              keyfile_size,
+                              g_variant_builder_end (&builder));
+}
+
+static GVariant *
+map_snapshot (const char *snapshot_path,
+              gint64      keyfile_mtime,
+              guint64     keyfile_size)
+{
+        g_autoptr(GMappedFile) mapped = NULL;
+        g_autoptr(GBytes) bytes = NULL;
+        g_autoptr(GVariant) snapshot = NULL;
+        g_autoptr(GError) error = NULL;
+        guint32 version;
+        gint64 mtime;
+        guint64 size;
+
+        mapped = g_mapped_file_new (snapshot_path, FALSE, &error);
+        if (!mapped) {
+                if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+                        g_debug ("Failed to map recipe snapshot %s: %s", snapshot_path, error->message);
+                return NULL;
+        }
+
+        bytes = g_mapped_file_get_bytes (mapped);
+        snapshot = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (SNAPSHOT_TYPE), bytes, FALSE));
+
+        g_variant_get_child (snapshot, 0, "u", &version);
+        g_variant_get_child (snapshot, 1, "x", &mtime);
+        g_variant_get_child (snapshot, 2, "t", &size);
+
+        if (version != SNAPSHOT_VERSION) {
+                g_debug ("Recipe snapshot %s has unknown version %u", snapshot_path, version);
+                return NULL;
+        }
+
+        if (mtime != keyfile_mtime || size != keyfile_size) {
+                g_debug ("Recipe snapshot %s is out of date", snapshot_path);
+                return NULL;
+        }
+
+        return g_variant_get_child_value (snapshot, 3);
+}
+
+/* Whole seconds are not enough to notice an edit that keeps the size
+ * of the keyfile, so use the full precision of the mtime where we can.
+ */
+static gint64
+get_mtime_nsec (GStatBuf *buf)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+        return (gint64)buf->st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000) + buf->st_mtim.tv_nsec;
+#else
+        return (gint64)buf->st_mtime * G_GINT64_CONSTANT (1000000000);
+#endif
+}
+
+/**
+ * gr_recipe_snapshot_load:
+ * @keyfile_path: the path of a recipes.db keyfile
+ * @snapshot_path: the path to store the compiled snapshot at
+ * @error: return location for an error
+ *
+ * Returns the recipes in @keyfile_path as an array of records of type
+ * GR_RECIPE_SNAPSHOT_RECORD_TYPE. If the snapshot at @snapshot_path
+ * matches the keyfile, it is mmapped and used. Otherwise, the keyfile
+ * is parsed and the snapshot is written out for the next time.
+ *
+ * Recipes that fail to parse are skipped with a warning.
+ *
+ * Returns: (transfer full): the recipe records, or %NULL on error
+ */
+GVariant *
+gr_recipe_snapshot_load (const char  *keyfile_path,
+                         const char  *snapshot_path,
+                         GError     **error)
+{
+        GStatBuf buf;
+        gint64 keyfile_mtime;
+        guint64 keyfile_size;
+        g_autoptr(GVariant) snapshot = NULL;
+        g_autoptr(GError) local_error = NULL;
+        GVariant *records;
+
+        if (g_stat (keyfile_path, &buf) != 0) {
+                int errsv = errno;
+                g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errsv),
+                             "Failed to stat %s: %s", keyfile_path, g_strerror (errsv));
+                return NULL;
+        }
+
+        keyfile_mtime = get_mtime_nsec (&buf);
+        keyfile_size = (guint64)buf.st_size;
+
+        records = map_snapshot (snapshot_path, keyfile_mtime, keyfile_size);
+        if (records) {
+                g_info ("Using recipe snapshot %s", snapshot_path);
+                return records;
+        }
+
+        snapshot = compile_snapshot (keyfile_path, keyfile_mtime, keyfile_size, error);
+        if (!snapshot)
+                return NULL;
+
+        g_variant_ref_sink (snapshot);
+
+        g_info ("Writing recipe snapshot %s", snapshot_path);
+        if (!g_file_set_contents (snapshot_path,
+                                  g_variant_get_data (snapshot),
+                                  g_variant_get_size (snapshot),
+                                  &local_error))
+                g_info ("Failed to write recipe snapshot %s: %s", snapshot_path, local_error->message);
+
+        return g_variant_get_child_value (snapshot, 3);
+}
+
+/* The returned string points into @record, and stays valid as long as it does */
+const char *
+gr_recipe_snapshot_get_string (GVariant        *record,
+                               GrSnapshotField  field)
+{
+        const char *s = NULL;
+
+        g_variant_get_child (record, field, "m&s", &s);
+
+        return s;
+}
+
+int
+gr_recipe_snapshot_get_int (GVariant        *record,
+                            GrSnapshotField  field)
+{
+        int i;
+
+        g_variant_get_child (record, field, "i", &i);
+
+        return i;
+}
+
+double
+gr_recipe_snapshot_get_double (GVariant        *record,
+                               GrSnapshotField  field)
+{
+        double d;
+
+        g_variant_get_child (record, field, "d", &d);
+
+        return d;
+}
+
+gboolean
+gr_recipe_snapshot_get_time (GVariant        *record,
+                             GrSnapshotField  field,
+                             gint64          *time)
+{
+        gboolean has_value;
+
+        g_variant_get_child (record, field, "mx", &has_value, time);
+
+        return has_value;
+}
+
+/* The returned array must be freed with g_free(), the strings
+ * point into @record
+ */
+const char **
+gr_recipe_snapshot_get_strv (GVariant        *record,
+                             GrSnapshotField  field)
+{
+        const char **strv;
+
+        g_variant_get_child (record, field, "^a&s", &strv);
+
+        return strv;
+}
@@ -0,0 +1,71 @@
+/* gr-recipe-snapshot.h:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The fields of a snapshot record, in the order they appear in
+ * GR_RECIPE_SNAPSHOT_RECORD_TYPE.
+ */
+typedef enum {
+        GR_SNAPSHOT_ID,
+        GR_SNAPSHOT_NAME,
+        GR_SNAPSHOT_AUTHOR,
+        GR_SNAPSHOT_DESCRIPTION,
+        GR_SNAPSHOT_CUISINE,
+        GR_SNAPSHOT_SEASON,
+        GR_SNAPSHOT_CATEGORY,
+        GR_SNAPSHOT_PREP_TIME,
+        GR_SNAPSHOT_COOK_TIME,
+        GR_SNAPSHOT_INGREDIENTS,
+        GR_SNAPSHOT_INSTRUCTIONS,
+        GR_SNAPSHOT_NOTES,
+        GR_SNAPSHOT_IMAGES,
+        GR_SNAPSHOT_DEFAULT_IMAGE,
+        GR_SNAPSHOT_SPICINESS,
+        GR_SNAPSHOT_DIETS,
+        GR_SNAPSHOT_YIELD,
+        GR_SNAPSHOT_YIELD_UNIT,
+        GR_SNAPSHOT_CTIME,
+        GR_SNAPSHOT_MTIME
+} GrSnapshotField;
+
+#define GR_RECIPE_SNAPSHOT_RECORD_TYPE "(msmsmsmsmsmsmsmsmsmsmsmsasiiidmsmxmx)"
+
+GVariant   *gr_recipe_snapshot_load       (const char       *keyfile_path,
+                                           const char       *snapshot_path,
+                                           GError          **error);
+
+const char *gr_recipe_snapshot_get_string (GVariant         *record,
+                                           GrSnapshotField   field);
+int         gr_recipe_snapshot_get_int    (GVariant         *record,
+                                           GrSnapshotField   field);
+double      gr_recipe_snapshot_get_double (GVariant         *record,
+                                           GrSnapshotField   field);
+gboolean    gr_recipe_snapshot_get_time   (GVariant         *record,
+                                           GrSnapshotField   field,
+                                           gint64           *time);
+const char **gr_recipe_snapshot_get_strv  (GVariant         *record,
+                                           GrSnapshotField   field);
+
+G_END_DECLS
@@ -20,7 +20,9 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
@@ -28,6 +30,13 @@
 
 #include "gr-recipe-store.h"
 #include "gr-recipe.h"
+#include "gr-recipe-snapshot.h"
+#include "gr-recipe-index.h"
+#include "gr-recipe-journal.h"
+#include "gr-recipe-overview.h"
+#include "gr-recipe-query.h"
+#include "gr-string-set.h"
+#include "gr-cache-index.h"
 #include "gr-settings.h"
 #include "gr-utils.h"
 #include "gr-ingredients-list.h"
@@ -103,11 +112,24 @@
  *  Chefs (string list, containing IDs of chefs to show in the Featured
  *         GNOME Chefs part of the landing page)
  *
+ * Recipe snapshots
+ * ----------------
+ *
+ * Parsing a large recipes.db is slow, so we compile each recipes.db into
+ * a binary snapshot (see gr-recipe-snapshot.c) that is stored next to it,
+ * or in the cache for readonly locations. The snapshot is mmapped at startup,
+ * and regenerated when the mtime or size of the keyfile changes.
+ *
  * Data at runtime
  * ---------------
  *
  * At runtime, we keep GrRecipe and GrChef objects in two separate hash tables.
  *
+ * For searching, we keep a trigram index of the casefolded recipe texts
+ * (see gr-recipe-index.c). It is built when it is first needed, and kept
+ * up-to-date from our own recipe-added, recipe-changed and recipe-removed
+ * signals. Since it includes chef names, it is rebuilt when chefs change.
+ *
  * Ancillary data
  * --------------
  *
@@ -131,6 +153,21 @@
  * and claim to be a mime handler for it.
  */
 
+/* Secondary indexes
+ * -----------------
+ *
+ * To answer questions like 'are there any recipes by this chef' or
+ * 'which cuisines do we have' without looking at every recipe, the
+ * store keeps a #GrRecipeOverview with counts of recipes per author,
+ * per cuisine, per season and per combination of diets, and with
+ * today's recipes and picks. It is updated whenever a recipe is added,
+ * changed or removed, and rebuilt when recipes are loaded.
+ *
+ * When an update changes what the landing pages show, the store emits
+ * ::overview-changed with the parts that changed, so the pages don't
+ * have to rebuild themselves for every recipe change.
+ */
+
 struct _GrRecipeStore
 {
         GObject parent;
@@ -140,10 +177,10 @@ struct _GrRecipeStore
 
         char **todays;
         char **picks;
-        char **favorites;
-        char **export_list;
-        GVariantDict *shopping_list;
-        char **shopping_removed;
+        GrStringSet *favorites;
+        GrStringSet *export_list;
+        GHashTable *shopping_list;
+        GrStringSet *shopping_removed;
         char **featured_chefs;
         char *user;
 
@@ -152,6 +189,17 @@ struct _GrRecipeStore
 
         SoupSession *session;
         SoupMessage *recipes_message;
+
+        GrRecipeIndex *index;
+        gboolean index_valid;
+
+        GHashTable *dirty;
+        GPtrArray *batch;
+        guint save_timeout;
+        int journal_length;
+        gboolean compacting;
+
+        GrRecipeOverview *overview;
 };
 
 
@@ -164,13 +212,22 @@ gr_recipe_store_finalize (GObject *object)
 
         g_clear_pointer (&self->recipes, g_hash_table_unref);
         g_clear_pointer (&self->chefs, g_hash_table_unref);
+        g_clear_pointer (&self->index, gr_recipe_index_free);
+        g_clear_pointer (&self->dirty, g_hash_table_unref);
+        g_clear_pointer (&self->batch, g_ptr_array_unref);
+        g_clear_pointer (&self->overview, gr_recipe_overview_free);
+        if (self->save_timeout) {
+                g_source_remove (self->save_timeout);
+                self->save_timeout = 0;
+        }
         g_clear_pointer (&self->favorite_change, g_date_time_unref);
         g_clear_pointer (&self->shopping_change, g_date_time_unref);
         g_strfreev (self->todays);
         g_strfreev (self->picks);
-        g_strfreev (self->favorites);
-        g_strfreev (self->export_list);
-        g_variant_dict_unref (self->shopping_list);
+        g_clear_pointer (&self->favorites, gr_string_set_free);
+        g_clear_pointer (&self->export_list, gr_string_set_free);
+        g_clear_pointer (&self->shopping_removed, gr_string_set_free);
+        g_clear_pointer (&self->shopping_list, g_hash_table_unref);
         g_strfreev (self->featured_chefs);
         g_free (self->user);
         g_clear_object (&self->recipes_message);
@@ -179,488 +236,455 @@ gr_recipe_store_finalize (GObject *object)
         G_OBJECT_CLASS (gr_recipe_store_parent_class)->finalize (object);
 }
 
-static gboolean
-parse_yield (const char  *text,
-             double      *amount,
-             char       **unit)
+static char *
+get_snapshot_path (const char *dir)
 {
-        char *tmp;
-        const char *str;
-        g_autofree char *num = NULL;
+        g_autofree char *checksum = NULL;
+        g_autofree char *basename = NULL;
 
-        g_clear_pointer (unit, g_free);
-
-        tmp = (char *)text;
-        skip_whitespace (&tmp);
-        str = tmp;
-        if (!gr_number_parse (amount, &tmp, NULL)) {
-                *unit = g_strdup (str);
-                return FALSE;
-        }
+        /* Preinstalled data lives in a readonly location,
+         * so we keep its snapshot in the cache instead
+         */
+        if (g_access (dir, W_OK) == 0)
+                return g_build_filename (dir, "recipes.snapshot", NULL);
 
-        skip_whitespace (&tmp);
-        if (tmp)
-                *unit = g_strdup (tmp);
+        checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, dir, -1);
+        basename = g_strconcat ("recipes-", checksum, ".snapshot", NULL);
 
-        return TRUE;
+        return g_build_filename (get_user_cache_dir (), basename, NULL);
 }
 
-static gboolean
-load_recipes (GrRecipeStore *self,
-              const char    *dir,
-              gboolean       contributed)
+static GVariant *
+load_records (const char *dir)
 {
-        g_autoptr(GKeyFile) keyfile = NULL;
+        g_autoptr(GVariant) records = NULL;
         g_autoptr(GError) error = NULL;
         g_autofree char *path = NULL;
-        g_auto(GStrv) groups = NULL;
-        gsize length, length2;
-        int i, j;
-        int version;
-
-        keyfile = g_key_file_new ();
+        g_autofree char *snapshot_path = NULL;
 
         path = g_build_filename (dir, "recipes.db", NULL);
+        snapshot_path = get_snapshot_path (dir);
 
-        if (!g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, &error)) {
+        records = gr_recipe_snapshot_load (path, snapshot_path, &error);
+        if (!records) {
                 if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
                         g_error ("Failed to load recipe db: %s", error->message);
                 else
                         g_info ("No recipe db at: %s", path);
-                return FALSE;
+                return NULL;
         }
 
         g_info ("Load recipe db: %s", path);
 
-        version = g_key_file_get_integer (keyfile, "Metadata", "Version", &error);
-        if (error) {
-                if (g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND) ||
-                    g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_GROUP_NOT_FOUND)) {
-                        g_info ("No metadata found, assuming version 1");
-                        version = 1;
-                }
-                else {
-                        g_error ("Failed to read recipe db: %s", error->message);
-                        return FALSE;
-                }
-                g_clear_error (&error);
-        }
-        if (version != 1) {
-                g_error ("Don't know how to handle recipe db version %d", version);
+        return g_steal_pointer (&records);
+}
+
+/* Fills in the strings and numbers of a recipe from a
+ * snapshot record. The strings point into the record.
+ */
+static void
+get_record_fields (GVariant       *record,
+                   GrRecipeFields *fields)
+{
+        fields->id = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_ID);
+        fields->name = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_NAME);
+        fields->author = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_AUTHOR);
+        fields->description = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_DESCRIPTION);
+        fields->cuisine = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_CUISINE);
+        fields->season = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_SEASON);
+        fields->category = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_CATEGORY);
+        fields->prep_time = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_PREP_TIME);
+        fields->cook_time = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_COOK_TIME);
+        fields->ingredients = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_INGREDIENTS);
+        fields->notes = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_NOTES);
+        fields->default_image = gr_recipe_snapshot_get_int (record, GR_SNAPSHOT_DEFAULT_IMAGE);
+        fields->spiciness = gr_recipe_snapshot_get_int (record, GR_SNAPSHOT_SPICINESS);
+        fields->diets = gr_recipe_snapshot_get_int (record, GR_SNAPSHOT_DIETS);
+        fields->yield = gr_recipe_snapshot_get_double (record, GR_SNAPSHOT_YIELD);
+        fields->yield_unit = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_YIELD_UNIT);
+        if (!fields->yield_unit)
+                fields->yield_unit = _("servings");
+}
+
+static GPtrArray *
+get_record_images (GVariant *record)
+{
+        g_autofree const char **paths = NULL;
+        const char *id;
+        GPtrArray *images;
+        int j;
+
+        id = gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_ID);
+
+        images = gr_image_array_new ();
+        paths = gr_recipe_snapshot_get_strv (record, GR_SNAPSHOT_IMAGES);
+        for (j = 0; paths[j]; j++) {
+                GrImage *ri;
+                ri = gr_image_new (gr_app_get_soup_session (GR_APP (g_application_get_default ())), id, paths[j]);
+
+                g_ptr_array_add (images, ri);
         }
 
-        groups = g_key_file_get_groups (keyfile, &length);
+        return images;
+}
+
+static GDateTime *
+get_record_time (GVariant        *record,
+                 GrSnapshotField  field)
+{
+        gint64 time;
+
+        if (gr_recipe_snapshot_get_time (record, field, &time))
+                return g_date_time_new_from_unix_utc (time);
+        else
+                return g_date_time_new_now_utc ();
+}
+
+static gboolean
+load_recipes (GrRecipeStore *self,
+              const char    *dir,
+              gboolean       contributed)
+{
+        g_autoptr(GVariant) records = NULL;
+        gsize length;
+        int i;
+
+        records = load_records (dir);
+        if (!records)
+                return FALSE;
+
+        length = g_variant_n_children (records);
         for (i = 0; i < length; i++) {
+                g_autoptr(GVariant) record = NULL;
                 GrRecipe *recipe;
-                const char *id;
-                g_autofree char *name = NULL;
-                g_autofree char *author = NULL;
-                g_autofree char *description = NULL;
-                g_autofree char *cuisine = NULL;
-                g_autofree char *season = NULL;
-                g_autofree char *category = NULL;
-                g_autofree char *prep_time = NULL;
-                g_autofree char *cook_time = NULL;
-                g_autofree char *ingredients = NULL;
-                g_autofree char *instructions = NULL;
-                g_autofree char *notes = NULL;
-                g_autofree char *yield_str = NULL;
-                g_autofree char *yield_unit = NULL;
-                double yield;
-                g_auto(GStrv) paths = NULL;
-                int serves;
-                int spiciness;
-                int default_image = 0;
-                GrDiets diets;
+                GrRecipeFields fields = { NULL, };
                 g_autoptr(GPtrArray) images = NULL;
                 g_autoptr(GDateTime) ctime = NULL;
                 g_autoptr(GDateTime) mtime = NULL;
-                char *tmp;
-
-                if (strcmp (groups[i], "Metadata") == 0)
-                        continue;
 
-                g_clear_error (&error);
+                record = g_variant_get_child_value (records, i);
+                get_record_fields (record, &fields);
 
-                id = groups[i];
-                name = g_key_file_get_string (keyfile, groups[i], "Name", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        name = g_strdup ("unknown");
-                        g_clear_error (&error);
-                }
-                author = g_key_file_get_string (keyfile, groups[i], "Author", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        author = g_strdup ("anonymous");
-                        g_clear_error (&error);
-                }
-                description = g_key_file_get_string (keyfile, groups[i], "Description", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                cuisine = g_key_file_get_string (keyfile, groups[i], "Cuisine", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                season = g_key_file_get_string (keyfile, groups[i], "Season", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                category = g_key_file_get_string (keyfile, groups[i], "Category", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                prep_time = g_key_file_get_string (keyfile, groups[i], "PrepTime", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                cook_time = g_key_file_get_string (keyfile, groups[i], "CookTime", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                ingredients = g_key_file_get_string (keyfile, groups[i], "Ingredients", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                instructions = g_key_file_get_string (keyfile, groups[i], "Instructions", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                notes = g_key_file_get_string (keyfile, groups[i], "Notes", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                paths = g_key_file_get_string_list (keyfile, groups[i], "Images", &length2, &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                default_image = g_key_file_get_integer (keyfile, groups[i], "DefaultImage", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                serves = g_key_file_get_integer (keyfile, groups[i], "Serves", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                yield_str = g_key_file_get_string (keyfile, groups[i], "Yield", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                if (!yield_str) {
-                        yield = (double)serves;
-                        yield_unit = g_strdup (_("servings"));
-                }
-                else if (!parse_yield (yield_str, &yield, &yield_unit)) {
-                        g_warning ("Failed to load recipe %s: bad yield", groups[i]);
+                recipe = g_hash_table_lookup (self->recipes, fields.id);
+                if (recipe && gr_recipe_is_readonly (recipe)) {
+                        g_object_set (recipe,
+                                      "notes", fields.notes,
+                                      NULL);
                         continue;
                 }
 
-                spiciness = g_key_file_get_integer (keyfile, groups[i], "Spiciness", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
+                images = get_record_images (record);
+                mtime = get_record_time (record, GR_SNAPSHOT_MTIME);
+                fields.images = images;
+                fields.mtime = mtime;
+
+                if (recipe) {
+                        /* Keep the creation time and origin of the recipe we have */
+                        fields.contributed = gr_recipe_is_contributed (recipe);
+                        fields.readonly = FALSE;
+                        gr_recipe_set_fields (recipe, &fields);
                 }
-                diets = g_key_file_get_integer (keyfile, groups[i], "Diets", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
+                else {
+                        ctime = get_record_time (record, GR_SNAPSHOT_CTIME);
+                        fields.ctime = ctime;
+                        fields.contributed = contributed;
+                        fields.readonly = contributed && g_strcmp0 (fields.author, self->user) != 0;
+                        recipe = gr_recipe_new_from_fields (&fields);
+                        g_hash_table_insert (self->recipes, g_strdup (fields.id), recipe);
                 }
 
-                images = gr_image_array_new ();
-                if (paths) {
-                        for (j = 0; paths[j]; j++) {
-                                GrImage *ri;
-                                ri = gr_image_new (gr_app_get_soup_session (GR_APP (g_application_get_default ())), id, paths[j]);
+                gr_recipe_set_snapshot (recipe, record);
+        }
 
-                                g_ptr_array_add (images, ri);
-                        }
-                }
+        return TRUE;
+}
 
-                tmp = g_key_file_get_string (keyfile, groups[i], "Created", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                if (tmp) {
-                        ctime = date_time_from_string (tmp);
-                        g_free (tmp);
-                        if (!ctime) {
-                                g_warning ("Failed to load recipe %s: Couldn't parse Created key", groups[i]);
-                                continue;
-                        }
-                }
-                else {
-                        ctime = g_date_time_new_now_utc ();
-                }
+/* Saving recipes
+ * --------------
+ *
+ * Edits are not written to recipes.db directly. Instead, the ids of
+ * changed recipes are collected in a set of dirty recipes, and flushed
+ * after a short delay (or at shutdown) by appending one entry per
+ * recipe to an append-only journal, recipes.journal. An entry holds
+ * the complete state of the recipe, or a Removed key if it is gone,
+ * so replaying an entry twice does no harm.
+ *
+ * The journal format is described in gr-recipe-journal.c; a torn entry
+ * at the end is simply ignored.
+ *
+ * Once the journal has grown long enough, it is renamed to
+ * recipes.journal.compacting (or appended to it, if a failed compaction
+ * left it behind), and folded into recipes.db in a thread.
+ * Any leftover journals are compacted at startup, before the recipe db
+ * is loaded.
+ */
 
-                tmp = g_key_file_get_string (keyfile, groups[i], "Modified", &error);
-                if (error) {
-                        if (!g_error_matches (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND)) {
-                                g_warning ("Failed to load recipe %s: %s", groups[i], error->message);
-                                continue;
-                        }
-                        g_clear_error (&error);
-                }
-                if (tmp) {
-                        mtime = date_time_from_string (tmp);
-                        g_free (tmp);
-                        if (!mtime) {
-                                g_warning ("Failed to load recipe %s: Couldn't parse Modified key", groups[i]);
-                                continue;
-                        }
-                }
-                else {
-                        mtime = g_date_time_new_now_utc ();
-                }
+#define SAVE_TIMEOUT 1
+#define JOURNAL_COMPACT_LENGTH 64
+
+static void
+write_recipe_keys (GKeyFile   *keyfile,
+                   const char *key,
+                   GrRecipe   *recipe)
+{
+        const char *name;
+        const char *author;
+        const char *description;
+        const char *cuisine;
+        const char *season;
+        const char *category;
+        const char *prep_time;
+        const char *cook_time;
+        const char *ingredients;
+        const char *instructions;
+        const char *notes;
+        const char *yield_unit;
+        double yield;
+        g_autofree char *yield_str = NULL;
+        GPtrArray *images;
+        int spiciness;
+        GrDiets diets;
+        g_auto(GStrv) paths = NULL;
+        GDateTime *ctime;
+        GDateTime *mtime;
+        int default_image = 0;
+        int i;
+
+        notes = gr_recipe_get_notes (recipe);
+
+        // For readonly recipes, we just store notes
+        if (notes && notes[0])
+                g_key_file_set_string (keyfile, key, "Notes", notes);
+
+        if (gr_recipe_is_readonly (recipe))
+                return;
+
+        name = gr_recipe_get_name (recipe);
+        author = gr_recipe_get_author (recipe);
+        description = gr_recipe_get_description (recipe);
+        yield_unit = gr_recipe_get_yield_unit (recipe);
+        yield = gr_recipe_get_yield (recipe);
+        yield_str = g_strdup_printf ("%g %s", yield, yield_unit);
+        spiciness = gr_recipe_get_spiciness (recipe);
+        cuisine = gr_recipe_get_cuisine (recipe);
+        season = gr_recipe_get_season (recipe);
+        category = gr_recipe_get_category (recipe);
+        prep_time = gr_recipe_get_prep_time (recipe);
+        cook_time = gr_recipe_get_cook_time (recipe);
+        diets = gr_recipe_get_diets (recipe);
+        ingredients = gr_recipe_get_ingredients (recipe);
+        instructions = gr_recipe_get_instructions (recipe);
+        ctime = gr_recipe_get_ctime (recipe);
+        mtime = gr_recipe_get_mtime (recipe);
+        default_image = gr_recipe_get_default_image (recipe);
+        images = gr_recipe_get_images (recipe);
+
+        paths = g_new0 (char *, images->len + 1);
+        for (i = 0; i < images->len; i++) {
+                GrImage *ri = g_ptr_array_index (images, i);
+                const char *img_path = gr_image_get_path (ri);
+                paths[i] = g_strdup (img_path);
+        }
+
+        g_key_file_set_string (keyfile, key, "Name", name ? name : "");
+        g_key_file_set_string (keyfile, key, "Author", author ? author : "");
+        g_key_file_set_string (keyfile, key, "Description", description ? description : "");
+        g_key_file_set_string (keyfile, key, "Cuisine", cuisine ? cuisine : "");
+        g_key_file_set_string (keyfile, key, "Season", season ? season : "");
+        g_key_file_set_string (keyfile, key, "Category", category ? category : "");
+        g_key_file_set_string (keyfile, key, "PrepTime", prep_time ? prep_time : "");
+        g_key_file_set_string (keyfile, key, "CookTime", cook_time ? cook_time : "");
+        g_key_file_set_string (keyfile, key, "Ingredients", ingredients ? ingredients : "");
+        g_key_file_set_string (keyfile, key, "Instructions", instructions ? instructions : "");
+        g_key_file_set_integer (keyfile, key, "Serves", (int)yield);
+        g_key_file_set_string (keyfile, key, "Yield", yield_str ? yield_str : "");
+        g_key_file_set_integer (keyfile, key, "Spiciness", spiciness);
+        g_key_file_set_integer (keyfile, key, "Diets", diets);
+        g_key_file_set_integer (keyfile, key, "DefaultImage", default_image);
+        g_key_file_set_string_list (keyfile, key, "Images", (const char * const *)paths, images->len);
+        if (ctime) {
+                g_autofree char *created = date_time_to_string (ctime);
+                g_key_file_set_string (keyfile, key, "Created", created);
+        }
+        if (mtime) {
+                g_autofree char *modified = date_time_to_string (mtime);
+                g_key_file_set_string (keyfile, key, "Modified", modified);
+        }
+}
+
+static void
+compact_recipes_at_startup (const char *dir)
+{
+        g_autofree char *journal = NULL;
+        g_autofree char *compacting = NULL;
+        const char *journals[3];
+        g_autoptr(GError) error = NULL;
+
+        journal = g_build_filename (dir, "recipes.journal", NULL);
+        compacting = g_build_filename (dir, "recipes.journal.compacting", NULL);
+
+        if (!g_file_test (journal, G_FILE_TEST_EXISTS) &&
+            !g_file_test (compacting, G_FILE_TEST_EXISTS))
+                return;
+
+        g_info ("Compact recipe journal: %s", journal);
+
+        journals[0] = compacting;
+        journals[1] = journal;
+        journals[2] = NULL;
+
+        if (!gr_recipe_journal_compact (dir, journals, &error))
+                g_warning ("Failed to compact recipe journal: %s", error->message);
+}
+
+static void
+compact_thread (GTask        *task,
+                gpointer      source,
+                gpointer      task_data,
+                GCancellable *cancellable)
+{
+        const char *dir = task_data;
+        g_autofree char *compacting = NULL;
+        const char *journals[2];
+        GError *error = NULL;
+
+        compacting = g_build_filename (dir, "recipes.journal.compacting", NULL);
+        journals[0] = compacting;
+        journals[1] = NULL;
+
+        if (gr_recipe_journal_compact (dir, journals, &error))
+                g_task_return_boolean (task, TRUE);
+        else
+                g_task_return_error (task, error);
+}
+
+static void
+compact_done (GObject      *source,
+              GAsyncResult *result,
+              gpointer      data)
+{
+        GrRecipeStore *self = GR_RECIPE_STORE (source);
+        g_autoptr(GError) error = NULL;
+
+        self->compacting = FALSE;
+
+        if (!g_task_propagate_boolean (G_TASK (result), &error))
+                g_warning ("Failed to compact recipe journal: %s", error->message);
+        else
+                g_info ("Compacted recipe journal");
+}
+
+static void
+compact_recipes (GrRecipeStore *self)
+{
+        g_autoptr(GTask) task = NULL;
+        g_autofree char *journal = NULL;
+        g_autofree char *compacting = NULL;
+        const char *dir;
+
+        if (self->compacting)
+                return;
+
+        dir = get_user_data_dir ();
+        journal = g_build_filename (dir, "recipes.journal", NULL);
+        compacting = g_build_filename (dir, "recipes.journal.compacting", NULL);
+
+        /* New entries go to a fresh journal while we compact. If an
+         * earlier compaction failed, its journal is still around, and
+         * renaming over it would lose its entries.
+         */
+        if (g_file_test (compacting, G_FILE_TEST_EXISTS)) {
+                g_autoptr(GError) error = NULL;
 
-                recipe = g_hash_table_lookup (self->recipes, id);
-                if (recipe) {
-                        if (gr_recipe_is_readonly (recipe))
-                                g_object_set (recipe,
-                                              "notes", notes,
-                                              NULL);
-                        else
-                                g_object_set (recipe,
-                                              "id", id,
-                                              "name", name,
-                                              "author", author,
-                                              "description", description,
-                                              "cuisine", cuisine,
-                                              "season", season,
-                                              "category", category,
-                                              "prep-time", prep_time,
-                                              "cook-time", cook_time,
-                                              "ingredients", ingredients,
-                                              "instructions", instructions,
-                                              "spiciness", spiciness,
-                                              "diets", diets,
-                                              "images", images,
-                                              "default-image", default_image,
-                                              "yield-unit", yield_unit,
-                                              "yield", yield,
-                                              "mtime", mtime,
-                                              NULL);
-                }
-                else {
-                        gboolean own;
-
-                        own = g_strcmp0 (author, self->user) == 0;
-                        recipe = g_object_new (GR_TYPE_RECIPE,
-                                               "id", id,
-                                               "name", name,
-                                               "author", author,
-                                               "description", description,
-                                               "cuisine", cuisine,
-                                               "season", season,
-                                               "category", category,
-                                               "prep-time", prep_time,
-                                               "cook-time", cook_time,
-                                               "ingredients", ingredients,
-                                               "instructions", instructions,
-                                               "notes", notes,
-                                               "spiciness", spiciness,
-                                               "diets", diets,
-                                               "images", images,
-                                               "default-image", default_image,
-                                               "yield-unit", yield_unit,
-                                               "yield", yield,
-                                               "ctime", ctime,
-                                               "mtime", mtime,
-                                               "contributed", contributed,
-                                               "readonly", contributed && !own,
-                                               NULL);
-                        g_hash_table_insert (self->recipes, g_strdup (id), recipe);
+                if (!gr_recipe_journal_concat (compacting, journal, &error)) {
+                        g_warning ("Failed to append %s to %s: %s", journal, compacting, error->message);
+                        return;
                 }
         }
+        else if (g_rename (journal, compacting) != 0) {
+                g_warning ("Failed to rename %s: %s", journal, g_strerror (errno));
+                return;
+        }
 
-        return TRUE;
+        self->journal_length = 0;
+        self->compacting = TRUE;
+
+        task = g_task_new (self, NULL, compact_done, NULL);
+        g_task_set_task_data (task, g_strdup (dir), g_free);
+        g_task_run_in_thread (task, compact_thread);
 }
 
 static void
-save_recipes (GrRecipeStore *self)
+flush_recipes (GrRecipeStore *self)
 {
-        g_autoptr(GKeyFile) keyfile = NULL;
+        g_autoptr(GString) entries = NULL;
         g_autofree char *path = NULL;
-        const char *key;
-        GrRecipe *recipe;
         g_autoptr(GError) error = NULL;
-        const char *dir;
-        GList *keys, *l;
+        GHashTableIter iter;
+        const char *id;
 
-        keyfile = g_key_file_new ();
+        if (self->save_timeout) {
+                g_source_remove (self->save_timeout);
+                self->save_timeout = 0;
+        }
 
-        dir = get_user_data_dir ();
-        path = g_build_filename (dir, "recipes.db", NULL);
+        if (g_hash_table_size (self->dirty) == 0)
+                return;
 
-        g_info ("Save recipe db: %s", path);
+        path = g_build_filename (get_user_data_dir (), "recipes.journal", NULL);
 
-        g_key_file_set_integer (keyfile, "Metadata", "Version", 1);
+        g_info ("Save %d recipes to journal: %s", g_hash_table_size (self->dirty), path);
 
-        keys = g_hash_table_get_keys (self->recipes);
-        keys = g_list_sort (keys, (GCompareFunc)strcmp);
-        for (l = keys; l; l = l->next) {
-                const char *name;
-                const char *author;
-                const char *description;
-                const char *cuisine;
-                const char *season;
-                const char *category;
-                const char *prep_time;
-                const char *cook_time;
-                const char *ingredients;
-                const char *instructions;
-                const char *notes;
-                const char *yield_unit;
-                double yield;
-                g_autofree char *yield_str = NULL;
-                GPtrArray *images;
-                int spiciness;
-                GrDiets diets;
-                g_auto(GStrv) paths = NULL;
-                GDateTime *ctime;
-                GDateTime *mtime;
-                int default_image = 0;
-                int i;
-                gboolean readonly;
+        entries = g_string_new ("");
 
-                key = l->data;
-                recipe = g_hash_table_lookup (self->recipes, key);
-
-                name = gr_recipe_get_name (recipe);
-                author = gr_recipe_get_author (recipe);
-                description = gr_recipe_get_description (recipe);
-                yield_unit = gr_recipe_get_yield_unit (recipe);
-                yield = gr_recipe_get_yield (recipe);
-                yield_str = g_strdup_printf ("%g %s", yield, yield_unit);
-                spiciness = gr_recipe_get_spiciness (recipe);
-                cuisine = gr_recipe_get_cuisine (recipe);
-                season = gr_recipe_get_season (recipe);
-                category = gr_recipe_get_category (recipe);
-                prep_time = gr_recipe_get_prep_time (recipe);
-                cook_time = gr_recipe_get_cook_time (recipe);
-                diets = gr_recipe_get_diets (recipe);
-                ingredients = gr_recipe_get_ingredients (recipe);
-                instructions = gr_recipe_get_instructions (recipe);
-                notes = gr_recipe_get_notes (recipe);
-                ctime = gr_recipe_get_ctime (recipe);
-                mtime = gr_recipe_get_mtime (recipe);
-                default_image = gr_recipe_get_default_image (recipe);
-                readonly = gr_recipe_is_readonly (recipe);
-                images = gr_recipe_get_images (recipe);
-
-                paths = g_new0 (char *, images->len + 1);
-                for (i = 0; i < images->len; i++) {
-                        GrImage *ri = g_ptr_array_index (images, i);
-                        const char *img_path = gr_image_get_path (ri);
-                        paths[i] = g_strdup (img_path);
-                }
+        g_hash_table_iter_init (&iter, self->dirty);
+        while (g_hash_table_iter_next (&iter, (gpointer *)&id, NULL)) {
+                g_autoptr(GKeyFile) entry = NULL;
+                g_autofree char *group = NULL;
+                GrRecipe *recipe;
 
-                // For readonly recipes, we just store notes
-                if (notes && notes[0])
-                        g_key_file_set_string (keyfile, key, "Notes", notes);
+                entry = g_key_file_new ();
+                group = g_strdup_printf ("Entry %d", ++self->journal_length);
 
-                if (readonly)
-                        continue;
+                g_key_file_set_string (entry, group, "Id", id);
 
-                g_key_file_set_string (keyfile, key, "Name", name ? name : "");
-                g_key_file_set_string (keyfile, key, "Author", author ? author : "");
-                g_key_file_set_string (keyfile, key, "Description", description ? description : "");
-                g_key_file_set_string (keyfile, key, "Cuisine", cuisine ? cuisine : "");
-                g_key_file_set_string (keyfile, key, "Season", season ? season : "");
-                g_key_file_set_string (keyfile, key, "Category", category ? category : "");
-                g_key_file_set_string (keyfile, key, "PrepTime", prep_time ? prep_time : "");
-                g_key_file_set_string (keyfile, key, "CookTime", cook_time ? cook_time : "");
-                g_key_file_set_string (keyfile, key, "Ingredients", ingredients ? ingredients : "");
-                g_key_file_set_string (keyfile, key, "Instructions", instructions ? instructions : "");
-                g_key_file_set_integer (keyfile, key, "Serves", (int)yield);
-                g_key_file_set_string (keyfile, key, "Yield", yield_str ? yield_str : "");
-                g_key_file_set_integer (keyfile, key, "Spiciness", spiciness);
-                g_key_file_set_integer (keyfile, key, "Diets", diets);
-                g_key_file_set_integer (keyfile, key, "DefaultImage", default_image);
-                g_key_file_set_string_list (keyfile, key, "Images", (const char * const *)paths, images->len);
-                if (ctime) {
-                        g_autofree char *created = date_time_to_string (ctime);
-                        g_key_file_set_string (keyfile, key, "Created", created);
-                }
-                if (mtime) {
-                        g_autofree char *modified = date_time_to_string (mtime);
-                        g_key_file_set_string (keyfile, key, "Modified", modified);
-                }
+                recipe = g_hash_table_lookup (self->recipes, id);
+                if (recipe)
+                        write_recipe_keys (entry, group, recipe);
+                else
+                        g_key_file_set_boolean (entry, group, "Removed", TRUE);
+
+                gr_recipe_journal_add_entry (entries, entry);
         }
 
-        g_list_free (keys);
+        g_hash_table_remove_all (self->dirty);
 
-        if (!g_key_file_save_to_file (keyfile, path, &error)) {
+        if (!gr_recipe_journal_append (path, entries->str, entries->len, &error))
                 g_error ("Failed to save recipe database: %s", error->message);
-        }
+
+        if (self->journal_length >= JOURNAL_COMPACT_LENGTH)
+                compact_recipes (self);
+}
+
+static gboolean
+save_timeout (gpointer data)
+{
+        GrRecipeStore *self = data;
+
+        self->save_timeout = 0;
+        flush_recipes (self);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+save_recipe (GrRecipeStore *self,
+             const char    *id)
+{
+        g_hash_table_add (self->dirty, g_strdup (id));
+
+        if (self->save_timeout == 0)
+                self->save_timeout = g_timeout_add_seconds (SAVE_TIMEOUT, save_timeout, self);
 }
 
 static gboolean
@@ -716,9 +740,11 @@ static void
 load_favorites (GrRecipeStore *self)
 {
         GSettings *settings = gr_settings_get ();
+        g_auto(GStrv) favorites = NULL;
         gint64 timestamp;
 
-        self->favorites = g_settings_get_strv (settings, "favorites");
+        favorites = g_settings_get_strv (settings, "favorites");
+        self->favorites = gr_string_set_new ((const char * const *)favorites);
         timestamp = g_settings_get_int64 (settings, "favorites-last-change");
         self->favorite_change = g_date_time_new_from_unix_utc (timestamp);
 }
@@ -729,7 +755,7 @@ save_favorites (GrRecipeStore *self)
         GSettings *settings = gr_settings_get ();
         gint64 timestamp;
 
-        g_settings_set_strv (settings, "favorites", (const char * const *)self->favorites);
+        g_settings_set_strv (settings, "favorites", gr_string_set_get_strv (self->favorites));
         timestamp = g_date_time_to_unix (self->favorite_change);
         g_settings_set_int64 (settings, "favorites-last-change", timestamp);
 }
@@ -738,8 +764,10 @@ static void
 load_export_list (GrRecipeStore *self)
 {
         GSettings *settings = gr_settings_get ();
+        g_auto(GStrv) export_list = NULL;
 
-        self->export_list = g_settings_get_strv (settings, "export-list");
+        export_list = g_settings_get_strv (settings, "export-list");
+        self->export_list = gr_string_set_new ((const char * const *)export_list);
 }
 
 static void
@@ -747,7 +775,22 @@ save_export_list (GrRecipeStore *self)
 {
         GSettings *settings = gr_settings_get ();
 
-        g_settings_set_strv (settings, "export-list", (const char * const *)self->export_list);
+        g_settings_set_strv (settings, "export-list", gr_string_set_get_strv (self->export_list));
+}
+
+/* The shopping list maps recipe ids to yields. It is only
+ * turned into a GVariant when it is saved to GSettings.
+ */
+static void
+set_shopping_yield (GrRecipeStore *self,
+                    const char    *id,
+                    double         yield)
+{
+        double *value;
+
+        value = g_new (double, 1);
+        *value = yield;
+        g_hash_table_insert (self->shopping_list, g_strdup (id), value);
 }
 
 static void
@@ -755,31 +798,60 @@ load_shopping (GrRecipeStore *self)
 {
         GSettings *settings = gr_settings_get ();
         g_autoptr(GVariant) value = NULL;
+        g_auto(GStrv) removed = NULL;
+        GVariantIter iter;
+        const char *id;
+        GVariant *yield;
         gint64 timestamp;
 
+        self->shopping_list = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
         value = g_settings_get_value (settings, "shopping-list");
-        self->shopping_list = g_variant_dict_new (value);
+        g_variant_iter_init (&iter, value);
+        while (g_variant_iter_next (&iter, "{&sv}", &id, &yield)) {
+                if (g_variant_is_of_type (yield, G_VARIANT_TYPE_DOUBLE))
+                        set_shopping_yield (self, id, g_variant_get_double (yield));
+                g_variant_unref (yield);
+        }
+
         timestamp = g_settings_get_int64 (settings, "shopping-list-last-change");
         self->shopping_change = g_date_time_new_from_unix_utc (timestamp);
-        self->shopping_removed = g_settings_get_strv (settings, "shopping-list-removed-ingredients");
+        removed = g_settings_get_strv (settings, "shopping-list-removed-ingredients");
+        self->shopping_removed = gr_string_set_new ((const char * const *)removed);
 }
 
 static void
 save_shopping (GrRecipeStore *self)
 {
         GSettings *settings = gr_settings_get ();
-        g_autoptr(GVariant) value = NULL;
+        GVariantBuilder builder;
+        GHashTableIter iter;
+        const char *id;
+        double *yield;
         gint64 timestamp;
 
-        g_settings_set_strv (settings, "shopping-list-removed-ingredients", (const char * const *)self->shopping_removed);
-        value = g_variant_ref_sink (g_variant_dict_end (self->shopping_list));
-        g_settings_set_value (settings, "shopping-list", value);
-        g_variant_dict_unref (self->shopping_list);
-        self->shopping_list = g_variant_dict_new (value);
+        g_settings_set_strv (settings, "shopping-list-removed-ingredients", gr_string_set_get_strv (self->shopping_removed));
+
+        g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+        g_hash_table_iter_init (&iter, self->shopping_list);
+        while (g_hash_table_iter_next (&iter, (gpointer *)&id, (gpointer *)&yield))
+                g_variant_builder_add (&builder, "{sv}", id, g_variant_new_double (*yield));
+        g_settings_set_value (settings, "shopping-list", g_variant_builder_end (&builder));
+
         timestamp = g_date_time_to_unix (self->shopping_change);
         g_settings_set_int64 (settings, "shopping-list-last-change", timestamp);
 }
 
+static void
+save_shopping_change (GrRecipeStore *self)
+{
+        if (self->shopping_change)
+                g_date_time_unref (self->shopping_change);
+        self->shopping_change = g_date_time_new_now_utc ();
+
+        save_shopping (self);
+}
+
 static gboolean
 load_chefs (GrRecipeStore *self,
             const char    *dir,
@@ -981,99 +1053,139 @@ get_data_cache_dir (void)
 static gboolean
 should_try_load (const char *path)
 {
-        g_autoptr(GFile) file = NULL;
-        g_autoptr(GFileInfo) info = NULL;
-        gboolean result = TRUE;
-
-        file = g_file_new_for_path (path);
-        info = g_file_query_info (file,
-                                  G_FILE_ATTRIBUTE_TIME_MODIFIED,
-                                  G_FILE_QUERY_INFO_NONE,
-                                  NULL,
-                                  NULL);
-        if (info) {
-                GTimeVal tv;
-                g_autoptr(GDateTime) now = NULL;
-                g_autoptr(GDateTime) mtime = NULL;
-
-                g_file_info_get_modification_time (info, &tv);
+        g_autoptr(GrCacheEntry) entry = NULL;
+        GTimeSpan age;
+        gboolean result;
 
-                now = g_date_time_new_now_utc ();
-                mtime = g_date_time_new_from_timeval_utc (&tv);
+        entry = gr_cache_index_lookup (gr_cache_index_get_default (), path);
+        if (entry == NULL)
+                return TRUE;
 
-                result = g_date_time_difference (now, mtime) > G_TIME_SPAN_DAY;
-                g_debug ("Cached file for %s is %s",
-                         path,
-                         result ? "old, trying again" : "new enough");
-        }
+        age = (g_get_real_time () / G_USEC_PER_SEC - entry->fetched) * G_USEC_PER_SEC;
+        result = age > G_TIME_SPAN_DAY;
+        g_debug ("Cached file for %s is %s",
+                 path,
+                 result ? "old, trying again" : "new enough");
 
         return result;
 }
 
-static void
-set_modified_request (SoupMessage *msg,
-                      const char  *path)
+static gboolean
+strv_equal (char **a,
+            char **b)
 {
-        g_autoptr(GFile) file = NULL;
-        g_autoptr(GFileInfo) info = NULL;
-        GTimeVal tv;
-        g_autoptr(GDateTime) mtime = NULL;
-        g_autofree char *mod_date = NULL;
+        int i;
 
-        file = g_file_new_for_path (path);
-        info = g_file_query_info (file,
-                                  G_FILE_ATTRIBUTE_TIME_MODIFIED,
-                                  G_FILE_QUERY_INFO_NONE,
-                                  NULL,
-                                  NULL);
+        if (a == NULL || b == NULL)
+                return a == b;
 
-        if (info) {
-                g_file_info_get_modification_time (info, &tv);
-                mtime = g_date_time_new_from_timeval_utc (&tv);
-                mod_date = g_date_time_format (mtime, "%a, %d %b %Y %H:%M:%S %Z");
-                soup_message_headers_append (msg->request_headers, "If-Modified-Since", mod_date);
+        for (i = 0; a[i] && b[i]; i++) {
+                if (strcmp (a[i], b[i]) != 0)
+                        return FALSE;
         }
+
+        return a[i] == NULL && b[i] == NULL;
 }
 
-static void
-update_file_timestamp (const char *path)
+static gboolean
+record_is_newer (GVariant *record,
+                 GrRecipe *recipe)
 {
-        g_autoptr(GFile) file = NULL;
-        g_autoptr(GDateTime) now = NULL;
-        guint64 mtime;
+        GDateTime *mtime;
+        gint64 time;
 
-        now = g_date_time_new_now_utc ();
-        mtime = (guint64)g_date_time_to_unix (now);
+        mtime = gr_recipe_get_mtime (recipe);
+        if (!gr_recipe_snapshot_get_time (record, GR_SNAPSHOT_MTIME, &time) || !mtime)
+                return TRUE;
 
-        file = g_file_new_for_path (path);
-        g_file_set_attribute_uint64 (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime, 0, NULL, NULL);
-        g_debug ("updating timestamp for %s", path);
+        return time != g_date_time_to_unix (mtime);
 }
 
+/* Brings the contributed recipes in line with a freshly downloaded
+ * recipe db. Only recipes whose modification time differs are
+ * touched, and each change is announced with its own signal, so
+ * views can update just the affected tiles. Recipes that the user
+ * has edited are left alone.
+ */
 static void
-empty_store (GrRecipeStore *self)
+update_recipes (GrRecipeStore *self,
+                const char    *dir)
 {
+        g_autoptr(GVariant) records = NULL;
+        g_autoptr(GHashTable) ids = NULL;
+        g_autoptr(GPtrArray) removed = NULL;
         GHashTableIter iter;
-        char *key;
         GrRecipe *recipe;
-        GrChef *chef;
+        gsize length;
+        int i;
 
-        g_hash_table_iter_init (&iter, self->recipes);
-        while (g_hash_table_iter_next (&iter, (gpointer *)&key, (gpointer *)&recipe)) {
-                g_hash_table_iter_remove (&iter);
+        records = load_records (dir);
+        if (!records)
+                return;
+
+        ids = g_hash_table_new (g_str_hash, g_str_equal);
+
+        length = g_variant_n_children (records);
+        for (i = 0; i < length; i++) {
+                g_autoptr(GVariant) record = NULL;
+                GrRecipeFields fields = { NULL, };
+                g_autoptr(GPtrArray) images = NULL;
+                g_autoptr(GDateTime) ctime = NULL;
+                g_autoptr(GDateTime) mtime = NULL;
+
+                record = g_variant_get_child_value (records, i);
+                get_record_fields (record, &fields);
+
+                g_hash_table_add (ids, (gpointer)fields.id);
+
+                recipe = g_hash_table_lookup (self->recipes, fields.id);
+                if (recipe && !gr_recipe_is_readonly (recipe))
+                        continue;
+
+                if (recipe && !record_is_newer (record, recipe))
+                        continue;
+
+                images = get_record_images (record);
+                mtime = get_record_time (record, GR_SNAPSHOT_MTIME);
+                fields.images = images;
+                fields.mtime = mtime;
+                fields.contributed = TRUE;
+
+                if (recipe) {
+                        /* The notes come from the user db */
+                        fields.notes = gr_recipe_get_notes (recipe);
+                        fields.readonly = TRUE;
+                        gr_recipe_set_fields (recipe, &fields);
+                        gr_recipe_set_snapshot (recipe, record);
+                        g_signal_emit_by_name (self, "recipe-changed", recipe);
+                }
+                else {
+                        ctime = get_record_time (record, GR_SNAPSHOT_CTIME);
+                        fields.ctime = ctime;
+                        fields.readonly = g_strcmp0 (fields.author, self->user) != 0;
+                        recipe = gr_recipe_new_from_fields (&fields);
+                        g_hash_table_insert (self->recipes, g_strdup (fields.id), recipe);
+                        gr_recipe_set_snapshot (recipe, record);
+                        g_signal_emit_by_name (self, "recipe-added", recipe);
+                }
         }
 
-        g_hash_table_iter_init (&iter, self->chefs);
-        while (g_hash_table_iter_next (&iter, (gpointer *)&key, (gpointer *)&chef)) {
+        removed = g_ptr_array_new_with_free_func (g_object_unref);
+
+        g_hash_table_iter_init (&iter, self->recipes);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&recipe)) {
+                if (!gr_recipe_is_contributed (recipe) || !gr_recipe_is_readonly (recipe))
+                        continue;
+
+                if (g_hash_table_contains (ids, gr_recipe_get_id (recipe)))
+                        continue;
+
+                g_ptr_array_add (removed, g_object_ref (recipe));
                 g_hash_table_iter_remove (&iter);
         }
 
-        g_clear_pointer (&self->todays, g_strfreev);
-        g_clear_pointer (&self->picks, g_strfreev);
-        g_clear_pointer (&self->favorites, g_strfreev);
-        g_clear_pointer (&self->export_list, g_strfreev);
-        g_clear_pointer (&self->featured_chefs, g_strfreev);
-        g_clear_pointer (&self->shopping_list, g_variant_dict_unref);
+        for (i = 0; i < removed->len; i++)
+                g_signal_emit_by_name (self, "recipe-removed", g_ptr_array_index (removed, i));
 }
 
 static void
@@ -1081,25 +1193,31 @@ reload_updates (GrRecipeStore *self)
 {
         g_autofree char *cache_dir = NULL;
         const char *user_dir;
+        g_auto(GStrv) todays = NULL;
+        g_auto(GStrv) picks = NULL;
+        g_auto(GStrv) featured_chefs = NULL;
 
         g_debug ("New data obtained, reloading!");
 
-        empty_store (self);
-
         cache_dir = get_data_cache_dir ();
         user_dir = get_user_data_dir ();
 
-        load_recipes (self, cache_dir, TRUE);
-        load_chefs (self, cache_dir, TRUE);
-        load_picks (self, cache_dir);
+        update_recipes (self, cache_dir);
 
-        load_recipes (self, user_dir, FALSE);
+        load_chefs (self, cache_dir, TRUE);
         load_chefs (self, user_dir, FALSE);
-        load_favorites (self);
-        load_export_list (self);
-        load_shopping (self);
+        g_signal_emit_by_name (self, "chefs-changed");
+
+        todays = g_steal_pointer (&self->todays);
+        picks = g_steal_pointer (&self->picks);
+        featured_chefs = g_steal_pointer (&self->featured_chefs);
+
+        load_picks (self, cache_dir);
 
-        g_signal_emit_by_name (self, "reloaded", 0);
+        if (!strv_equal (todays, self->todays) ||
+            !strv_equal (picks, self->picks) ||
+            !strv_equal (featured_chefs, self->featured_chefs))
+                g_signal_emit_by_name (self, "reloaded", 0);
 }
 
 static void
@@ -1124,8 +1242,10 @@ save_file (SoupSession *session,
            gpointer     data)
 {
         GrRecipeStore *self = data;
+        GrCacheIndex *index;
         const char *cache_dir;
         g_autofree char *filename = NULL;
+        g_autofree char *url = NULL;
         const char *argv[6];
         g_autofree char *cmdline = NULL;
         g_autoptr(GSubprocess) subprocess = NULL;
@@ -1137,15 +1257,14 @@ save_file (SoupSession *session,
                 goto out;
         }
 
+        index = gr_cache_index_get_default ();
         cache_dir = get_user_cache_dir ();
         filename = g_build_filename (cache_dir, "data.tar.gz", NULL);
+        url = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
 
         if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
-                g_autofree char *f = NULL;
-
                 g_debug ("File not modified");
-                f = g_build_filename (cache_dir, "data", "recipes.db", NULL);
-                update_file_timestamp (f);
+                gr_cache_index_update_from_message (index, filename, url, msg);
         }
         else if (msg->status_code == SOUP_STATUS_OK) {
                 g_debug ("Saving file to %s", filename);
@@ -1153,9 +1272,11 @@ save_file (SoupSession *session,
                         g_debug ("Saving file to %s failed", filename);
                         goto out;
                 }
+                gr_cache_index_update_from_message (index, filename, url, msg);
         }
         else {
                 g_warning ("Failed to load %s", filename);
+                gr_cache_index_update_from_message (index, filename, url, msg);
                 goto out;
         }
 
@@ -1193,11 +1314,9 @@ static gboolean
 load_updates (gpointer data)
 {
         GrRecipeStore *self = data;
-        g_autofree char *cache_dir = NULL;
         g_autofree char *filename = NULL;
 
-        cache_dir = get_data_cache_dir ();
-        filename = g_build_filename (cache_dir, "recipes.db", NULL);
+        filename = g_build_filename (get_user_cache_dir (), "data.tar.gz", NULL);
         if (should_try_load (filename)) {
                 g_autofree char *url;
                 g_autoptr(SoupURI) base_uri = NULL;
@@ -1205,7 +1324,8 @@ load_updates (gpointer data)
                 url = get_file_url ("data.tar.gz");
                 base_uri = soup_uri_new (url);
                 self->recipes_message = soup_message_new_from_uri (SOUP_METHOD_GET, base_uri);
-                set_modified_request (self->recipes_message, filename);
+                gr_cache_index_add_validators (gr_cache_index_get_default (), filename,
+                                               self->recipes_message->request_headers);
                 g_debug ("Load file for data.tar.gz from %s", url);
                 soup_session_queue_message (self->session, g_object_ref (self->recipes_message), save_file, self);
         }
@@ -1215,6 +1335,139 @@ load_updates (gpointer data)
         return G_SOURCE_REMOVE;
 }
 
+static void
+index_recipe (GrRecipeStore *self,
+              GrRecipe      *recipe)
+{
+        const char *texts[5];
+        const char *cf_name;
+        const char *cf_description;
+        const char *cf_ingredients;
+        const char *cf_fullname = NULL;
+        const char *author;
+        int n = 0;
+
+        gr_recipe_get_search_texts (recipe, &cf_name, &cf_description, &cf_ingredients);
+
+        author = gr_recipe_get_author (recipe);
+        if (author) {
+                GrChef *chef;
+
+                chef = g_hash_table_lookup (self->chefs, author);
+                if (chef)
+                        cf_fullname = gr_chef_get_cf_fullname (chef);
+        }
+
+        if (cf_name)
+                texts[n++] = cf_name;
+        if (cf_description)
+                texts[n++] = cf_description;
+        if (cf_ingredients)
+                texts[n++] = cf_ingredients;
+        if (cf_fullname)
+                texts[n++] = cf_fullname;
+        texts[n] = NULL;
+
+        gr_recipe_index_add (self->index, recipe, texts);
+}
+
+static void
+ensure_index (GrRecipeStore *self)
+{
+        GHashTableIter iter;
+        GrRecipe *recipe;
+
+        if (self->index_valid)
+                return;
+
+        gr_recipe_index_clear (self->index);
+
+        g_hash_table_iter_init (&iter, self->recipes);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&recipe))
+                index_recipe (self, recipe);
+
+        self->index_valid = TRUE;
+}
+
+static void
+update_index (GrRecipeStore *self,
+              GrRecipe      *recipe)
+{
+        if (self->index_valid)
+                index_recipe (self, recipe);
+}
+
+static void
+remove_from_index (GrRecipeStore *self,
+                   GrRecipe      *recipe)
+{
+        if (self->index_valid)
+                gr_recipe_index_remove (self->index, recipe);
+}
+
+static void
+invalidate_index (GrRecipeStore *self)
+{
+        self->index_valid = FALSE;
+}
+
+static guint overview_changed_signal;
+
+static void
+emit_overview_changed (GrRecipeStore    *self,
+                       GrOverviewChange  change)
+{
+        if (change != 0)
+                g_signal_emit (self, overview_changed_signal, 0, change);
+}
+
+static void
+uncount_recipe (GrRecipeStore *self,
+                GrRecipe      *recipe)
+{
+        emit_overview_changed (self, gr_recipe_overview_remove (self->overview, recipe));
+}
+
+static GrOverviewChange
+add_to_overview (GrRecipeStore *self,
+                 GrRecipe      *recipe)
+{
+        GrOverviewFields fields;
+
+        fields.id = gr_recipe_get_id (recipe);
+        fields.author = gr_recipe_get_author (recipe);
+        fields.cuisine = gr_recipe_get_cuisine (recipe);
+        fields.season = gr_recipe_get_season (recipe);
+        fields.diets = gr_recipe_get_diets (recipe);
+        fields.contributed = gr_recipe_is_contributed (recipe);
+
+        return gr_recipe_overview_add (self->overview, recipe, &fields);
+}
+
+static void
+count_recipe (GrRecipeStore *self,
+              GrRecipe      *recipe)
+{
+        emit_overview_changed (self, add_to_overview (self, recipe));
+}
+
+/* Used when recipes are loaded, ::reloaded tells about the changes */
+static void
+recount_recipes (GrRecipeStore *self)
+{
+        GHashTableIter iter;
+        GrRecipe *recipe;
+
+        gr_recipe_overview_clear (self->overview);
+        gr_recipe_overview_set_featured (self->overview,
+                                         (const char * const *)self->todays,
+                                         (const char * const *)self->picks);
+
+        g_hash_table_iter_init (&iter, self->recipes);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&recipe))
+                add_to_overview (self, recipe);
+}
+
 static void
 gr_recipe_store_init (GrRecipeStore *self)
 {
@@ -1225,6 +1478,19 @@ gr_recipe_store_init (GrRecipeStore *self)
         self->recipes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
         self->chefs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
         self->session = gr_app_get_soup_session (GR_APP (g_application_get_default ()));
+        self->index = gr_recipe_index_new ();
+        self->dirty = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        self->overview = gr_recipe_overview_new ();
+
+        g_signal_connect (self, "recipe-added", G_CALLBACK (update_index), NULL);
+        g_signal_connect (self, "recipe-changed", G_CALLBACK (update_index), NULL);
+        g_signal_connect (self, "recipe-removed", G_CALLBACK (remove_from_index), NULL);
+        g_signal_connect (self, "chefs-changed", G_CALLBACK (invalidate_index), NULL);
+        g_signal_connect (self, "reloaded", G_CALLBACK (invalidate_index), NULL);
+        g_signal_connect (self, "recipe-added", G_CALLBACK (count_recipe), NULL);
+        g_signal_connect (self, "recipe-changed", G_CALLBACK (count_recipe), NULL);
+        g_signal_connect (self, "recipe-removed", G_CALLBACK (uncount_recipe), NULL);
+        g_signal_connect (self, "reloaded", G_CALLBACK (recount_recipes), NULL);
 
         data_dir = get_pkg_data_dir ();
         user_dir = get_user_data_dir ();
@@ -1251,14 +1517,20 @@ gr_recipe_store_init (GrRecipeStore *self)
         }
 
         /* Now load saved data */
+        compact_recipes_at_startup (user_dir);
         load_recipes (self, user_dir, FALSE);
         load_favorites (self);
         load_export_list (self);
         load_shopping (self);
         load_chefs (self, user_dir, FALSE);
 
+        recount_recipes (self);
+
         g_info ("%d recipes loaded", g_hash_table_size (self->recipes));
         g_info ("%d chefs loaded", g_hash_table_size (self->chefs));
+
+        g_signal_connect_object (g_application_get_default (), "shutdown",
+                                 G_CALLBACK (flush_recipes), self, G_CONNECT_SWAPPED);
 }
 
 static guint add_signal;
@@ -1266,6 +1538,7 @@ static guint remove_signal;
 static guint changed_signal;
 static guint chefs_changed_signal;
 static guint reloaded_signal;
+static guint shopping_changed_signal;
 
 static void
 gr_recipe_store_class_init (GrRecipeStoreClass *klass)
@@ -1309,6 +1582,20 @@ gr_recipe_store_class_init (GrRecipeStoreClass *klass)
                                         NULL, NULL,
                                         NULL,
                                         G_TYPE_NONE, 0);
+        shopping_changed_signal = g_signal_new ("shopping-changed",
+                                                G_TYPE_FROM_CLASS (object_class),
+                                                G_SIGNAL_RUN_LAST,
+                                                0,
+                                                NULL, NULL,
+                                                NULL,
+                                                G_TYPE_NONE, 0);
+        overview_changed_signal = g_signal_new ("overview-changed",
+                                                G_TYPE_FROM_CLASS (object_class),
+                                                G_SIGNAL_RUN_LAST,
+                                                0,
+                                                NULL, NULL,
+                                                NULL,
+                                                G_TYPE_NONE, 1, G_TYPE_UINT);
 }
 
 GrRecipeStore *
@@ -1340,15 +1627,100 @@ gr_recipe_store_add_recipe (GrRecipeStore  *self,
         }
 
         g_hash_table_insert (self->recipes, g_strdup (id), g_object_ref (recipe));
+
+        if (self->batch) {
+                g_ptr_array_add (self->batch, g_object_ref (recipe));
+                g_object_unref (recipe);
+                return TRUE;
+        }
+
         g_signal_emit (self, add_signal, 0, recipe);
 
-        save_recipes (self);
+        save_recipe (self, id);
 
         g_object_unref (recipe);
 
         return TRUE;
 }
 
+/* Batches
+ * -------
+ *
+ * Importing adds many recipes at once. Telling everybody about each
+ * of them, and rebuilding the indexes each time, makes that quadratic.
+ * Between gr_recipe_store_begin_batch() and gr_recipe_store_commit_batch(),
+ * added recipes are validated and inserted as usual, so that lookups
+ * and conflict checks see them, but nothing is emitted or saved. The
+ * commit saves them in one journal write and emits a single ::reloaded.
+ * gr_recipe_store_abort_batch() takes them out again.
+ */
+
+/**
+ * gr_recipe_store_begin_batch:
+ * @self: the store
+ *
+ * Starts a batch of recipe additions. Batches can't be nested.
+ */
+void
+gr_recipe_store_begin_batch (GrRecipeStore *self)
+{
+        g_return_if_fail (self->batch == NULL);
+
+        self->batch = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+/**
+ * gr_recipe_store_commit_batch:
+ * @self: the store
+ *
+ * Saves the recipes that were added since gr_recipe_store_begin_batch(),
+ * and emits #GrRecipeStore::reloaded if there were any.
+ */
+void
+gr_recipe_store_commit_batch (GrRecipeStore *self)
+{
+        g_autoptr(GPtrArray) batch = NULL;
+        guint i;
+
+        g_return_if_fail (self->batch != NULL);
+
+        batch = g_steal_pointer (&self->batch);
+        if (batch->len == 0)
+                return;
+
+        for (i = 0; i < batch->len; i++)
+                g_hash_table_add (self->dirty, g_strdup (gr_recipe_get_id (g_ptr_array_index (batch, i))));
+
+        flush_recipes (self);
+
+        g_signal_emit (self, reloaded_signal, 0);
+}
+
+/**
+ * gr_recipe_store_abort_batch:
+ * @self: the store
+ *
+ * Removes the recipes that were added since gr_recipe_store_begin_batch().
+ * Nothing has been emitted or saved for them, so there is nothing to undo.
+ */
+void
+gr_recipe_store_abort_batch (GrRecipeStore *self)
+{
+        g_autoptr(GPtrArray) batch = NULL;
+        guint i;
+
+        g_return_if_fail (self->batch != NULL);
+
+        batch = g_steal_pointer (&self->batch);
+        for (i = 0; i < batch->len; i++) {
+                GrRecipe *recipe = g_ptr_array_index (batch, i);
+                const char *id = gr_recipe_get_id (recipe);
+
+                if (g_hash_table_lookup (self->recipes, id) == recipe)
+                        g_hash_table_remove (self->recipes, id);
+        }
+}
+
 gboolean
 gr_recipe_store_update_recipe (GrRecipeStore  *self,
                                GrRecipe       *recipe,
@@ -1382,7 +1754,9 @@ gr_recipe_store_update_recipe (GrRecipeStore  *self,
 
         g_signal_emit (self, changed_signal, 0, recipe);
 
-        save_recipes (self);
+        if (strcmp (id, old_id) != 0)
+                save_recipe (self, old_id);
+        save_recipe (self, id);
 
         g_object_unref (recipe);
 
@@ -1402,7 +1776,7 @@ gr_recipe_store_remove_recipe (GrRecipeStore *self,
 
         if (g_hash_table_remove (self->recipes, id)) {
                 g_signal_emit (self, remove_signal, 0, recipe);
-                save_recipes (self);
+                save_recipe (self, id);
                 ret = TRUE;
         }
 
@@ -1457,7 +1831,44 @@ gr_recipe_store_recipe_is_pick (GrRecipeStore *self,
 
         id = gr_recipe_get_id (recipe);
 
-        return g_strv_contains ((const char *const*)self->picks, id);
+        return g_strv_contains ((const char *const*)self->picks, id);
+}
+
+static GPtrArray *
+ref_recipes (GPtrArray *recipes)
+{
+        g_ptr_array_foreach (recipes, (GFunc)g_object_ref, NULL);
+        g_ptr_array_set_free_func (recipes, g_object_unref);
+
+        return recipes;
+}
+
+/**
+ * gr_recipe_store_get_todays:
+ * @self: the store
+ *
+ * Returns today's recipes that are in the store, in no particular order.
+ *
+ * Returns: (transfer full) (element-type GrRecipe): the recipes
+ */
+GPtrArray *
+gr_recipe_store_get_todays (GrRecipeStore *self)
+{
+        return ref_recipes (gr_recipe_overview_get_todays (self->overview));
+}
+
+/**
+ * gr_recipe_store_get_picks:
+ * @self: the store
+ *
+ * Returns the picks that are in the store, in no particular order.
+ *
+ * Returns: (transfer full) (element-type GrRecipe): the recipes
+ */
+GPtrArray *
+gr_recipe_store_get_picks (GrRecipeStore *self)
+{
+        return ref_recipes (gr_recipe_overview_get_picks (self->overview));
 }
 
 GrChef *
@@ -1485,20 +1896,20 @@ char **
 gr_recipe_store_get_contributors (GrRecipeStore *self,
                                   guint         *length)
 {
-        GHashTableIter iter;
-        GrRecipe *recipe;
+        g_autofree char **authors = NULL;
+        guint n_authors;
+        guint i;
         g_autoptr(GHashTable) chefs = NULL;
 
         chefs = g_hash_table_new (g_str_hash, g_str_equal);
 
-        g_hash_table_iter_init (&iter, self->recipes);
-        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&recipe)) {
-                if (gr_recipe_is_contributed (recipe)) {
-                        GrChef *chef;
+        authors = gr_recipe_overview_get_contributors (self->overview, &n_authors);
+        for (i = 0; i < n_authors; i++) {
+                GrChef *chef;
 
-                        chef = g_hash_table_lookup (self->chefs, gr_recipe_get_author (recipe));
+                chef = g_hash_table_lookup (self->chefs, authors[i]);
+                if (chef && gr_chef_get_fullname (chef))
                         g_hash_table_add (chefs, (gpointer)gr_chef_get_fullname (chef));
-                }
         }
 
         return (char **)g_hash_table_get_keys_as_array (chefs, length);
@@ -1508,18 +1919,7 @@ char **
 gr_recipe_store_get_all_cuisines (GrRecipeStore *self,
                                   guint         *length)
 {
-        GHashTableIter iter;
-        GrRecipe *recipe;
-        g_autoptr(GHashTable) cuisines = NULL;
-
-        cuisines = g_hash_table_new (g_str_hash, g_str_equal);
-
-        g_hash_table_iter_init (&iter, self->recipes);
-        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &recipe)) {
-                if (gr_recipe_get_cuisine (recipe))
-                        g_hash_table_add (cuisines, (gpointer)gr_recipe_get_cuisine (recipe));
-        }
-        return (char **) g_hash_table_get_keys_as_array (cuisines, length);
+        return gr_recipe_overview_get_cuisines (self->overview, length);
 }
 
 const char *
@@ -1659,7 +2059,7 @@ gr_recipe_store_get_all_ingredients (GrRecipeStore *self,
         g_hash_table_iter_init (&iter, self->recipes);
         while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&recipe)) {
                 const char *ingredients;
-                GrIngredientsList *list = NULL;
+                GrIngredientsList *list;
                 g_autofree char **segments = NULL;
 
                 ingredients = gr_recipe_get_ingredients (recipe);
@@ -1667,7 +2067,7 @@ gr_recipe_store_get_all_ingredients (GrRecipeStore *self,
                 if (!ingredients || ingredients[0] == '\0')
                         continue;
 
-                list = gr_ingredients_list_new (ingredients);
+                list = gr_recipe_get_ingredients_list (recipe);
                 segments = gr_ingredients_list_get_segments (list);
                 for (j = 0; segments[j]; j++) {
                         g_autofree char **ret = NULL;
@@ -1675,8 +2075,6 @@ gr_recipe_store_get_all_ingredients (GrRecipeStore *self,
                         for (i = 0; ret[i]; i++)
                                 g_hash_table_add (ingreds, ret[i]);
                 }
-
-                g_object_unref (list);
         }
 
         result = (char **)g_hash_table_get_keys_as_array (ingreds, length);
@@ -1694,11 +2092,9 @@ gr_recipe_store_add_favorite (GrRecipeStore *self,
 
         id = gr_recipe_get_id (recipe);
 
-        if (g_strv_contains ((const char * const*)self->favorites, id))
+        if (!gr_string_set_prepend (self->favorites, id))
                 return;
 
-        strv_prepend (&self->favorites, id);
-
         if (self->favorite_change)
                 g_date_time_unref (self->favorite_change);
         self->favorite_change = g_date_time_new_now_utc ();
@@ -1712,20 +2108,11 @@ void
 gr_recipe_store_remove_favorite (GrRecipeStore *self,
                                  GrRecipe      *recipe)
 {
-        int i, j;
         const char *id;
 
         id = gr_recipe_get_id (recipe);
 
-        for (i = 0; self->favorites[i]; i++) {
-                if (strcmp (self->favorites[i], id) == 0) {
-                        g_free (self->favorites[i]);
-                        for (j = i; self->favorites[j]; j++) {
-                                self->favorites[j] = self->favorites[j + 1];
-                        }
-                        break;
-                }
-        }
+        gr_string_set_remove (self->favorites, id);
 
         if (self->favorite_change)
                 g_date_time_unref (self->favorite_change);
@@ -1747,7 +2134,7 @@ gr_recipe_store_is_favorite (GrRecipeStore *self,
 
         id = gr_recipe_get_id (recipe);
 
-        return g_strv_contains ((const char *const*)self->favorites, id);
+        return gr_string_set_contains (self->favorites, id);
 }
 
 GDateTime *
@@ -1764,11 +2151,9 @@ gr_recipe_store_add_export (GrRecipeStore *self,
 
         id = gr_recipe_get_id (recipe);
 
-        if (g_strv_contains ((const char * const*)self->export_list, id))
+        if (!gr_string_set_prepend (self->export_list, id))
                 return;
 
-        strv_prepend (&self->export_list, id);
-
         save_export_list (self);
 }
 
@@ -1776,20 +2161,11 @@ void
 gr_recipe_store_remove_export (GrRecipeStore *self,
                                GrRecipe      *recipe)
 {
-        int i, j;
         const char *id;
 
         id = gr_recipe_get_id (recipe);
 
-        for (i = 0; self->export_list[i]; i++) {
-                if (strcmp (self->export_list[i], id) == 0) {
-                        g_free (self->export_list[i]);
-                        for (j = i; self->export_list[j]; j++) {
-                                self->export_list[j] = self->export_list[j + 1];
-                        }
-                        break;
-                }
-        }
+        gr_string_set_remove (self->export_list, id);
 
         save_export_list (self);
 }
@@ -1797,14 +2173,13 @@ gr_recipe_store_remove_export (GrRecipeStore *self,
 const char **
 gr_recipe_store_get_export_list (GrRecipeStore *self)
 {
-        return (const char **)self->export_list;
+        return gr_string_set_get_strv (self->export_list);
 }
 
 void
 gr_recipe_store_clear_export_list (GrRecipeStore *self)
 {
-        g_strfreev (self->export_list);
-        self->export_list = g_new0 (char *, 1);
+        gr_string_set_remove_all (self->export_list);
 
         save_export_list (self);
 }
@@ -1817,13 +2192,9 @@ gr_recipe_store_add_to_shopping (GrRecipeStore *self,
         const char *id;
 
         id = gr_recipe_get_id (recipe);
-        g_variant_dict_insert (self->shopping_list, id, "d", yield);
+        set_shopping_yield (self, id, yield);
 
-        if (self->shopping_change)
-                g_date_time_unref (self->shopping_change);
-        self->shopping_change = g_date_time_new_now_utc ();
-
-        save_shopping (self);
+        save_shopping_change (self);
 
         g_signal_emit (self, changed_signal, 0, recipe);
 }
@@ -1835,33 +2206,63 @@ gr_recipe_store_remove_from_shopping (GrRecipeStore *self,
         const char *id;
 
         id = gr_recipe_get_id (recipe);
-        g_variant_dict_remove (self->shopping_list, id);
-
-        if (self->shopping_change)
-                g_date_time_unref (self->shopping_change);
-        self->shopping_change = g_date_time_new_now_utc ();
+        g_hash_table_remove (self->shopping_list, id);
 
-        save_shopping (self);
+        save_shopping_change (self);
 
         g_signal_emit (self, changed_signal, 0, recipe);
 }
 
+/**
+ * gr_recipe_store_add_recipes_to_shopping:
+ * @self: the store
+ * @recipes: (element-type GrRecipe): the recipes to add
+ * @yields: (array): the yields to add them with, one per recipe
+ *
+ * Adds all of @recipes to the shopping list at once. Unlike
+ * gr_recipe_store_add_to_shopping(), this does not emit
+ * #GrRecipeStore::recipe-changed for each recipe, but a single
+ * #GrRecipeStore::shopping-changed.
+ */
 void
-gr_recipe_store_clear_shopping_list (GrRecipeStore *self)
+gr_recipe_store_add_recipes_to_shopping (GrRecipeStore *self,
+                                         GPtrArray     *recipes,
+                                         const double  *yields)
 {
-        const char **empty[1] = { NULL };
+        guint i;
 
-        g_variant_dict_unref (self->shopping_list);
-        self->shopping_list = g_variant_dict_new (NULL);
+        if (recipes->len == 0)
+                return;
 
-        g_strfreev (self->shopping_removed);
-        self->shopping_removed = g_strdupv ((char **)empty);
+        for (i = 0; i < recipes->len; i++)
+                set_shopping_yield (self, gr_recipe_get_id (g_ptr_array_index (recipes, i)), yields[i]);
 
-        if (self->shopping_change)
-                g_date_time_unref (self->shopping_change);
-        self->shopping_change = g_date_time_new_now_utc ();
+        save_shopping_change (self);
 
-        save_shopping (self);
+        g_signal_emit (self, shopping_changed_signal, 0);
+}
+
+/**
+ * gr_recipe_store_clear_shopping_list:
+ * @self: the store
+ *
+ * Removes all recipes and removed ingredients from the shopping list,
+ * saves once and emits a single #GrRecipeStore::shopping-changed.
+ * Nothing happens if the list is already empty.
+ */
+void
+gr_recipe_store_clear_shopping_list (GrRecipeStore *self)
+{
+        if (g_hash_table_size (self->shopping_list) == 0 &&
+            gr_string_set_get_length (self->shopping_removed) == 0)
+                return;
+
+        g_hash_table_remove_all (self->shopping_list);
+        gr_string_set_remove_all (self->shopping_removed);
+
+        save_shopping_change (self);
+
+        g_signal_emit (self, shopping_changed_signal, 0);
 }
 
 gboolean
@@ -1872,37 +2273,38 @@ gr_recipe_store_is_in_shopping (GrRecipeStore *self,
 
         id = gr_recipe_get_id (recipe);
 
-        return g_variant_dict_contains (self->shopping_list, id);
+        return g_hash_table_contains (self->shopping_list, id);
 }
 
-GList *
+/**
+ * gr_recipe_store_get_shopping_list:
+ * @self: the store
+ *
+ * Returns the recipes on the shopping list.
+ *
+ * Returns: (transfer full) (element-type GrRecipe): the recipes
+ */
+GPtrArray *
 gr_recipe_store_get_shopping_list (GrRecipeStore *self)
 {
-        g_autoptr(GVariant) dict = NULL;
-        char *key;
-        GVariant *value;
-        GList *list = NULL;
-        GVariantIter iter;
+        GPtrArray *recipes;
+        GHashTableIter iter;
+        const char *id;
 
-        dict = g_variant_ref_sink (g_variant_dict_end (self->shopping_list));
-        g_variant_iter_init (&iter, dict);
-        while (g_variant_iter_next (&iter, "{sv}", &key, &value)) {
+        recipes = g_ptr_array_new_full (g_hash_table_size (self->shopping_list), g_object_unref);
+
+        g_hash_table_iter_init (&iter, self->shopping_list);
+        while (g_hash_table_iter_next (&iter, (gpointer *)&id, NULL)) {
                 GrRecipe *recipe;
 
-                recipe = g_hash_table_lookup (self->recipes, key);
+                recipe = g_hash_table_lookup (self->recipes, id);
                 if (recipe)
-                        list = g_list_append (list, g_object_ref (recipe));
+                        g_ptr_array_add (recipes, g_object_ref (recipe));
                 else
-                        g_warning ("ignoring nonexisting recipe on shopping list: %s", key);
-
-                g_variant_unref (value);
-                g_free (key);
+                        g_warning ("ignoring nonexisting recipe on shopping list: %s", id);
         }
 
-        g_variant_dict_unref (self->shopping_list);
-        self->shopping_list = g_variant_dict_new (dict);
-
-        return list;
+        return recipes;
 }
 
 double
@@ -1910,11 +2312,12 @@ gr_recipe_store_get_shopping_yield (GrRecipeStore *self,
                                     GrRecipe      *recipe)
 {
         const char *id;
-        double yield;
+        double *yield;
 
         id = gr_recipe_get_id (recipe);
-        if (g_variant_dict_lookup (self->shopping_list, id, "d", &yield))
-                return yield;
+        yield = g_hash_table_lookup (self->shopping_list, id);
+        if (yield)
+                return *yield;
 
         return 0.0;
 }
@@ -1923,39 +2326,31 @@ gboolean
 gr_recipe_store_not_shopping_ingredient (GrRecipeStore *self,
                                          const char    *ingredient)
 {
-        return g_strv_contains ((const char * const *)self->shopping_removed, ingredient);
+        return gr_string_set_contains (self->shopping_removed, ingredient);
 }
 
 void
 gr_recipe_store_remove_shopping_ingredient (GrRecipeStore *self,
                                             const char    *ingredient)
 {
-        strv_prepend (&self->shopping_removed, ingredient);
-
-        if (self->shopping_change)
-                g_date_time_unref (self->shopping_change);
-        self->shopping_change = g_date_time_new_now_utc ();
+        gr_string_set_prepend (self->shopping_removed, ingredient);
 
-        save_shopping (self);
+        save_shopping_change (self);
 }
 
 void
 gr_recipe_store_readd_shopping_ingredient (GrRecipeStore *self,
                                            const char    *ingredient)
 {
-        strv_remove (&self->shopping_removed, ingredient);
+        gr_string_set_remove (self->shopping_removed, ingredient);
 
-        if (self->shopping_change)
-                g_date_time_unref (self->shopping_change);
-        self->shopping_change = g_date_time_new_now_utc ();
-
-        save_shopping (self);
+        save_shopping_change (self);
 }
 
 const char **
 gr_recipe_store_get_removed_shopping_ingredients (GrRecipeStore *self)
 {
-        return (const char **)self->shopping_removed;
+        return gr_string_set_get_strv (self->shopping_removed);
 }
 
 GDateTime *
@@ -1968,52 +2363,38 @@ gboolean
 gr_recipe_store_has_diet (GrRecipeStore *self,
                           GrDiets        diet)
 {
-        GHashTableIter iter;
-        GrRecipe *recipe;
-
-        g_hash_table_iter_init (&iter, self->recipes);
-        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&recipe)) {
-                if ((gr_recipe_get_diets (recipe) & diet) == diet)
-                        return TRUE;
-        }
-
-        return FALSE;
+        return gr_recipe_overview_has_diet (self->overview, diet);
 }
 
 gboolean
 gr_recipe_store_has_chef (GrRecipeStore *self,
                           GrChef        *chef)
 {
-        GHashTableIter iter;
-        GrRecipe *recipe;
+        const char *id;
 
-        g_hash_table_iter_init (&iter, self->recipes);
-        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&recipe)) {
-                if (g_strcmp0 (gr_chef_get_id (chef), gr_recipe_get_author (recipe)) == 0)
-                        return TRUE;
-        }
+        id = gr_chef_get_id (chef);
 
-        return FALSE;
+        return gr_recipe_overview_get_chef_count (self->overview, id) > 0;
 }
 
 gboolean
 gr_recipe_store_has_cuisine (GrRecipeStore *self,
                              const char    *cuisine)
 {
-        GHashTableIter iter;
-        GrRecipe *recipe;
-
-        g_hash_table_iter_init (&iter, self->recipes);
-        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&recipe)) {
-                if (g_strcmp0 (cuisine, gr_recipe_get_cuisine (recipe)) == 0)
-                        return TRUE;
-        }
+        return gr_recipe_overview_get_cuisine_count (self->overview, cuisine) > 0;
+}
 
-        return FALSE;
+gboolean
+gr_recipe_store_has_season (GrRecipeStore *self,
+                            const char    *season)
+{
+        return gr_recipe_overview_get_season_count (self->overview, season) > 0;
 }
 
 /*** search implementation ***/
 
+typedef struct _SearchJob SearchJob;
+
 struct _GrRecipeSearch
 {
         GObject parent_instance;
@@ -2021,13 +2402,19 @@ struct _GrRecipeSearch
         GrRecipeStore *store;
 
         char **query;
+        GrRecipeQuery *compiled;
 
         GDateTime *timestamp;
 
         gulong idle;
         GHashTableIter iter;
+        GPtrArray *candidates;
+        guint position;
+
+        gboolean threaded;
+        SearchJob *job;
 
-        GList *results;
+        GPtrArray *results;
         GList *pending;
         int n_pending;
 
@@ -2069,7 +2456,12 @@ add_pending (GrRecipeSearch *search,
 static void
 clear_pending (GrRecipeSearch *search)
 {
-        search->results = g_list_concat (search->results, search->pending);
+        GList *l;
+
+        for (l = search->pending; l; l = l->next)
+                g_ptr_array_add (search->results, l->data);
+
+        g_list_free (search->pending);
         search->pending = NULL;
         search->n_pending = 0;
 }
@@ -2086,8 +2478,7 @@ send_pending (GrRecipeSearch *search)
 static void
 clear_results (GrRecipeSearch *search)
 {
-        g_list_free (search->results);
-        search->results = NULL;
+        g_ptr_array_set_size (search->results, 0);
 }
 
 static gboolean
@@ -2105,20 +2496,66 @@ recipe_matches (GrRecipeSearch *search,
         else if (g_str_has_prefix (search->query[0], "mt:"))
                 return g_date_time_compare (gr_recipe_get_mtime (recipe), search->timestamp) > 0;
         else
-                return gr_recipe_matches (recipe, (const char **)search->query);
+                return gr_recipe_query_matches (search->compiled, recipe);
+}
+
+static gboolean
+query_uses_index (GrRecipeSearch *search)
+{
+        const char *term = search->query[0];
+
+        return strcmp (term, "is:any") != 0 &&
+               strcmp (term, "is:favorite") != 0 &&
+               strcmp (term, "is:shopping") != 0 &&
+               !g_str_has_prefix (term, "ct:") &&
+               !g_str_has_prefix (term, "mt:");
+}
+
+static void
+find_candidates (GrRecipeSearch *search)
+{
+        g_clear_pointer (&search->candidates, g_ptr_array_unref);
+        search->position = 0;
+
+        if (query_uses_index (search)) {
+                ensure_index (search->store);
+                search->candidates = gr_recipe_index_lookup (search->store->index, (const char **)search->query);
+        }
+
+        if (search->candidates) {
+                /* Hold on to the candidates, the store may change while we search */
+                g_ptr_array_foreach (search->candidates, (GFunc)g_object_ref, NULL);
+                g_ptr_array_set_free_func (search->candidates, g_object_unref);
+        }
+        else
+                g_hash_table_iter_init (&search->iter, search->store->recipes);
+}
+
+static gboolean
+next_candidate (GrRecipeSearch  *search,
+                GrRecipe       **recipe)
+{
+        if (search->candidates) {
+                if (search->position >= search->candidates->len)
+                        return FALSE;
+
+                *recipe = g_ptr_array_index (search->candidates, search->position++);
+                return TRUE;
+        }
+
+        return g_hash_table_iter_next (&search->iter, NULL, (gpointer *)recipe);
 }
 
 static gboolean
 search_idle (gpointer data)
 {
         GrRecipeSearch *search = data;
-        const char *key;
         GrRecipe *recipe;
         gint64 start_time;
 
         start_time = g_get_monotonic_time ();
 
-        while (g_hash_table_iter_next (&search->iter, (gpointer *)&key, (gpointer *)&recipe)) {
+        while (next_candidate (search, &recipe)) {
                 if (recipe_matches (search, recipe))
                         add_pending (search, recipe);
 
@@ -2136,11 +2573,211 @@ search_idle (gpointer data)
         send_pending (search);
 
         search->idle = 0;
+        g_clear_pointer (&search->candidates, g_ptr_array_unref);
         g_signal_emit (search, search_signals[FINISHED], 0);
 
         return G_SOURCE_REMOVE;
 }
 
+/* Threaded searches
+ * -----------------
+ *
+ * Searches for plain terms can also do their matching in a worker
+ * thread. The thread works on a SearchJob which holds its own copy of
+ * the query, references to the recipes to look at and the casefolded
+ * chef names, so it never has to touch the store. Hits are passed back
+ * to the main loop in batches, where they are turned into the same
+ * signals that an idle search emits. Stopping the search marks the job
+ * as cancelled, and batches that arrive after that are dropped.
+ *
+ * The last reference on a job is always dropped in the main thread,
+ * so the recipes it holds are never finalized in the worker.
+ */
+
+#define SEARCH_CHUNK_SIZE 256
+
+struct _SearchJob
+{
+        gint ref_count;
+        gint cancelled;
+        GrRecipeSearch *search; /* only used in the main thread */
+        GrRecipeQuery *query;
+        GPtrArray *recipes;
+};
+
+typedef struct {
+        SearchJob *job;
+        GList *hits;
+        gboolean finished;
+} SearchBatch;
+
+static GThreadPool *search_pool;
+
+static SearchJob *
+search_job_ref (SearchJob *job)
+{
+        g_atomic_int_inc (&job->ref_count);
+
+        return job;
+}
+
+static void
+search_job_unref (SearchJob *job)
+{
+        if (g_atomic_int_dec_and_test (&job->ref_count)) {
+                gr_recipe_query_free (job->query);
+                g_ptr_array_unref (job->recipes);
+                g_free (job);
+        }
+}
+
+static void
+search_batch_free (gpointer data)
+{
+        SearchBatch *batch = data;
+
+        g_list_free (batch->hits);
+        search_job_unref (batch->job);
+        g_free (batch);
+}
+
+static gboolean
+deliver_batch (gpointer data)
+{
+        SearchBatch *batch = data;
+        GrRecipeSearch *search = batch->job->search;
+        GList *l;
+
+        if (search == NULL)
+                return G_SOURCE_REMOVE;
+
+        if (batch->hits) {
+                g_signal_emit (search, search_signals[HITS_ADDED], 0, batch->hits);
+                for (l = batch->hits; l; l = l->next)
+                        g_ptr_array_add (search->results, l->data);
+        }
+
+        if (batch->finished) {
+                batch->job->search = NULL;
+                g_clear_pointer (&search->job, search_job_unref);
+                g_signal_emit (search, search_signals[FINISHED], 0);
+        }
+
+        return G_SOURCE_REMOVE;
+}
+
+/* Takes over the reference to job that is passed in */
+static void
+queue_batch (SearchJob *job,
+             GList     *hits,
+             gboolean   finished)
+{
+        SearchBatch *batch;
+
+        batch = g_new0 (SearchBatch, 1);
+        batch->job = job;
+        batch->hits = g_list_reverse (hits);
+        batch->finished = finished;
+
+        g_idle_add_full (G_PRIORITY_DEFAULT, deliver_batch, batch, search_batch_free);
+}
+
+static void
+search_thread (gpointer data,
+               gpointer user_data)
+{
+        SearchJob *job = data;
+        guint i, j;
+
+        for (i = 0; i < job->recipes->len; i += SEARCH_CHUNK_SIZE) {
+                GList *hits = NULL;
+
+                if (g_atomic_int_get (&job->cancelled))
+                        break;
+
+                gr_recipe_lock_fields ();
+                for (j = i; j < MIN (i + SEARCH_CHUNK_SIZE, job->recipes->len); j++) {
+                        GrRecipe *recipe = g_ptr_array_index (job->recipes, j);
+
+                        if (gr_recipe_query_matches (job->query, recipe))
+                                hits = g_list_prepend (hits, recipe);
+                }
+                gr_recipe_unlock_fields ();
+
+                if (hits)
+                        queue_batch (search_job_ref (job), hits, FALSE);
+        }
+
+        /* The final batch gets the reference of the thread */
+        queue_batch (job, NULL, TRUE);
+}
+
+static GHashTable *
+collect_chef_names (GrRecipeStore *store)
+{
+        GHashTable *names;
+        GHashTableIter iter;
+        const char *id;
+        GrChef *chef;
+
+        names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+        g_hash_table_iter_init (&iter, store->chefs);
+        while (g_hash_table_iter_next (&iter, (gpointer *)&id, (gpointer *)&chef)) {
+                const char *cf_fullname = gr_chef_get_cf_fullname (chef);
+
+                if (cf_fullname)
+                        g_hash_table_insert (names, g_strdup (id), g_strdup (cf_fullname));
+        }
+
+        return names;
+}
+
+static void
+start_job (GrRecipeSearch *search)
+{
+        g_autoptr(GHashTable) chef_names = NULL;
+        SearchJob *job;
+        guint i;
+
+        job = g_new0 (SearchJob, 1);
+        job->ref_count = 1;
+        job->search = search;
+        job->query = gr_recipe_query_new ((const char **)search->query);
+
+        chef_names = collect_chef_names (search->store);
+        gr_recipe_query_set_chef_names (job->query, chef_names);
+
+        if (search->candidates) {
+                job->recipes = g_steal_pointer (&search->candidates);
+        }
+        else {
+                GHashTableIter iter;
+                GrRecipe *recipe;
+
+                job->recipes = g_ptr_array_new_full (g_hash_table_size (search->store->recipes), g_object_unref);
+                g_hash_table_iter_init (&iter, search->store->recipes);
+                while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&recipe))
+                        g_ptr_array_add (job->recipes, g_object_ref (recipe));
+        }
+
+        /* Casefolding is deferred for recipes that were loaded in bulk,
+         * and it can only happen in the main thread
+         */
+        for (i = 0; i < job->recipes->len; i++) {
+                const char *cf_name, *cf_description, *cf_ingredients;
+
+                gr_recipe_get_search_texts (g_ptr_array_index (job->recipes, i),
+                                            &cf_name, &cf_description, &cf_ingredients);
+        }
+
+        if (search_pool == NULL)
+                search_pool = g_thread_pool_new (search_thread, NULL, g_get_num_processors (), FALSE, NULL);
+
+        search->job = search_job_ref (job);
+        g_thread_pool_push (search_pool, job, NULL);
+}
+
 static void
 start_search (GrRecipeSearch *search)
 {
@@ -2156,12 +2793,15 @@ start_search (GrRecipeSearch *search)
                 search->timestamp = date_time_from_string (time);
         }
 
-        if (search->idle == 0) {
-                g_hash_table_iter_init (&search->iter, search->store->recipes);
+        if (search->idle == 0 && search->job == NULL) {
+                find_candidates (search);
                 clear_pending (search);
                 clear_results (search);
                 g_signal_emit (search, search_signals[STARTED], 0);
-                search_idle (search);
+                if (search->threaded && query_uses_index (search))
+                        start_job (search);
+                else
+                        search_idle (search);
         }
 }
 
@@ -2174,35 +2814,43 @@ stop_search (GrRecipeSearch *search)
                 g_source_remove (search->idle);
                 search->idle = 0;
         }
+        g_clear_pointer (&search->candidates, g_ptr_array_unref);
+        if (search->job) {
+                g_atomic_int_set (&search->job->cancelled, TRUE);
+                search->job->search = NULL;
+                g_clear_pointer (&search->job, search_job_unref);
+        }
 }
 
+/* The new query is narrower, so the new results are a subset
+ * of the existing ones. We keep the ones that still match in
+ * place, and report all the others in a single batch.
+ */
 static void
 refilter_existing_results (GrRecipeSearch *search)
 {
-        GList *l;
-        GList *rejected, *accepted;
-
-        /* FIXME: do this incrementally */
+        GList *rejected;
+        guint i, j;
 
         rejected = NULL;
-        accepted = NULL;
-        for (l = search->results; l; l = l->next) {
-                GrRecipe *recipe = l->data;
+        for (i = 0, j = 0; i < search->results->len; i++) {
+                GrRecipe *recipe = g_ptr_array_index (search->results, i);
 
                 if (recipe_matches (search, recipe))
-                        accepted = g_list_append (accepted, recipe);
+                        g_ptr_array_index (search->results, j++) = recipe;
                 else
-                        rejected = g_list_append (rejected, recipe);
+                        rejected = g_list_prepend (rejected, recipe);
         }
 
-        g_list_free (search->results);
-        search->results = accepted;
+        g_ptr_array_set_size (search->results, j);
+
         if (rejected) {
+                rejected = g_list_reverse (rejected);
                 g_signal_emit (search, search_signals[HITS_REMOVED], 0, rejected);
                 g_list_free (rejected);
         }
 
-        if (search->idle == 0) {
+        if (search->idle == 0 && search->job == NULL) {
                 g_signal_emit (search, search_signals[FINISHED], 0);
         }
 }
@@ -2250,6 +2898,7 @@ gr_recipe_search_stop (GrRecipeSearch *search)
 {
         stop_search (search);
         g_clear_pointer (&search->query, g_strfreev);
+        g_clear_pointer (&search->compiled, gr_recipe_query_free);
 }
 
 void
@@ -2273,6 +2922,7 @@ gr_recipe_search_set_terms (GrRecipeSearch  *search,
         if (terms == NULL || terms[0] == NULL) {
                 stop_search (search);
                 g_clear_pointer (&search->query, g_strfreev);
+                g_clear_pointer (&search->compiled, gr_recipe_query_free);
                 return;
         }
 
@@ -2280,8 +2930,11 @@ gr_recipe_search_set_terms (GrRecipeSearch  *search,
 
         g_strfreev (search->query);
         search->query = g_strdupv ((char **)terms);
+        g_clear_pointer (&search->compiled, gr_recipe_query_free);
+        search->compiled = gr_recipe_query_new (terms);
 
-        if (narrowing) {
+        /* A running threaded search has its own copy of the query */
+        if (narrowing && search->job == NULL) {
                 refilter_existing_results (search);
         }
         else {
@@ -2296,13 +2949,67 @@ gr_recipe_search_get_terms (GrRecipeSearch *search)
         return (const char **)search->query;
 }
 
+/**
+ * gr_recipe_search_set_threaded:
+ * @search: a #GrRecipeSearch
+ * @threaded: whether to match recipes in a worker thread
+ *
+ * Sets whether searches for plain terms are run in a worker thread,
+ * instead of in idle callbacks. The signals are emitted in the main
+ * thread either way. This takes effect the next time a search is started.
+ */
+void
+gr_recipe_search_set_threaded (GrRecipeSearch *search,
+                               gboolean        threaded)
+{
+        search->threaded = threaded;
+}
+
+/**
+ * gr_recipe_search_is_running:
+ * @search: a #GrRecipeSearch
+ *
+ * Returns whether @search has been started and has not emitted
+ * ::finished yet.
+ *
+ * Returns: %TRUE if the search is running
+ */
+gboolean
+gr_recipe_search_is_running (GrRecipeSearch *search)
+{
+        return search->idle != 0 || search->job != NULL;
+}
+
+/**
+ * gr_recipe_search_matches:
+ * @search: a #GrRecipeSearch
+ * @recipe: a #GrRecipe
+ *
+ * Checks @recipe against the current query of @search. This lets
+ * users of a finished search keep their results up to date when
+ * recipes change, without running the search again.
+ *
+ * Returns: %TRUE if @recipe matches the query
+ */
+gboolean
+gr_recipe_search_matches (GrRecipeSearch *search,
+                          GrRecipe       *recipe)
+{
+        if (search->query == NULL)
+                return FALSE;
+
+        return recipe_matches (search, recipe);
+}
+
 static void
 gr_recipe_search_finalize (GObject *object)
 {
         GrRecipeSearch *search = (GrRecipeSearch *)object;
 
         stop_search (search);
+        g_ptr_array_unref (search->results);
         g_strfreev (search->query);
+        g_clear_pointer (&search->compiled, gr_recipe_query_free);
         g_object_unref (search->store);
         g_clear_pointer (&search->timestamp, g_date_time_unref);
 
@@ -2383,6 +3090,7 @@ gr_recipe_search_class_init (GrRecipeSearchClass *klass)
 static void
 gr_recipe_search_init (GrRecipeSearch *self)
 {
+        self->results = g_ptr_array_new ();
 }
 
 GrRecipeStore *
@@ -23,6 +23,7 @@
 #include <glib-object.h>
 #include "gr-recipe.h"
 #include "gr-chef.h"
+#include "gr-recipe-overview.h"
 
 G_BEGIN_DECLS
 
@@ -43,6 +44,9 @@ gboolean        gr_recipe_store_update_recipe       (GrRecipeStore  *self,
                                                      GError        **error);
 gboolean        gr_recipe_store_remove_recipe       (GrRecipeStore  *self,
                                                      GrRecipe       *recipe);
+void            gr_recipe_store_begin_batch         (GrRecipeStore  *self);
+void            gr_recipe_store_commit_batch        (GrRecipeStore  *self);
+void            gr_recipe_store_abort_batch         (GrRecipeStore  *self);
 GrRecipe       *gr_recipe_store_get_recipe          (GrRecipeStore  *self,
                                                      const char     *id);
 char          **gr_recipe_store_get_recipe_keys     (GrRecipeStore  *self,
@@ -51,6 +55,8 @@ gboolean        gr_recipe_store_recipe_is_todays    (GrRecipeStore  *self,
                                                      GrRecipe       *recipe);
 gboolean        gr_recipe_store_recipe_is_pick      (GrRecipeStore  *self,
                                                      GrRecipe       *recipe);
+GPtrArray      *gr_recipe_store_get_todays          (GrRecipeStore  *self);
+GPtrArray      *gr_recipe_store_get_picks           (GrRecipeStore  *self);
 
 gboolean        gr_recipe_store_add_chef            (GrRecipeStore  *self,
                                                      GrChef         *chef,
@@ -94,10 +100,13 @@ void            gr_recipe_store_add_to_shopping      (GrRecipeStore  *self,
                                                       double          yield);
 void            gr_recipe_store_remove_from_shopping (GrRecipeStore  *self,
                                                       GrRecipe       *recipe);
+void            gr_recipe_store_add_recipes_to_shopping      (GrRecipeStore *self,
+                                                              GPtrArray     *recipes,
+                                                              const double  *yields);
 void            gr_recipe_store_clear_shopping_list  (GrRecipeStore *self);
 gboolean        gr_recipe_store_is_in_shopping       (GrRecipeStore  *self,
                                                       GrRecipe       *recipe);
-GList          *gr_recipe_store_get_shopping_list    (GrRecipeStore  *self);
+GPtrArray      *gr_recipe_store_get_shopping_list    (GrRecipeStore  *self);
 double          gr_recipe_store_get_shopping_yield   (GrRecipeStore  *self,
                                                       GrRecipe       *recipe);
 gboolean        gr_recipe_store_not_shopping_ingredient    (GrRecipeStore *self,
@@ -115,6 +124,8 @@ gboolean        gr_recipe_store_has_chef            (GrRecipeStore  *self,
                                                      GrChef         *chef);
 gboolean        gr_recipe_store_has_cuisine         (GrRecipeStore  *self,
                                                      const char     *cuisine);
+gboolean        gr_recipe_store_has_season          (GrRecipeStore  *self,
+                                                     const char     *season);
 char          **gr_recipe_store_get_contributors    (GrRecipeStore *self,
                                                      guint         *length);
 char          **gr_recipe_store_get_all_cuisines    (GrRecipeStore *store,
@@ -132,5 +143,10 @@ void            gr_recipe_search_set_terms (GrRecipeSearch  *search,
                                             const char     **query);
 const char    **gr_recipe_search_get_terms (GrRecipeSearch  *search);
 void            gr_recipe_search_stop      (GrRecipeSearch  *search);
+void            gr_recipe_search_set_threaded (GrRecipeSearch *search,
+                                               gboolean        threaded);
+gboolean        gr_recipe_search_is_running (GrRecipeSearch *search);
+gboolean        gr_recipe_search_matches    (GrRecipeSearch *search,
+                                             GrRecipe       *recipe);
 
 G_END_DECLS
@@ -82,6 +82,10 @@ recipe_tile_set_recipe (GrRecipeTile *tile,
         g_cancellable_cancel (tile->cancellable);
         g_clear_object (&tile->cancellable);
 
+        /* Don't show the image of the previous recipe while loading */
+        if (tile->recipe != recipe)
+                gtk_image_clear (GTK_IMAGE (tile->image));
+
         g_set_object (&tile->recipe, recipe);
 
         if (tile->recipe) {
@@ -198,3 +202,32 @@ gr_recipe_tile_set_show_shared (GrRecipeTile *tile,
 
         update_shared_icon (tile);
 }
+
+/**
+ * gr_recipe_tile_set_recipe:
+ * @tile: a #GrRecipeTile
+ * @recipe: (nullable): a #GrRecipe
+ *
+ * Makes @tile show @recipe, so that tiles can be reused. Setting
+ * %NULL cancels any image load for the previous recipe.
+ */
+void
+gr_recipe_tile_set_recipe (GrRecipeTile *tile,
+                           GrRecipe     *recipe)
+{
+        recipe_tile_set_recipe (tile, recipe);
+        update_shared_icon (tile);
+}
+
+/**
+ * gr_recipe_tile_update:
+ * @tile: a #GrRecipeTile
+ *
+ * Updates @tile after its recipe has been changed.
+ */
+void
+gr_recipe_tile_update (GrRecipeTile *tile)
+{
+        recipe_tile_set_recipe (tile, tile->recipe);
+        update_shared_icon (tile);
+}
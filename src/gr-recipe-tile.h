@@ -33,7 +33,10 @@ G_DECLARE_FINAL_TYPE (GrRecipeTile, gr_recipe_tile, GR, RECIPE_TILE, GtkButton)
 GtkWidget      *gr_recipe_tile_new        (GrRecipe     *recipe);
 GtkWidget      *gr_recipe_tile_new_wide   (GrRecipe     *recipe);
 GrRecipe       *gr_recipe_tile_get_recipe (GrRecipeTile *tile);
+void            gr_recipe_tile_set_recipe (GrRecipeTile *tile,
+                                           GrRecipe     *recipe);
 void            gr_recipe_tile_set_show_shared (GrRecipeTile *tile,
                                                 gboolean      show_shared);
+void            gr_recipe_tile_update     (GrRecipeTile *tile);
 
 G_END_DECLS
@@ -27,6 +27,8 @@
 
 #include "gr-recipe.h"
 #include "gr-recipe-store.h"
+#include "gr-recipe-snapshot.h"
+#include "gr-ingredients-list.h"
 #include "gr-image.h"
 #include "gr-utils.h"
 #include "types.h"
@@ -35,7 +37,8 @@
  *
  *  If any fields are added to a recipe, there are several places
  *  that need to be kept in sync:
- *  - save_recipes() in gr-recipe-store.c
+ *  - write_recipe_keys() in gr-recipe-store.c, which writes the
+ *    journal entries described in gr-recipe-journal.c
  *  - load_recipes() in gr-recipe-store.c
  *  - the GrRecipeExporter code
  *  - the GrRecipeImporter code
@@ -67,6 +70,7 @@ struct _GrRecipe
         char *cf_name;
         char *cf_description;
         char *cf_ingredients;
+        gboolean cf_pending;
 
         gboolean garlic;
         int spiciness;
@@ -81,6 +85,12 @@ struct _GrRecipe
 
         double yield;
         char *yield_unit;
+
+        /* Snapshot record that lazily provides the instructions */
+        GVariant *snapshot;
+
+        /* Parsed ingredients, built on demand */
+        GrIngredientsList *ingredients_list;
 };
 
 G_DEFINE_TYPE (GrRecipe, gr_recipe, G_TYPE_OBJECT)
@@ -112,7 +122,59 @@ enum {
         N_PROPS
 };
 
-static char * gr_recipe_get_chef_fullname (GrRecipe *self);
+/* Recipes are only modified on the main thread, but searches may read
+ * them from a worker thread, so setting properties takes this lock
+ * for writing, and threaded readers take it for reading.
+ */
+static GRWLock fields_lock;
+
+/* The instructions are the largest part of most recipes, and only
+ * needed when a recipe is shown in detail, so we only read them from
+ * the snapshot when they are first asked for.
+ */
+static void
+ensure_instructions (GrRecipe *self)
+{
+        const char *instructions;
+
+        if (self->snapshot == NULL)
+                return;
+
+        instructions = gr_recipe_snapshot_get_string (self->snapshot, GR_SNAPSHOT_INSTRUCTIONS);
+        self->instructions = g_strdup (instructions);
+        if (self->instructions)
+                self->translated_instructions = translate_multiline_string (self->instructions);
+
+        g_clear_pointer (&self->snapshot, g_variant_unref);
+}
+
+/* Recipes that are created in bulk don't casefold their texts
+ * until they are first searched. Only called in the main thread.
+ */
+static void
+ensure_search_texts (GrRecipe *self)
+{
+        g_autofree char *cf_garlic = NULL;
+
+        if (!self->cf_pending)
+                return;
+
+        g_rw_lock_writer_lock (&fields_lock);
+
+        if (self->translated_name)
+                self->cf_name = g_utf8_casefold (self->translated_name, -1);
+        if (self->translated_description)
+                self->cf_description = g_utf8_casefold (self->translated_description, -1);
+        if (self->ingredients) {
+                self->cf_ingredients = g_utf8_casefold (self->ingredients, -1);
+                cf_garlic = g_utf8_casefold ("Garlic", -1);
+                self->garlic = (strstr (self->cf_ingredients, cf_garlic) != NULL);
+        }
+
+        self->cf_pending = FALSE;
+
+        g_rw_lock_writer_unlock (&fields_lock);
+}
 
 static void
 gr_recipe_finalize (GObject *object)
@@ -136,6 +198,7 @@ gr_recipe_finalize (GObject *object)
         g_free (self->cf_name);
         g_free (self->cf_description);
         g_free (self->cf_ingredients);
+        g_clear_object (&self->ingredients_list);
         g_date_time_unref (self->mtime);
         g_date_time_unref (self->ctime);
 
@@ -146,6 +209,8 @@ gr_recipe_finalize (GObject *object)
 
         g_free (self->yield_unit);
 
+        g_clear_pointer (&self->snapshot, g_variant_unref);
+
         G_OBJECT_CLASS (gr_recipe_parent_class)->finalize (object);
 }
 
@@ -211,6 +276,7 @@ gr_recipe_get_property (GObject    *object,
                 break;
 
         case PROP_INSTRUCTIONS:
+                ensure_instructions (self);
                 g_value_set_string (value, self->instructions);
                 break;
 
@@ -251,24 +317,6 @@ gr_recipe_get_property (GObject    *object,
         }
 }
 
-static char *
-gr_recipe_get_chef_fullname (GrRecipe *self)
-{
-	GrRecipeStore *store;
-	g_autoptr(GrChef) chef = NULL;
-
-	store = gr_recipe_store_get ();
-	chef = gr_recipe_store_get_chef (store, self->author);
-	if (chef) {
-		const char *fullname = gr_chef_get_fullname (chef);
-
-                if (fullname)
-			return g_utf8_casefold (fullname, -1);
-	}
-
-        return NULL;
-}
-
 static void
 gr_recipe_set_property (GObject      *object,
                         guint         prop_id,
@@ -282,6 +330,14 @@ gr_recipe_set_property (GObject      *object,
                 return;
         }
 
+        /* Each of these only updates its own casefolded text */
+        if (prop_id == PROP_NAME ||
+            prop_id == PROP_DESCRIPTION ||
+            prop_id == PROP_INGREDIENTS)
+                ensure_search_texts (self);
+
+        g_rw_lock_writer_lock (&fields_lock);
+
         switch (prop_id) {
         case PROP_ID:
                 g_free (self->id);
@@ -357,6 +413,7 @@ gr_recipe_set_property (GObject      *object,
         case PROP_INGREDIENTS:
                 g_clear_pointer (&self->ingredients, g_free);
                 g_clear_pointer (&self->cf_ingredients, g_free);
+                g_clear_object (&self->ingredients_list);
                 self->garlic = FALSE;
 
                 self->ingredients = g_value_dup_string (value);
@@ -369,6 +426,7 @@ gr_recipe_set_property (GObject      *object,
                 break;
 
         case PROP_INSTRUCTIONS:
+                g_clear_pointer (&self->snapshot, g_variant_unref);
                 g_clear_pointer (&self->instructions, g_free);
                 g_clear_pointer (&self->translated_instructions, g_free);
                 self->instructions = g_value_dup_string (value);
@@ -420,6 +478,8 @@ gr_recipe_set_property (GObject      *object,
         default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         }
+
+        g_rw_lock_writer_unlock (&fields_lock);
 }
 
 static void
@@ -558,6 +618,114 @@ gr_recipe_new (void)
         return g_object_new (GR_TYPE_RECIPE, NULL);
 }
 
+static void
+replace_string (char       **field,
+                const char  *value)
+{
+        char *old = *field;
+
+        *field = g_strdup (value);
+        g_free (old);
+}
+
+static void
+replace_translated_string (char       **field,
+                           char       **translated,
+                           const char  *value)
+{
+        replace_string (field, value);
+        g_clear_pointer (translated, g_free);
+        if (*field)
+                *translated = translate_multiline_string (*field);
+}
+
+/**
+ * gr_recipe_set_fields:
+ * @recipe: a #GrRecipe
+ * @fields: the new values
+ *
+ * Sets all the fields of @recipe from @fields at once, without going
+ * through properties. No notification is emitted, and casefolding the
+ * texts for searching is deferred until they are needed. This is meant
+ * for loading recipes in bulk; the caller is expected to tell users
+ * about the changes, e.g. with #GrRecipeStore::recipe-changed.
+ *
+ * The instructions are not part of @fields, see gr_recipe_set_snapshot().
+ */
+void
+gr_recipe_set_fields (GrRecipe             *recipe,
+                      const GrRecipeFields *fields)
+{
+        g_rw_lock_writer_lock (&fields_lock);
+
+        replace_string (&recipe->id, fields->id);
+        replace_string (&recipe->author, fields->author);
+        replace_translated_string (&recipe->name, &recipe->translated_name, fields->name);
+        replace_translated_string (&recipe->description, &recipe->translated_description, fields->description);
+        replace_translated_string (&recipe->notes, &recipe->translated_notes, fields->notes);
+        replace_string (&recipe->cuisine, fields->cuisine);
+        replace_string (&recipe->season, fields->season);
+        replace_string (&recipe->category, fields->category);
+        replace_string (&recipe->prep_time, fields->prep_time);
+        replace_string (&recipe->cook_time, fields->cook_time);
+        replace_string (&recipe->ingredients, fields->ingredients);
+        replace_string (&recipe->yield_unit, fields->yield_unit);
+        g_clear_object (&recipe->ingredients_list);
+
+        g_clear_pointer (&recipe->cf_name, g_free);
+        g_clear_pointer (&recipe->cf_description, g_free);
+        g_clear_pointer (&recipe->cf_ingredients, g_free);
+        recipe->garlic = FALSE;
+        recipe->cf_pending = TRUE;
+
+        if (fields->images) {
+                g_ptr_array_ref (fields->images);
+                g_ptr_array_unref (recipe->images);
+                recipe->images = fields->images;
+        }
+
+        if (fields->ctime) {
+                g_date_time_ref (fields->ctime);
+                g_date_time_unref (recipe->ctime);
+                recipe->ctime = fields->ctime;
+        }
+
+        if (fields->mtime) {
+                g_date_time_ref (fields->mtime);
+                g_date_time_unref (recipe->mtime);
+                recipe->mtime = fields->mtime;
+        }
+
+        recipe->default_image = fields->default_image;
+        recipe->spiciness = fields->spiciness;
+        recipe->diets = fields->diets;
+        recipe->yield = fields->yield;
+        recipe->contributed = fields->contributed;
+        recipe->readonly = fields->readonly;
+
+        g_rw_lock_writer_unlock (&fields_lock);
+}
+
+/**
+ * gr_recipe_new_from_fields:
+ * @fields: the values for the new recipe
+ *
+ * Creates a new recipe with the values in @fields, see
+ * gr_recipe_set_fields().
+ *
+ * Returns: (transfer full): a new #GrRecipe
+ */
+GrRecipe *
+gr_recipe_new_from_fields (const GrRecipeFields *fields)
+{
+        GrRecipe *recipe;
+
+        recipe = g_object_new (GR_TYPE_RECIPE, NULL);
+        gr_recipe_set_fields (recipe, fields);
+
+        return recipe;
+}
+
 const char *
 gr_recipe_get_id (GrRecipe *recipe)
 {
@@ -642,15 +810,38 @@ gr_recipe_get_ingredients (GrRecipe *recipe)
         return recipe->ingredients;
 }
 
+/**
+ * gr_recipe_get_ingredients_list:
+ * @recipe: a #GrRecipe
+ *
+ * Returns the parsed ingredients of @recipe. The list is created
+ * when it is first needed, and kept until the ingredients change,
+ * so it should not be held on to without taking a reference.
+ *
+ * Returns: (transfer none): the ingredients of @recipe
+ */
+GrIngredientsList *
+gr_recipe_get_ingredients_list (GrRecipe *recipe)
+{
+        if (!recipe->ingredients_list)
+                recipe->ingredients_list = gr_ingredients_list_new (recipe->ingredients ? recipe->ingredients : "");
+
+        return recipe->ingredients_list;
+}
+
 const char *
 gr_recipe_get_instructions (GrRecipe *recipe)
 {
+        ensure_instructions (recipe);
+
         return recipe->instructions;
 }
 
 const char *
 gr_recipe_get_translated_instructions (GrRecipe *recipe)
 {
+        ensure_instructions (recipe);
+
         return recipe->translated_instructions;
 }
 
@@ -663,6 +854,8 @@ gr_recipe_get_notes (GrRecipe *recipe)
 gboolean
 gr_recipe_contains_garlic (GrRecipe *recipe)
 {
+        ensure_search_texts (recipe);
+
         return recipe->garlic;
 }
 
@@ -733,110 +926,76 @@ gr_recipe_get_yield_unit (GrRecipe *recipe)
         return recipe->yield_unit;
 }
 
-/* terms are assumed to be g_utf8_casefold'ed where appropriate */
-gboolean
-gr_recipe_matches (GrRecipe    *recipe,
-                   const char **terms)
+/**
+ * gr_recipe_set_snapshot:
+ * @recipe: a #GrRecipe
+ * @record: a snapshot record, see gr_recipe_snapshot_load()
+ *
+ * Makes @recipe read its instructions from @record when they
+ * are first needed, instead of keeping a copy around.
+ */
+void
+gr_recipe_set_snapshot (GrRecipe *recipe,
+                        GVariant *record)
 {
-        int i;
-        g_autofree char *cf_fullname = NULL;
-
-        cf_fullname = gr_recipe_get_chef_fullname (recipe);
-
-        for (i = 0; terms[i]; i++) {
-                if (g_str_has_prefix (terms[i], "i+:")) {
-                        if (!recipe->ingredients || strstr (recipe->ingredients, terms[i] + 3) == NULL) {
-                                return FALSE;
-                        }
-                        continue;
-                }
-                else if (g_str_has_prefix (terms[i], "i-:")) {
-                        if (recipe->ingredients && strstr (recipe->ingredients, terms[i] + 3) != NULL) {
-                                return FALSE;
-                        }
-                        continue;
-                }
-                else if (g_str_has_prefix (terms[i], "by:")) {
-                        if (!recipe->author || strcmp (recipe->author, terms[i] + 3) != 0) {
-                                return FALSE;
-                        }
-                        continue;
-                }
-                else if (g_str_has_prefix (terms[i], "se:")) {
-                        if (!recipe->season || strcmp (recipe->season , terms[i] + 3) != 0) {
-                                return FALSE;
-                        }
-                        continue;
-                }
-                else if (g_str_has_prefix (terms[i], "me:")) {
-                        if (!recipe->category || strstr (recipe->category, terms[i] + 3) == NULL) {
-                                return FALSE;
-                        }
-                        continue;
-                }
-                else if (g_str_has_prefix (terms[i], "di:")) {
-                        struct { GrDiets diet; const char *term; } diets[] = {
-                                { GR_DIET_GLUTEN_FREE, "gluten-free" },
-                                { GR_DIET_NUT_FREE,    "nut-free" },
-                                { GR_DIET_VEGAN,       "vegan" },
-                                { GR_DIET_VEGETARIAN,  "vegetarian" },
-                                { GR_DIET_MILK_FREE,   "milk-free" },
-                                { 0, NULL }
-                        };
-                        GrDiets d = 0;
-                        int j;
-
-                        for (j = 0; diets[j].term; j++) {
-                                if (strstr (diets[j].term, terms[i] + 3)) {
-                                        d |= diets[j].diet;
-                                }
-                        }
-
-                        if (!(recipe->diets & d))
-                                return FALSE;
-
-                        continue;
-                }
-                else if (g_str_has_prefix (terms[i], "na:")) {
-                        if (recipe->cf_name && strstr (recipe->cf_name, terms[i] + 3) == NULL)
-                                return FALSE;
-
-                        continue;
-
-                }
-                else if (g_str_has_prefix (terms[i], "s+:")) {
-                        int level;
+        g_clear_pointer (&recipe->instructions, g_free);
+        g_clear_pointer (&recipe->translated_instructions, g_free);
+        g_clear_pointer (&recipe->snapshot, g_variant_unref);
 
-                        level = atoi (terms[i] + 3);
-                        if (recipe->spiciness < level)
-                                return FALSE;
-
-                        continue;
-                }
-                else if (g_str_has_prefix (terms[i], "s-:")) {
-                        int level;
-
-                        level = atoi (terms[i] + 3);
-                        if (recipe->spiciness > level)
-                                return FALSE;
-
-                        continue;
-                }
+        recipe->snapshot = g_variant_ref (record);
+}
 
-                if (recipe->cf_name && strstr (recipe->cf_name, terms[i]) != NULL)
-                        continue;
+/**
+ * gr_recipe_lock_fields:
+ *
+ * Prevents recipes from being modified until gr_recipe_unlock_fields()
+ * is called. This is only needed when reading recipes outside the
+ * main thread.
+ */
+void
+gr_recipe_lock_fields (void)
+{
+        g_rw_lock_reader_lock (&fields_lock);
+}
 
-                if (recipe->cf_description && strstr (recipe->cf_description, terms[i]) != NULL)
-                        continue;
+void
+gr_recipe_unlock_fields (void)
+{
+        g_rw_lock_reader_unlock (&fields_lock);
+}
 
-                if (recipe->cf_ingredients && strstr (recipe->cf_ingredients, terms[i]) != NULL)
-                        continue;
+/* Returns the casefolded texts that gr_recipe_query_matches()
+ * looks for plain terms in, apart from the chef name
+ */
+void
+gr_recipe_get_search_texts (GrRecipe    *recipe,
+                            const char **cf_name,
+                            const char **cf_description,
+                            const char **cf_ingredients)
+{
+        ensure_search_texts (recipe);
 
-                if (cf_fullname && strstr (cf_fullname, terms[i]) != NULL)
-                        continue;
+        *cf_name = recipe->cf_name;
+        *cf_description = recipe->cf_description;
+        *cf_ingredients = recipe->cf_ingredients;
+}
 
+/* Like gr_recipe_get_search_texts(), but usable outside the main
+ * thread, with gr_recipe_lock_fields() held. Returns %FALSE if the
+ * texts have not been casefolded yet.
+ */
+gboolean
+gr_recipe_peek_search_texts (GrRecipe    *recipe,
+                             const char **cf_name,
+                             const char **cf_description,
+                             const char **cf_ingredients)
+{
+        if (recipe->cf_pending)
                 return FALSE;
-        }
+
+        *cf_name = recipe->cf_name;
+        *cf_description = recipe->cf_description;
+        *cf_ingredients = recipe->cf_ingredients;
 
         return TRUE;
 }
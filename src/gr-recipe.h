@@ -24,6 +24,7 @@
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include "gr-diet.h"
 #include "gr-number.h"
+#include "gr-ingredients-list.h"
 
 G_BEGIN_DECLS
 
@@ -31,7 +32,34 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE (GrRecipe, gr_recipe, GR, RECIPE, GObject)
 
+typedef struct {
+        const char *id;
+        const char *name;
+        const char *author;
+        const char *description;
+        const char *cuisine;
+        const char *season;
+        const char *category;
+        const char *prep_time;
+        const char *cook_time;
+        const char *ingredients;
+        const char *notes;
+        const char *yield_unit;
+        double      yield;
+        int         spiciness;
+        int         default_image;
+        GrDiets     diets;
+        GPtrArray  *images;
+        GDateTime  *ctime;
+        GDateTime  *mtime;
+        gboolean    contributed;
+        gboolean    readonly;
+} GrRecipeFields;
+
 GrRecipe       *gr_recipe_new              (void);
+GrRecipe       *gr_recipe_new_from_fields  (const GrRecipeFields *fields);
+void            gr_recipe_set_fields       (GrRecipe             *recipe,
+                                            const GrRecipeFields *fields);
 
 const char     *gr_recipe_get_id           (GrRecipe   *recipe);
 const char     *gr_recipe_get_name         (GrRecipe   *recipe);
@@ -44,6 +72,7 @@ const char     *gr_recipe_get_prep_time    (GrRecipe   *recipe);
 const char     *gr_recipe_get_cook_time    (GrRecipe   *recipe);
 GrDiets         gr_recipe_get_diets        (GrRecipe   *recipe);
 const char     *gr_recipe_get_ingredients  (GrRecipe   *recipe);
+GrIngredientsList *gr_recipe_get_ingredients_list (GrRecipe *recipe);
 const char     *gr_recipe_get_instructions (GrRecipe   *recipe);
 const char     *gr_recipe_get_notes        (GrRecipe   *recipe);
 gboolean        gr_recipe_contains_garlic  (GrRecipe   *recipe);
@@ -64,7 +93,20 @@ const char     *gr_recipe_get_translated_description  (GrRecipe   *recipe);
 const char     *gr_recipe_get_translated_instructions (GrRecipe   *recipe);
 const char     *gr_recipe_get_translated_notes        (GrRecipe   *recipe);
 
-gboolean        gr_recipe_matches          (GrRecipe    *recipe,
-                                            const char **terms);
+void            gr_recipe_set_snapshot     (GrRecipe    *recipe,
+                                            GVariant    *record);
+
+void            gr_recipe_get_search_texts (GrRecipe    *recipe,
+                                            const char **cf_name,
+                                            const char **cf_description,
+                                            const char **cf_ingredients);
+
+gboolean        gr_recipe_peek_search_texts (GrRecipe    *recipe,
+                                             const char **cf_name,
+                                             const char **cf_description,
+                                             const char **cf_ingredients);
+
+void            gr_recipe_lock_fields      (void);
+void            gr_recipe_unlock_fields    (void);
 
 G_END_DECLS
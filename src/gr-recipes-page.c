@@ -279,12 +279,46 @@ update_shopping_time (gpointer data)
         return G_SOURCE_CONTINUE;
 }
 
+/* scramble the recipes so we don't always get the same picks */
+static void
+shuffle_recipes (GPtrArray *recipes)
+{
+        int i;
+
+        for (i = 0; i < recipes->len; i++) {
+                int r;
+                gpointer tmp;
+
+                r = g_random_int_range (0, recipes->len);
+
+                tmp = recipes->pdata[i];
+                recipes->pdata[i] = recipes->pdata[r];
+                recipes->pdata[r] = tmp;
+        }
+}
+
+static gboolean
+box_shows_recipe (GtkWidget *box,
+                  GrRecipe  *recipe)
+{
+        g_autoptr(GList) children = NULL;
+        GList *l;
+
+        children = gtk_container_get_children (GTK_CONTAINER (box));
+        for (l = children; l; l = l->next) {
+                if (gr_recipe_tile_get_recipe (GR_RECIPE_TILE (l->data)) == recipe)
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
 static void
 populate_recipes_from_store (GrRecipesPage *self)
 {
         GrRecipeStore *store;
-        g_autofree char **keys = NULL;
-        guint length;
+        g_autoptr(GPtrArray) today_recipes = NULL;
+        g_autoptr(GPtrArray) pick_recipes = NULL;
         int i;
         int todays;
         int picks;
@@ -294,78 +328,115 @@ populate_recipes_from_store (GrRecipesPage *self)
 
         store = gr_recipe_store_get ();
 
-        keys = gr_recipe_store_get_recipe_keys (store, &length);
-
-        /* scramble the keys so we don't always get the same picks */
-        for (i = 0; i < length; i++) {
-                int r;
-                char *tmp;
-
-                r = g_random_int_range (0, length);
-
-                tmp = keys[i];
-                keys[i] = keys[r];
-                keys[r] = tmp;
-        }
+        today_recipes = gr_recipe_store_get_todays (store);
+        pick_recipes = gr_recipe_store_get_picks (store);
+        shuffle_recipes (today_recipes);
+        shuffle_recipes (pick_recipes);
 
         todays = 0;
-        picks = 0;
-        for (i = 0; (i < length) && (todays < 3 || picks < 3); i++) {
-                g_autoptr(GrRecipe) recipe = NULL;
+        for (i = 0; i < today_recipes->len && todays < 3; i++) {
+                GrRecipe *recipe = g_ptr_array_index (today_recipes, i);
                 GtkWidget *tile;
 
-                recipe = gr_recipe_store_get_recipe (store, keys[i]);
-
-                if (todays < 3 && gr_recipe_store_recipe_is_todays (store, recipe)) {
-                        if (todays == 0) {
-                                tile = gr_recipe_tile_new_wide (recipe);
-                                gtk_grid_attach (GTK_GRID (self->today_box), tile, 0, 0, 2, 1);
-                                todays += 2;
-                        }
-                        else {
-                                tile = gr_recipe_tile_new (recipe);
-                                gtk_grid_attach (GTK_GRID (self->today_box), tile, todays, 0, 1, 1);
-                                todays += 1;
-                        }
+                if (todays == 0) {
+                        tile = gr_recipe_tile_new_wide (recipe);
+                        gtk_grid_attach (GTK_GRID (self->today_box), tile, 0, 0, 2, 1);
+                        todays += 2;
                 }
-                else if (picks < 3 && gr_recipe_store_recipe_is_pick (store, recipe)) {
+                else {
                         tile = gr_recipe_tile_new (recipe);
-                        gtk_grid_attach (GTK_GRID (self->pick_box), tile, picks, 0, 1, 1);
-                        picks++;
+                        gtk_grid_attach (GTK_GRID (self->today_box), tile, todays, 0, 1, 1);
+                        todays += 1;
                 }
         }
+
+        picks = 0;
+        for (i = 0; i < pick_recipes->len && picks < 3; i++) {
+                GrRecipe *recipe = g_ptr_array_index (pick_recipes, i);
+                GtkWidget *tile;
+
+                /* today's recipes are not shown twice */
+                if (box_shows_recipe (self->today_box, recipe))
+                        continue;
+
+                tile = gr_recipe_tile_new (recipe);
+                gtk_grid_attach (GTK_GRID (self->pick_box), tile, picks, 0, 1, 1);
+                picks++;
+        }
+}
+
+/* Updates the tiles we show, as long as their recipes are still
+ * featured and we don't have room for more.
+ */
+static gboolean
+update_featured_tiles (GtkWidget *box,
+                       GPtrArray *recipes,
+                       int        max_tiles)
+{
+        g_autoptr(GList) children = NULL;
+        GList *l;
+        int n_tiles = 0;
+
+        children = gtk_container_get_children (GTK_CONTAINER (box));
+        for (l = children; l; l = l->next) {
+                GrRecipe *recipe = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (l->data));
+                gboolean featured = FALSE;
+                int i;
+
+                for (i = 0; i < recipes->len && !featured; i++)
+                        featured = g_ptr_array_index (recipes, i) == recipe;
+
+                if (!featured)
+                        return FALSE;
+
+                n_tiles++;
+        }
+
+        if (n_tiles < max_tiles && recipes->len > n_tiles)
+                return FALSE;
+
+        for (l = children; l; l = l->next)
+                gr_recipe_tile_update (GR_RECIPE_TILE (l->data));
+
+        return TRUE;
+}
+
+static void
+refresh_featured (GrRecipesPage *self)
+{
+        GrRecipeStore *store;
+        g_autoptr(GPtrArray) today_recipes = NULL;
+        g_autoptr(GPtrArray) pick_recipes = NULL;
+
+        store = gr_recipe_store_get ();
+
+        today_recipes = gr_recipe_store_get_todays (store);
+        pick_recipes = gr_recipe_store_get_picks (store);
+
+        if (!update_featured_tiles (self->today_box, today_recipes, 2) ||
+            !update_featured_tiles (self->pick_box, pick_recipes, 3))
+                populate_recipes_from_store (self);
 }
 
 static void
 populate_shopping_from_store (GrRecipesPage *self)
 {
         GrRecipeStore *store;
-        g_autofree char **keys = NULL;
-        guint length;
+        g_autoptr(GPtrArray) recipes = NULL;
         int shopping;
-        int i;
         g_autofree char *shop1 = NULL;
         g_autofree char *shop2 = NULL;
         char *tmp;
 
         store = gr_recipe_store_get ();
 
-        keys = gr_recipe_store_get_recipe_keys (store, &length);
+        recipes = gr_recipe_store_get_shopping_list (store);
 
-        shopping = 0;
-        for (i = 0; i < length; i++) {
-                g_autoptr(GrRecipe) recipe = NULL;
-
-                recipe = gr_recipe_store_get_recipe (store, keys[i]);
-
-                if (gr_recipe_store_is_in_shopping (store, recipe)) {
-                        if (shopping == 0)
-                                shop1 = g_markup_escape_text (gr_recipe_get_name (recipe), -1);
-                        else if (shopping == 1)
-                                shop2 = g_markup_escape_text (gr_recipe_get_name (recipe), -1);
-                        shopping++;
-                }
-        }
+        shopping = recipes->len;
+        if (shopping > 0)
+                shop1 = g_markup_escape_text (gr_recipe_get_name (g_ptr_array_index (recipes, 0)), -1);
+        if (shopping > 1)
+                shop2 = g_markup_escape_text (gr_recipe_get_name (g_ptr_array_index (recipes, 1)), -1);
 
         if (shopping == 1)
                 tmp = g_strdup_printf (_("Buy ingredients: <b>%s</b>"), shop1);
@@ -390,7 +461,16 @@ gr_recipes_page_refresh (GrRecipesPage *self)
 
 
 static void
-repopulate_recipes (GrRecipesPage *self)
+recipe_changed (GrRecipesPage *self,
+                GrRecipe      *recipe)
+{
+        if (gtk_widget_is_drawable (GTK_WIDGET (self)) &&
+            gr_recipe_store_is_in_shopping (gr_recipe_store_get (), recipe))
+                gr_recipes_page_refresh (self);
+}
+
+static void
+shopping_changed (GrRecipesPage *self)
 {
         if (gtk_widget_is_drawable (GTK_WIDGET (self)))
                 gr_recipes_page_refresh (self);
@@ -454,6 +534,17 @@ refresh_chefs (GrRecipesPage *self)
         g_list_free (children);
 }
 
+static void
+overview_changed (GrRecipesPage    *self,
+                  GrOverviewChange  change)
+{
+        if (change & (GR_OVERVIEW_TODAYS | GR_OVERVIEW_PICKS))
+                refresh_featured (self);
+
+        if (change & GR_OVERVIEW_CHEFS)
+                populate_chefs_from_store (self);
+}
+
 static void
 reloaded (GrRecipesPage *self)
 {
@@ -469,9 +560,10 @@ connect_store_signals (GrRecipesPage *page)
 
         store = gr_recipe_store_get ();
 
-        g_signal_connect_swapped (store, "recipe-added", G_CALLBACK (repopulate_recipes), page);
-        g_signal_connect_swapped (store, "recipe-removed", G_CALLBACK (repopulate_recipes), page);
-        g_signal_connect_swapped (store, "recipe-changed", G_CALLBACK (repopulate_recipes), page);
+        g_signal_connect_swapped (store, "recipe-removed", G_CALLBACK (recipe_changed), page);
+        g_signal_connect_swapped (store, "recipe-changed", G_CALLBACK (recipe_changed), page);
+        g_signal_connect_swapped (store, "shopping-changed", G_CALLBACK (shopping_changed), page);
+        g_signal_connect_swapped (store, "overview-changed", G_CALLBACK (overview_changed), page);
         g_signal_connect_swapped (store, "chefs-changed", G_CALLBACK (refresh_chefs), page);
         g_signal_connect_swapped (store, "reloaded", G_CALLBACK (reloaded), page);
 }
@@ -26,7 +26,7 @@
 #include "gr-search-page.h"
 #include "gr-recipe-store.h"
 #include "gr-recipe.h"
-#include "gr-recipe-tile.h"
+#include "gr-recipe-grid.h"
 #include "gr-utils.h"
 #include "gr-list-page.h"
 #include "gr-settings.h"
@@ -37,8 +37,7 @@ struct _GrSearchPage
         GtkBox parent_instance;
 
         GtkWidget *search_stack;
-        GtkWidget *flow_box;
-        int count;
+        GtkWidget *grid;
 
         GrRecipeSearch *search;
 };
@@ -61,8 +60,7 @@ static void
 search_started (GrRecipeSearch *search,
                 GrSearchPage   *page)
 {
-        container_remove_all (GTK_CONTAINER (page->flow_box));
-        page->count = 0;
+        gr_recipe_grid_clear (GR_RECIPE_GRID (page->grid));
 }
 
 static void
@@ -72,16 +70,8 @@ search_hits_added (GrRecipeSearch *search,
 {
         GList *l;
 
-        for (l = hits; l; l = l->next) {
-                GrRecipe *recipe = l->data;
-                GtkWidget *tile;
-
-                tile = gr_recipe_tile_new (recipe);
-                gtk_widget_show (tile);
-                gtk_container_add (GTK_CONTAINER (page->flow_box), tile);
-
-                page->count++;
-        }
+        for (l = hits; l; l = l->next)
+                gr_recipe_grid_add (GR_RECIPE_GRID (page->grid), l->data);
 }
 
 static void
@@ -89,75 +79,28 @@ search_hits_removed (GrRecipeSearch *search,
                      GList          *hits,
                      GrSearchPage   *page)
 {
-        GList *children, *l;
-
-        children = gtk_container_get_children (GTK_CONTAINER (page->flow_box));
-        for (l = children; l; l = l->next) {
-                GtkWidget *item = l->data;
-                GtkWidget *tile;
-                GrRecipe *recipe;
-
-                tile = gtk_bin_get_child (GTK_BIN (item));
-                recipe = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile));
-                if (g_list_find (hits, recipe)) {
-                        gtk_container_remove (GTK_CONTAINER (page->flow_box), item);
-                        page->count--;
-                }
-        }
+        GList *l;
+
+        for (l = hits; l; l = l->next)
+                gr_recipe_grid_remove_recipe (GR_RECIPE_GRID (page->grid), l->data);
 }
 
 static void
 search_finished (GrRecipeSearch *search,
                  GrSearchPage   *page)
 {
-        gtk_stack_set_visible_child_name (GTK_STACK (page->search_stack),
-                                          page->count > 0 ? "list" : "empty");
-}
-
-static int
-name_sort_func (GtkFlowBoxChild *child1,
-                GtkFlowBoxChild *child2,
-                gpointer         data)
-{
-        GtkWidget *tile1 = gtk_bin_get_child (GTK_BIN (child1));
-        GtkWidget *tile2 = gtk_bin_get_child (GTK_BIN (child2));
-        GrRecipe *recipe1 = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile1));
-        GrRecipe *recipe2 = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile2));
-        const char *name1 = gr_recipe_get_name (recipe1);
-        const char *name2 = gr_recipe_get_name (recipe2);
-
-        return strcmp (name1, name2);
-}
+        GListModel *model;
 
-static int
-date_sort_func (GtkFlowBoxChild *child1,
-                GtkFlowBoxChild *child2,
-                gpointer         data)
-{
-        GtkWidget *tile1 = gtk_bin_get_child (GTK_BIN (child1));
-        GtkWidget *tile2 = gtk_bin_get_child (GTK_BIN (child2));
-        GrRecipe *recipe1 = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile1));
-        GrRecipe *recipe2 = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile2));
-        GDateTime *mtime1 = gr_recipe_get_mtime (recipe1);
-        GDateTime *mtime2 = gr_recipe_get_mtime (recipe2);
-
-        return g_date_time_compare (mtime2, mtime1);
+        model = gr_recipe_grid_get_model (GR_RECIPE_GRID (page->grid));
+        gtk_stack_set_visible_child_name (GTK_STACK (page->search_stack),
+                                          g_list_model_get_n_items (model) > 0 ? "list" : "empty");
 }
 
 static void
 gr_search_page_set_sort (GrSearchPage *page,
-                         GrSortKey   sort)
+                         GrSortKey     sort)
 {
-        switch (sort) {
-        case SORT_BY_NAME:
-                gtk_flow_box_set_sort_func (GTK_FLOW_BOX (page->flow_box), name_sort_func, page, NULL);
-                break;
-        case SORT_BY_RECENCY:
-                gtk_flow_box_set_sort_func (GTK_FLOW_BOX (page->flow_box), date_sort_func, page, NULL);
-                break;
-        default:
-                g_assert_not_reached ();
-        }
+        gr_recipe_grid_set_sort (GR_RECIPE_GRID (page->grid), sort);
 }
 
 static void
@@ -180,6 +123,7 @@ gr_search_page_init (GrSearchPage *page)
         connect_store_signals (page);
 
         page->search = gr_recipe_search_new ();
+        gr_recipe_search_set_threaded (page->search, TRUE);
         g_signal_connect (page->search, "started", G_CALLBACK (search_started), page);
         g_signal_connect (page->search, "hits-added", G_CALLBACK (search_hits_added), page);
         g_signal_connect (page->search, "hits-removed", G_CALLBACK (search_hits_removed), page);
@@ -199,7 +143,7 @@ gr_search_page_class_init (GrSearchPageClass *klass)
 
         gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/Recipes/gr-search-page.ui");
 
-        gtk_widget_class_bind_template_child (GTK_WIDGET_CLASS (klass), GrSearchPage, flow_box);
+        gtk_widget_class_bind_template_child (GTK_WIDGET_CLASS (klass), GrSearchPage, grid);
         gtk_widget_class_bind_template_child (GTK_WIDGET_CLASS (klass), GrSearchPage, search_stack);
 }
 
@@ -213,31 +157,6 @@ gr_search_page_new (void)
         return GTK_WIDGET (page);
 }
 
-typedef struct
-{
-        const char *term;
-        gboolean filled;
-} CheckData;
-
-#if 0
-static void
-check_match (GtkWidget *child,
-             gpointer   data)
-{
-        GtkWidget *tile;
-        GrRecipe *recipe;
-        CheckData *check_data = data;
-
-        tile = gtk_bin_get_child (GTK_BIN (child));
-        recipe = gr_recipe_tile_get_recipe (GR_RECIPE_TILE (tile));
-
-        if (!gr_recipe_matches (recipe, check_data->term))
-                gtk_container_remove (GTK_CONTAINER (gtk_widget_get_parent (child)), child);
-        else
-                check_data->filled = TRUE;
-}
-#endif
-
 void
 gr_search_page_update_search (GrSearchPage  *page,
                               const char   **terms)
@@ -245,7 +164,7 @@ gr_search_page_update_search (GrSearchPage  *page,
         gtk_stack_set_visible_child_name (GTK_STACK (page->search_stack), "list");
 
         if (terms == NULL || terms[0] == NULL) {
-                container_remove_all (GTK_CONTAINER (page->flow_box));
+                gr_recipe_grid_clear (GR_RECIPE_GRID (page->grid));
         }
 
         gr_recipe_search_set_terms (page->search, terms);
@@ -268,4 +187,5 @@ connect_store_signals (GrSearchPage *page)
         g_signal_connect_swapped (store, "recipe-added", G_CALLBACK (search_page_reload), page);
         g_signal_connect_swapped (store, "recipe-removed", G_CALLBACK (search_page_reload), page);
         g_signal_connect_swapped (store, "recipe-changed", G_CALLBACK (search_page_reload), page);
+        g_signal_connect_swapped (store, "reloaded", G_CALLBACK (search_page_reload), page);
 }
@@ -655,7 +655,8 @@ file_chooser_response (GtkNativeDialog  *self,
 {
 	GrRecipeStore *store;
 	if (response_id == GTK_RESPONSE_ACCEPT) {
-		GList *recipes, *items;
+		g_autoptr(GPtrArray) recipes = NULL;
+		GList *items;
 		g_autoptr (GFile) file = NULL;
 		g_autofree char *text = NULL;
 
@@ -667,7 +668,6 @@ file_chooser_response (GtkNativeDialog  *self,
 
 		text = gr_shopping_list_format (recipes, items);
 
-		g_list_free_full (recipes, g_object_unref);
 		g_list_free_full (items, item_free);
 
 		file = gtk_file_chooser_get_file (GTK_FILE_CHOOSER (self));
@@ -708,7 +708,8 @@ mail_done (GObject      *source,
 static void
 share_list (GrShoppingListExporter *exporter)
 {
-        GList *recipes, *items;
+        g_autoptr(GPtrArray) recipes = NULL;
+        GList *items;
         g_autofree char *text = NULL;
         GtkWidget *window;
         GrRecipeStore *store;
@@ -724,7 +725,6 @@ share_list (GrShoppingListExporter *exporter)
                       NULL, _("Shopping List"), text, NULL,
                       mail_done, exporter);
 
-        g_list_free_full (recipes, g_object_unref);
         g_list_free_full (items, item_free);
 }
 
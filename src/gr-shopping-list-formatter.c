@@ -31,19 +31,20 @@
 #include "gr-utils.h"
 
 char *
-gr_shopping_list_format (GList *recipes,
-                         GList *items)
+gr_shopping_list_format (GPtrArray *recipes,
+                         GList     *items)
 {
         GString *s;
         GList *l;
+        guint i;
 
         s = g_string_new ("");
 
         g_string_append_printf (s, "*** %s ***\n", _("Shopping List"));
         g_string_append (s, "\n");
         g_string_append_printf (s, "%s\n", _("For the following recipes:"));
-        for (l = recipes; l; l = l->next) {
-                GrRecipe *recipe = l->data;
+        for (i = 0; i < recipes->len; i++) {
+                GrRecipe *recipe = g_ptr_array_index (recipes, i);
                 g_string_append_printf (s, "%s\n", gr_recipe_get_translated_name (recipe));
         }
 
@@ -26,7 +26,7 @@
 
 G_BEGIN_DECLS
 
-char *gr_shopping_list_format (GList *recipes,
-                               GList *items);
+char *gr_shopping_list_format (GPtrArray *recipes,
+                               GList     *items);
 
 G_END_DECLS
@@ -56,6 +56,8 @@ struct _GrShoppingPage
 
         GtkSizeGroup *group;
         GHashTable *ingredients;
+        GHashTable *yields;
+        GHashTable *changed;
 
         GrShoppingListPrinter *printer;
 
@@ -81,7 +83,9 @@ shopping_page_finalize (GObject *object)
 
         g_clear_object (&self->search);
         g_clear_object (&self->group);
+        g_clear_pointer (&self->changed, g_hash_table_unref);
         g_clear_pointer (&self->ingredients, g_hash_table_unref);
+        g_clear_pointer (&self->yields, g_hash_table_unref);
         g_clear_object (&self->printer);
 
         g_free (self->title);
@@ -139,15 +143,30 @@ recount_recipes (GrShoppingPage *page)
         }
 }
 
-typedef struct {
-        double amount;
-        GrUnit unit;
-} Unit;
+/* Shopping totals
+ * ---------------
+ *
+ * The ingredients of all recipes on the list are added up per base
+ * unit: volumes in millilitres, weights in grams, everything else in
+ * the unit it was given in. Amounts are only converted to the units
+ * the user prefers when a row is formatted.
+ *
+ * We remember the yield that each recipe was counted with, so that
+ * when a recipe is added, removed or its yield changes, we only
+ * subtract its old contribution and add the new one. Ingredients
+ * whose totals changed are collected, and only their rows are
+ * updated afterwards.
+ */
+
+#define N_UNITS (GR_LAST_UNIT + 1)
 
 typedef struct {
         char *ingredient;
-        GArray *units;
+        double amounts[N_UNITS];
+        int counts[N_UNITS];
+        int count;
         gboolean removed;
+        GtkWidget *row;
 } Ingredient;
 
 static Ingredient *
@@ -160,7 +179,6 @@ ingredient_new (const char *ingredient)
 
         ing = g_new0 (Ingredient, 1);
         ing->ingredient = g_strdup (ingredient);
-        ing->units = g_array_new (FALSE, TRUE, sizeof (Unit));
 
         ing->removed = gr_recipe_store_not_shopping_ingredient (store, ingredient);
 
@@ -173,37 +191,27 @@ ingredient_free (gpointer data)
         Ingredient *ing = data;
 
         g_free (ing->ingredient);
-        g_array_free (ing->units, TRUE);
         g_free (ing);
 }
 
-static void
-ingredient_clear (Ingredient *ing)
-{
-        g_array_set_size (ing->units, 0);
-}
-
 static void
 ingredient_add (Ingredient *ing,
                 double      amount,
-                GrUnit      unit)
+                GrUnit      unit,
+                int         sign)
 {
-        int i;
-        Unit nu;
+        GrUnit base;
+        double factor;
 
-        for (i = 0; i < ing->units->len; i++) {
-                Unit *u = &g_array_index (ing->units, Unit, i);
-
-                if (u->unit == unit) {
-                        u->amount += amount;
-                        return;
-                }
-        }
+        base = gr_convert_get_base_unit (unit, &factor);
 
-        nu.amount = amount;
-        nu.unit = unit;
+        ing->amounts[base] += sign * amount * factor;
+        ing->counts[base] += sign;
+        ing->count += sign;
 
-        g_array_append_val (ing->units, nu);
+        /* Don't let rounding errors linger */
+        if (ing->counts[base] == 0)
+                ing->amounts[base] = 0;
 }
 
 static char *
@@ -211,45 +219,23 @@ ingredient_format_unit (Ingredient *ing)
 {
         g_autoptr(GString) s = NULL;
         int i;
-        GrPreferredUnit user_volume_unit = gr_convert_get_volume_unit();
-        GrPreferredUnit user_weight_unit = gr_convert_get_weight_unit();
-        GrUnit u1;
-        double a1;
-        GrDimension dimension;
-        s = g_string_new ("");
 
-        for (i = 0; i < ing->units->len; i++) {
-                Unit *unit = &g_array_index (ing->units, Unit, i);
-                double a = unit->amount;
-                GrUnit u = unit->unit;
+        s = g_string_new ("");
 
-                dimension = gr_unit_get_dimension (u);
+        for (i = 0; i < N_UNITS; i++) {
+                if (ing->counts[i] == 0)
+                        continue;
 
-                if (dimension == GR_DIMENSION_VOLUME) {
-                        gr_convert_volume (&a, &u, user_volume_unit);
-                }
-                else if (dimension == GR_DIMENSION_MASS) {
-                        gr_convert_weight (&a, &u, user_weight_unit);
-                }
+                if (s->len > 0)
+                        g_string_append (s, ", ");
 
-                if (i == 0) {
-                        u1 = u;
-                        a1 = a;
-                }
-                else if (u == u1) {
-                        a1 += a;
-                }
-                else {
-                        g_error ("conversion yielded different units...why...");
-                }
+                gr_convert_format (s, ing->amounts[i], i);
         }
 
-        gr_convert_format (s, a1, u1);
-
         return g_strdup (s->str);
 }
 
-static void
+static GtkWidget *
 add_removed_row (GrShoppingPage *page,
                  const char *unit,
                  const char *ing)
@@ -282,6 +268,8 @@ add_removed_row (GrShoppingPage *page,
         g_object_set_data (G_OBJECT (row), "ing", ing_label);
 
         gtk_widget_show (page->add_button);
+
+        return row;
 }
 
 static void
@@ -308,7 +296,7 @@ remove_ingredient (GtkButton *button, GrShoppingPage *page)
 
         gr_recipe_store_remove_shopping_ingredient (store, name);
 
-        add_removed_row (page, unit, name);
+        ing->row = add_removed_row (page, unit, name);
 
         page->active_row = NULL;
         gtk_widget_destroy (row);
@@ -316,7 +304,7 @@ remove_ingredient (GtkButton *button, GrShoppingPage *page)
         recount_ingredients (page);
 }
 
-static void
+static GtkWidget *
 add_ingredient_row (GrShoppingPage *page,
                     const char *unit,
                     const char *ing)
@@ -372,6 +360,8 @@ add_ingredient_row (GrShoppingPage *page,
         g_object_set_data (G_OBJECT (row), "unit", unit_label);
         g_object_set_data (G_OBJECT (row), "ing", ing_label);
         g_object_set_data (G_OBJECT (row), "buttons-stack", stack);
+
+        return row;
 }
 
 static void
@@ -434,7 +424,7 @@ removed_row_activated (GtkListBox     *list,
 
         gr_recipe_store_readd_shopping_ingredient (store, name);
 
-        add_ingredient_row (page, unit, name);
+        ing->row = add_ingredient_row (page, unit, name);
 
         gtk_widget_destroy (GTK_WIDGET (row));
 
@@ -450,7 +440,8 @@ static void
 add_ingredient (GrShoppingPage *page,
                 double      amount,
                 GrUnit      unit,
-                const char *ingredient)
+                const char *ingredient,
+                int         sign)
 {
         Ingredient *ing;
 
@@ -460,19 +451,38 @@ add_ingredient (GrShoppingPage *page,
                 g_hash_table_insert (page->ingredients, g_strdup (ingredient), ing);
         }
 
-        ingredient_add (ing, amount, unit);
+        ingredient_add (ing, amount, unit, sign);
+        g_hash_table_add (page->changed, ing);
 }
 
+/* What a recipe contributed to the totals, so that it can be
+ * subtracted again after the recipe has been edited.
+ */
+typedef struct {
+        GrIngredientsList *ingredients;
+        double base_yield;
+        double yield;
+} Counted;
+
 static void
-collect_ingredients_from_recipe (GrShoppingPage *page,
-                                 GrRecipe       *recipe,
-                                 double          yield)
+counted_free (gpointer data)
+{
+        Counted *counted = data;
+
+        g_object_unref (counted->ingredients);
+        g_free (counted);
+}
+
+static void
+count_ingredients (GrShoppingPage    *page,
+                   GrIngredientsList *il,
+                   double             base_yield,
+                   double             yield,
+                   int                sign)
 {
-        g_autoptr(GrIngredientsList) il = NULL;
         g_autofree char **seg = NULL;
         int i, j;
 
-        il = gr_ingredients_list_new (gr_recipe_get_ingredients (recipe));
         seg = gr_ingredients_list_get_segments (il);
         for (i = 0; seg[i]; i++) {
                 g_auto(GStrv) ing = NULL;
@@ -482,55 +492,107 @@ collect_ingredients_from_recipe (GrShoppingPage *page,
                         double amount;
 
                         amount = gr_ingredients_list_get_amount (il, seg[i], ing[j]);
-                        amount = amount * yield / gr_recipe_get_yield (recipe);
+                        amount = amount * yield / base_yield;
                         unit = gr_ingredients_list_get_unit (il, seg[i], ing[j]);
-                        add_ingredient (page, amount, unit, ing[j]);
+                        add_ingredient (page, amount, unit, ing[j], sign);
                 }
         }
 }
 
 static void
-collect_ingredients (GrShoppingPage *page)
+count_recipe (GrShoppingPage *page,
+              GrRecipe       *recipe,
+              double          yield)
 {
-        GList *children, *l;
-        GHashTableIter iter;
-        Ingredient *ing;
+        GrIngredientsList *il;
+        Counted *old;
+        Counted *counted;
 
-        g_hash_table_iter_init (&iter, page->ingredients);
-        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&ing)) {
-                ingredient_clear (ing);
+        il = gr_recipe_get_ingredients_list (recipe);
+
+        old = g_hash_table_lookup (page->yields, recipe);
+        if (old) {
+                if (old->yield == yield &&
+                    old->ingredients == il &&
+                    old->base_yield == gr_recipe_get_yield (recipe))
+                        return;
+                count_ingredients (page, old->ingredients, old->base_yield, old->yield, -1);
         }
 
-        children = gtk_container_get_children (GTK_CONTAINER (page->recipe_list));
+        count_ingredients (page, il, gr_recipe_get_yield (recipe), yield, 1);
 
-        for (l = children; l; l = l->next) {
-                GtkWidget *tile = gtk_bin_get_child (GTK_BIN (l->data));
-                GrRecipe *recipe;
-                double yield;
+        counted = g_new (Counted, 1);
+        counted->ingredients = g_object_ref (il);
+        counted->base_yield = gr_recipe_get_yield (recipe);
+        counted->yield = yield;
+        g_hash_table_insert (page->yields, g_object_ref (recipe), counted);
+}
 
-                recipe = gr_shopping_tile_get_recipe (GR_SHOPPING_TILE (tile));
-                yield = gr_shopping_tile_get_yield (GR_SHOPPING_TILE (tile));
-                collect_ingredients_from_recipe (page, recipe, yield);
-        }
-        g_list_free (children);
+static void
+uncount_recipe (GrShoppingPage *page,
+                GrRecipe       *recipe)
+{
+        Counted *old;
 
-        g_hash_table_iter_init (&iter, page->ingredients);
-        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&ing)) {
-                if (ing->units->len == 0)
-                        g_hash_table_iter_remove (&iter);
+        old = g_hash_table_lookup (page->yields, recipe);
+        if (old) {
+                count_ingredients (page, old->ingredients, old->base_yield, old->yield, -1);
+                g_hash_table_remove (page->yields, recipe);
         }
+}
 
-        container_remove_all (GTK_CONTAINER (page->ingredients_list));
-        container_remove_all (GTK_CONTAINER (page->removed_list));
-        g_hash_table_iter_init (&iter, page->ingredients);
-        while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&ing)) {
+static void
+update_rows (GrShoppingPage *page)
+{
+        GHashTableIter iter;
+        Ingredient *ing;
+        GList *children;
+
+        g_hash_table_iter_init (&iter, page->changed);
+        while (g_hash_table_iter_next (&iter, (gpointer *)&ing, NULL)) {
                 g_autofree char *unit = NULL;
+
+                if (ing->count == 0) {
+                        if (ing->row) {
+                                if (page->active_row == ing->row)
+                                        page->active_row = NULL;
+                                gtk_widget_destroy (ing->row);
+                        }
+                        g_hash_table_remove (page->ingredients, ing->ingredient);
+                        continue;
+                }
+
                 unit = ingredient_format_unit (ing);
-                if (ing->removed)
-                        add_removed_row (page, unit, ing->ingredient);
+                if (ing->row) {
+                        GtkWidget *label;
+
+                        label = GTK_WIDGET (g_object_get_data (G_OBJECT (ing->row), "unit"));
+                        gtk_label_set_label (GTK_LABEL (label), unit);
+                }
+                else if (ing->removed)
+                        ing->row = add_removed_row (page, unit, ing->ingredient);
                 else
-                        add_ingredient_row (page, unit, ing->ingredient);
+                        ing->row = add_ingredient_row (page, unit, ing->ingredient);
         }
+
+        g_hash_table_remove_all (page->changed);
+
+        children = gtk_container_get_children (GTK_CONTAINER (page->removed_list));
+        if (children == NULL)
+                gtk_widget_hide (page->add_button);
+        g_list_free (children);
+}
+
+static void
+clear_ingredients (GrShoppingPage *page)
+{
+        page->active_row = NULL;
+        container_remove_all (GTK_CONTAINER (page->ingredients_list));
+        container_remove_all (GTK_CONTAINER (page->removed_list));
+        g_hash_table_remove_all (page->changed);
+        g_hash_table_remove_all (page->ingredients);
+        g_hash_table_remove_all (page->yields);
+        gtk_widget_hide (page->add_button);
 }
 
 static void
@@ -554,6 +616,7 @@ search_started (GrRecipeSearch *search,
                 GrShoppingPage *page)
 {
         container_remove_all (GTK_CONTAINER (page->recipe_list));
+        clear_ingredients (page);
         page->recipe_count = 0;
 }
 
@@ -577,6 +640,8 @@ search_hits_added (GrRecipeSearch *search,
                 g_signal_connect (tile, "notify::yield", G_CALLBACK (yield_changed), page);
                 gtk_container_add (GTK_CONTAINER (page->recipe_list), tile);
                 page->recipe_count++;
+
+                count_recipe (page, recipe, yield);
         }
 }
 
@@ -596,6 +661,7 @@ search_hits_removed (GrRecipeSearch *search,
                 tile = gtk_bin_get_child (GTK_BIN (item));
                 recipe = gr_shopping_tile_get_recipe (GR_SHOPPING_TILE (tile));
                 if (g_list_find (hits, recipe)) {
+                        uncount_recipe (page, recipe);
                         gtk_container_remove (GTK_CONTAINER (page->recipe_list), item);
                         page->recipe_count--;
                 }
@@ -606,11 +672,13 @@ static void
 search_finished (GrRecipeSearch *search,
                  GrShoppingPage *page)
 {
-        collect_ingredients (page);
+        update_rows (page);
         recount_ingredients (page);
         recount_recipes (page);
 }
 
+static void shopping_changed (GrShoppingPage *page);
+
 static void
 clear_list (GrShoppingPage *page)
 {
@@ -619,14 +687,12 @@ clear_list (GrShoppingPage *page)
 
         store = gr_recipe_store_get ();
 
-        container_remove_all (GTK_CONTAINER (page->ingredients_list));
-        container_remove_all (GTK_CONTAINER (page->removed_list));
+        clear_ingredients (page);
         container_remove_all (GTK_CONTAINER (page->recipe_list));
 
+        g_signal_handlers_block_by_func (store, shopping_changed, page);
         gr_recipe_store_clear_shopping_list (store);
-
-        g_hash_table_remove_all (page->ingredients);
-        gtk_widget_hide (page->add_button);
+        g_signal_handlers_unblock_by_func (store, shopping_changed, page);
 
         window = gtk_widget_get_ancestor (GTK_WIDGET (page), GTK_TYPE_APPLICATION_WINDOW);
         gr_window_go_back (GR_WINDOW (window));
@@ -734,6 +800,8 @@ gr_shopping_page_init (GrShoppingPage *page)
 
         page->group = gtk_size_group_new (GTK_SIZE_GROUP_HORIZONTAL);
         page->ingredients = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ingredient_free);
+        page->yields = g_hash_table_new_full (NULL, NULL, g_object_unref, counted_free);
+        page->changed = g_hash_table_new (NULL, NULL);
 }
 
 static void
@@ -818,8 +886,7 @@ gr_shopping_page_new (void)
 void
 gr_shopping_page_populate (GrShoppingPage *self)
 {
-        container_remove_all (GTK_CONTAINER (self->ingredients_list));
-        container_remove_all (GTK_CONTAINER (self->removed_list));
+        clear_ingredients (self);
         container_remove_all (GTK_CONTAINER (self->recipe_list));
         gr_recipe_search_stop (self->search);
         gr_recipe_search_set_query (self->search, "is:shopping");
@@ -838,7 +905,8 @@ recipe_removed (GrShoppingPage *page,
                 if (recipe == gr_shopping_tile_get_recipe (GR_SHOPPING_TILE (tile))) {
                         gtk_widget_destroy (GTK_WIDGET (l->data));
 
-                        collect_ingredients (page);
+                        uncount_recipe (page, recipe);
+                        update_rows (page);
                         recount_ingredients (page);
                         recount_recipes (page);
 
@@ -849,16 +917,13 @@ recipe_removed (GrShoppingPage *page,
 }
 
 static void
-recipe_added (GrShoppingPage *page,
-              GrRecipe       *recipe)
+add_or_update_tile (GrShoppingPage *page,
+                    GrRecipe       *recipe)
 {
         GrRecipeStore *store;
         GList *children, *l;
         double yield;
 
-        if (!gtk_widget_is_drawable (GTK_WIDGET (page)))
-                return;
-
         store = gr_recipe_store_get ();
 
         yield = gr_recipe_store_get_shopping_yield (store, recipe);
@@ -882,7 +947,19 @@ recipe_added (GrShoppingPage *page,
                 gtk_container_add (GTK_CONTAINER (page->recipe_list), tile);
         }
 
-        collect_ingredients (page);
+        count_recipe (page, recipe, yield);
+}
+
+static void
+recipe_added (GrShoppingPage *page,
+              GrRecipe       *recipe)
+{
+        if (!gtk_widget_is_drawable (GTK_WIDGET (page)))
+                return;
+
+        add_or_update_tile (page, recipe);
+
+        update_rows (page);
         recount_ingredients (page);
         recount_recipes (page);
 }
@@ -904,6 +981,41 @@ recipe_changed (GrShoppingPage *page,
                 recipe_removed (page, recipe);
 }
 
+/* Several recipes were added or removed at once */
+static void
+shopping_changed (GrShoppingPage *page)
+{
+        GrRecipeStore *store;
+        g_autoptr(GPtrArray) recipes = NULL;
+        GList *children, *l;
+        guint i;
+
+        if (!gtk_widget_is_drawable (GTK_WIDGET (page)))
+                return;
+
+        store = gr_recipe_store_get ();
+
+        children = gtk_container_get_children (GTK_CONTAINER (page->recipe_list));
+        for (l = children; l; l = l->next) {
+                GtkWidget *tile = gtk_bin_get_child (GTK_BIN (l->data));
+                GrRecipe *recipe = gr_shopping_tile_get_recipe (GR_SHOPPING_TILE (tile));
+
+                if (!gr_recipe_store_is_in_shopping (store, recipe)) {
+                        uncount_recipe (page, recipe);
+                        gtk_widget_destroy (GTK_WIDGET (l->data));
+                }
+        }
+        g_list_free (children);
+
+        recipes = gr_recipe_store_get_shopping_list (store);
+        for (i = 0; i < recipes->len; i++)
+                add_or_update_tile (page, g_ptr_array_index (recipes, i));
+
+        update_rows (page);
+        recount_ingredients (page);
+        recount_recipes (page);
+}
+
 static void
 connect_store_signals (GrShoppingPage *page)
 {
@@ -913,4 +1025,5 @@ connect_store_signals (GrShoppingPage *page)
 
         g_signal_connect_swapped (store, "recipe-removed", G_CALLBACK (recipe_removed), page);
         g_signal_connect_swapped (store, "recipe-changed", G_CALLBACK (recipe_changed), page);
+        g_signal_connect_swapped (store, "shopping-changed", G_CALLBACK (shopping_changed), page);
 }
@@ -0,0 +1,186 @@
+/* gr-string-set.c:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "gr-string-set.h"
+
+/* Ordered string sets
+ * -------------------
+ *
+ * The favorites, the export list and the ingredients removed from the
+ * shopping list are stored in GSettings as string arrays, with the
+ * most recently added string first. We need to check membership in
+ * them often, so we keep them in a hash table that maps each string to
+ * the sequence number at which it was added. The array form is only
+ * built when it is asked for, by sorting the strings by their sequence
+ * numbers, and kept until the set changes.
+ */
+
+struct _GrStringSet
+{
+        GHashTable *strings;    /* string -> sequence number */
+        guint64 next;
+        char **strv;
+};
+
+/**
+ * gr_string_set_new:
+ * @strv: (nullable): initial contents, most recent first
+ *
+ * Creates a new set, containing the strings in @strv.
+ * Duplicates in @strv are dropped.
+ *
+ * Returns: (transfer full): a new #GrStringSet
+ */
+GrStringSet *
+gr_string_set_new (const char * const *strv)
+{
+        GrStringSet *set;
+        int i;
+
+        set = g_new0 (GrStringSet, 1);
+        set->strings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+        if (strv) {
+                /* Add from the end, so the first string is the most recent one */
+                for (i = g_strv_length ((char **)strv) - 1; i >= 0; i--)
+                        gr_string_set_prepend (set, strv[i]);
+        }
+
+        return set;
+}
+
+void
+gr_string_set_free (GrStringSet *set)
+{
+        g_hash_table_unref (set->strings);
+        g_free (set->strv);
+        g_free (set);
+}
+
+gboolean
+gr_string_set_contains (GrStringSet *set,
+                        const char  *s)
+{
+        return g_hash_table_contains (set->strings, s);
+}
+
+/**
+ * gr_string_set_prepend:
+ * @set: a #GrStringSet
+ * @s: a string
+ *
+ * Adds @s to @set as its most recent string, unless it is already
+ * there.
+ *
+ * Returns: %TRUE if @s was added
+ */
+gboolean
+gr_string_set_prepend (GrStringSet *set,
+                       const char  *s)
+{
+        guint64 *seq;
+
+        if (g_hash_table_contains (set->strings, s))
+                return FALSE;
+
+        seq = g_new (guint64, 1);
+        *seq = set->next++;
+        g_hash_table_insert (set->strings, g_strdup (s), seq);
+        g_clear_pointer (&set->strv, g_free);
+
+        return TRUE;
+}
+
+/**
+ * gr_string_set_remove:
+ * @set: a #GrStringSet
+ * @s: a string
+ *
+ * Removes @s from @set.
+ *
+ * Returns: %TRUE if @s was in @set
+ */
+gboolean
+gr_string_set_remove (GrStringSet *set,
+                      const char  *s)
+{
+        if (!g_hash_table_remove (set->strings, s))
+                return FALSE;
+
+        g_clear_pointer (&set->strv, g_free);
+
+        return TRUE;
+}
+
+void
+gr_string_set_remove_all (GrStringSet *set)
+{
+        g_hash_table_remove_all (set->strings);
+        g_clear_pointer (&set->strv, g_free);
+}
+
+guint
+gr_string_set_get_length (GrStringSet *set)
+{
+        return g_hash_table_size (set->strings);
+}
+
+static int
+compare_by_seq (gconstpointer a,
+                gconstpointer b,
+                gpointer      data)
+{
+        GHashTable *strings = data;
+        guint64 seq_a = *(guint64 *)g_hash_table_lookup (strings, *(const char **)a);
+        guint64 seq_b = *(guint64 *)g_hash_table_lookup (strings, *(const char **)b);
+
+        if (seq_a > seq_b)
+                return -1;
+        else if (seq_a < seq_b)
+                return 1;
+        else
+                return 0;
+}
+
+/**
+ * gr_string_set_get_strv:
+ * @set: a #GrStringSet
+ *
+ * Returns the strings in @set, most recent first. The array
+ * is owned by @set, and is valid until @set is changed.
+ *
+ * Returns: (transfer none): a %NULL-terminated array of strings
+ */
+const char **
+gr_string_set_get_strv (GrStringSet *set)
+{
+        guint length;
+
+        if (set->strv == NULL) {
+                set->strv = (char **)g_hash_table_get_keys_as_array (set->strings, &length);
+                g_qsort_with_data (set->strv, length, sizeof (char *), compare_by_seq, set->strings);
+        }
+
+        return (const char **)set->strv;
+}
@@ -0,0 +1,44 @@
+/* gr-string-set.h:
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * Licensed under the GNU General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GrStringSet GrStringSet;
+
+GrStringSet  *gr_string_set_new          (const char * const *strv);
+void          gr_string_set_free         (GrStringSet        *set);
+
+gboolean      gr_string_set_contains     (GrStringSet        *set,
+                                          const char         *s);
+gboolean      gr_string_set_prepend      (GrStringSet        *set,
+                                          const char         *s);
+gboolean      gr_string_set_remove       (GrStringSet        *set,
+                                          const char         *s);
+void          gr_string_set_remove_all   (GrStringSet        *set);
+guint         gr_string_set_get_length   (GrStringSet        *set);
+const char  **gr_string_set_get_strv     (GrStringSet        *set);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrStringSet, gr_string_set_free)
+
+G_END_DECLS
@@ -802,13 +802,19 @@ back_to_shopping (GrWindow *window)
         GList *items;
         int i;
         GrShoppingListExporter *exporter = NULL;
+        g_autoptr(GPtrArray) recipes = NULL;
+        g_autoptr(GArray) yields = NULL;
 
         store = gr_recipe_store_get ();
 
+        recipes = g_ptr_array_new ();
+        yields = g_array_new (FALSE, FALSE, sizeof (double));
         for (l = window->shopping_done_list; l; l = l->next) {
                 ShoppingListEntry *entry = l->data;
-                gr_recipe_store_add_to_shopping (store, entry->recipe, entry->yield);
+                g_ptr_array_add (recipes, entry->recipe);
+                g_array_append_val (yields, entry->yield);
         }
+        gr_recipe_store_add_recipes_to_shopping (store, recipes, (const double *)yields->data);
         items = get_ingredients (GR_SHOPPING_PAGE (window->shopping_page));
         if (!exporter) {
                 GtkWidget *shopping_window;
@@ -839,36 +845,43 @@ static void gr_window_show_transient_list (GrWindow   *window,
 static void
 done_shopping (GrWindow *window)
 {
-        GList *recipes, *l;
+        g_autoptr(GPtrArray) recipes = NULL;
         GrRecipeStore *store;
         const char **removed_ingredients;
         GrShoppingListExporter *exporter = NULL;
+        int i;
 
         store = gr_recipe_store_get ();
 
         recipes = gr_recipe_store_get_shopping_list (store);
         removed_ingredients = gr_recipe_store_get_removed_shopping_ingredients (store);
 
-        if (recipes->next == NULL)
-                gr_window_show_recipe (window, recipes->data);
-        else
-                gr_window_show_transient_list (window, _("Ready to Cook!"), recipes);
+        if (recipes->len == 1) {
+                gr_window_show_recipe (window, g_ptr_array_index (recipes, 0));
+        }
+        else {
+                GList *list = NULL;
+
+                for (i = recipes->len - 1; i >= 0; i--)
+                        list = g_list_prepend (list, g_ptr_array_index (recipes, i));
+                gr_window_show_transient_list (window, _("Ready to Cook!"), list);
+                g_list_free (list);
+        }
 
         gr_window_offer_cooking (window);
 
         g_list_free_full (window->shopping_done_list, shopping_list_entry_free);
         window->shopping_done_list = NULL;
 
-        for (l = recipes; l; l = l->next) {
-                GrRecipe *recipe = l->data;
+        for (i = recipes->len - 1; i >= 0; i--) {
+                GrRecipe *recipe = g_ptr_array_index (recipes, i);
                 ShoppingListEntry *entry;
 
                 entry = g_new (ShoppingListEntry, 1);
                 entry->recipe = g_object_ref (recipe);
                 entry->yield = gr_recipe_store_get_shopping_yield (store, recipe);
-                window->shopping_done_list = g_list_append (window->shopping_done_list, entry);
+                window->shopping_done_list = g_list_prepend (window->shopping_done_list, entry);
         }
-        g_list_free_full (recipes, g_object_unref);
 
         g_strfreev (window->removed_ingredients);
         window->removed_ingredients = g_strdupv ((char **)removed_ingredients);
@@ -0,0 +1,128 @@
+/* blur.c
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <glib.h>
+#include "gr-utils.h"
+#include "gr-utils-private.h"
+
+static GdkPixbuf *
+make_pixbuf (int      width,
+             int      height,
+             gboolean has_alpha)
+{
+        GdkPixbuf *pixbuf;
+        guchar *pixels;
+        int i, size;
+
+        pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+        pixels = gdk_pixbuf_get_pixels (pixbuf);
+        size = gdk_pixbuf_get_rowstride (pixbuf) * height;
+        for (i = 0; i < size; i++)
+                pixels[i] = g_test_rand_int_range (0, 256);
+
+        return pixbuf;
+}
+
+static void
+assert_pixbufs_equal (GdkPixbuf *a,
+                      GdkPixbuf *b)
+{
+        int width, height, rowstride, y;
+        guchar *pa, *pb;
+
+        width = gdk_pixbuf_get_width (a);
+        height = gdk_pixbuf_get_height (a);
+        rowstride = gdk_pixbuf_get_rowstride (a);
+        pa = gdk_pixbuf_get_pixels (a);
+        pb = gdk_pixbuf_get_pixels (b);
+
+        for (y = 0; y < height; y++)
+                g_assert_true (memcmp (pa + y * rowstride,
+                                       pb + y * rowstride,
+                                       width * gdk_pixbuf_get_n_channels (a)) == 0);
+}
+
+static void
+test_blur_matches (void)
+{
+        struct { int width, height, radius; } sizes[] = {
+                { 1, 1, 5 },
+                { 7, 3, 5 },
+                { 33, 17, 2 },
+                { 150, 100, 5 },
+                { 301, 211, 5 },
+                { 64, 64, 40 },
+        };
+        int i, alpha;
+
+        for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+                for (alpha = 0; alpha < 2; alpha++) {
+                        g_autoptr(GdkPixbuf) a = NULL;
+                        g_autoptr(GdkPixbuf) b = NULL;
+
+                        a = make_pixbuf (sizes[i].width, sizes[i].height, alpha);
+                        b = gdk_pixbuf_copy (a);
+
+                        pixbuf_blur_scalar (a, sizes[i].radius, 3);
+                        pixbuf_blur (b, sizes[i].radius, 3);
+
+                        assert_pixbufs_equal (a, b);
+                }
+        }
+}
+
+/* Compares pixbuf_blur with the scalar blur, on an image the size
+ * of a large recipe image.
+ */
+static void
+test_blur_speed (void)
+{
+        g_autoptr(GdkPixbuf) pixbuf = NULL;
+        int iterations = 50;
+        double scalar, vector;
+        int i;
+
+        pixbuf = make_pixbuf (1024, 768, FALSE);
+
+        g_test_timer_start ();
+        for (i = 0; i < iterations; i++)
+                pixbuf_blur_scalar (pixbuf, 5, 3);
+        scalar = g_test_timer_elapsed () / iterations;
+
+        g_test_timer_start ();
+        for (i = 0; i < iterations; i++)
+                pixbuf_blur (pixbuf, 5, 3);
+        vector = g_test_timer_elapsed () / iterations;
+
+        g_test_minimized_result (scalar * 1000, "scalar blur: %.2f ms", scalar * 1000);
+        g_test_minimized_result (vector * 1000, "pixbuf_blur: %.2f ms (%.1fx)", vector * 1000, scalar / vector);
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/blur/matches", test_blur_matches);
+
+        if (g_test_perf ())
+                g_test_add_func ("/blur/speed", test_blur_speed);
+
+        return g_test_run ();
+}
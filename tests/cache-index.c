@@ -0,0 +1,162 @@
+/* cache-index.c
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "gr-cache-index.h"
+
+static char *
+make_index_path (void)
+{
+        g_autoptr(GError) error = NULL;
+        g_autofree char *dir = NULL;
+
+        dir = g_dir_make_tmp ("cache-index-XXXXXX", &error);
+        g_assert_no_error (error);
+
+        return g_build_filename (dir, "cache.index", NULL);
+}
+
+static void
+remove_index (const char *path)
+{
+        g_autofree char *dir = NULL;
+
+        dir = g_path_get_dirname (path);
+        g_remove (path);
+        g_rmdir (dir);
+}
+
+static void
+add_entry (GrCacheIndex *index,
+           const char   *key,
+           gint64        fetched,
+           gboolean      failed)
+{
+        GrCacheEntry entry = { 0, };
+
+        entry.url = (char *)"https://example.org/image.jpg";
+        entry.etag = failed ? NULL : (char *)"\"1234\"";
+        entry.fetched = fetched;
+        entry.size = failed ? 0 : 1000;
+        entry.failed = failed;
+
+        gr_cache_index_update (index, key, &entry);
+}
+
+static void
+test_cache_index_lookup (void)
+{
+        g_autofree char *path = NULL;
+        g_autoptr(GrCacheIndex) index = NULL;
+        g_autoptr(GrCacheEntry) entry = NULL;
+        g_autoptr(GrCacheEntry) missing = NULL;
+
+        path = make_index_path ();
+        index = gr_cache_index_new (path);
+
+        add_entry (index, "/cache/images/a", 100, FALSE);
+        add_entry (index, "/cache/images/b", 200, TRUE);
+
+        entry = gr_cache_index_lookup (index, "/cache/images/a");
+        g_assert_nonnull (entry);
+        g_assert_cmpstr (entry->url, ==, "https://example.org/image.jpg");
+        g_assert_cmpstr (entry->etag, ==, "\"1234\"");
+        g_assert_null (entry->last_modified);
+        g_assert_cmpint (entry->fetched, ==, 100);
+        g_assert_cmpuint (entry->size, ==, 1000);
+        g_assert_false (entry->failed);
+
+        missing = gr_cache_index_lookup (index, "/cache/images/c");
+        g_assert_null (missing);
+
+        remove_index (path);
+}
+
+static void
+test_cache_index_save (void)
+{
+        g_autofree char *path = NULL;
+        g_autoptr(GrCacheIndex) index = NULL;
+        g_autoptr(GrCacheIndex) reloaded = NULL;
+        g_autoptr(GError) error = NULL;
+        int i;
+
+        path = make_index_path ();
+        index = gr_cache_index_new (path);
+
+        /* Add in an order that is not sorted */
+        for (i = 0; i < 100; i++) {
+                g_autofree char *key = g_strdup_printf ("/cache/images/%d", (i * 37) % 100);
+                add_entry (index, key, i, i % 10 == 0);
+        }
+
+        gr_cache_index_save (index, &error);
+        g_assert_no_error (error);
+
+        /* Changes on top of the saved index */
+        gr_cache_index_remove (index, "/cache/images/5");
+        add_entry (index, "/cache/images/6", 1000, FALSE);
+
+        for (i = 0; i < 100; i++) {
+                g_autofree char *key = g_strdup_printf ("/cache/images/%d", i);
+                g_autoptr(GrCacheEntry) entry = NULL;
+
+                entry = gr_cache_index_lookup (index, key);
+                if (i == 5)
+                        g_assert_null (entry);
+                else
+                        g_assert_nonnull (entry);
+        }
+
+        gr_cache_index_save (index, &error);
+        g_assert_no_error (error);
+
+        reloaded = gr_cache_index_new (path);
+        for (i = 0; i < 100; i++) {
+                g_autofree char *key = g_strdup_printf ("/cache/images/%d", (i * 37) % 100);
+                g_autoptr(GrCacheEntry) entry = NULL;
+
+                entry = gr_cache_index_lookup (reloaded, key);
+                if ((i * 37) % 100 == 5) {
+                        g_assert_null (entry);
+                }
+                else if ((i * 37) % 100 == 6) {
+                        g_assert_cmpint (entry->fetched, ==, 1000);
+                }
+                else {
+                        g_assert_nonnull (entry);
+                        g_assert_cmpint (entry->fetched, ==, i);
+                        g_assert_true (entry->failed == (i % 10 == 0));
+                }
+        }
+
+        remove_index (path);
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/cache-index/lookup", test_cache_index_lookup);
+        g_test_add_func ("/cache-index/save", test_cache_index_save);
+
+        return g_test_run ();
+}
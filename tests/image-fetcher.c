@@ -0,0 +1,369 @@
+/* image-fetcher.c
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+#include "gr-image-fetcher.h"
+
+/* A local server that stands in for static.gnome.org. It answers
+ * every request after a short delay, so that requests overlap, and
+ * records the order and concurrency of the requests.
+ */
+typedef struct {
+        SoupServer *server;
+        char *base_url;
+        GPtrArray *paths;
+        int active;
+        int max_active;
+        int not_modified;
+        guint delay;
+} Server;
+
+typedef struct {
+        Server *server;
+        SoupMessage *msg;
+} Delayed;
+
+static gboolean
+unpause (gpointer data)
+{
+        Delayed *d = data;
+
+        d->server->active--;
+        soup_server_unpause_message (d->server->server, d->msg);
+        g_object_unref (d->msg);
+        g_free (d);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+server_callback (SoupServer        *soup_server,
+                 SoupMessage       *msg,
+                 const char        *path,
+                 GHashTable        *query,
+                 SoupClientContext *client,
+                 gpointer           data)
+{
+        Server *server = data;
+        Delayed *d;
+
+        g_ptr_array_add (server->paths, g_strdup (path));
+
+        if (g_str_has_prefix (path, "/missing"))
+                soup_message_set_status (msg, SOUP_STATUS_NOT_FOUND);
+        else if (g_strcmp0 (soup_message_headers_get_one (msg->request_headers, "If-None-Match"), path) == 0) {
+                soup_message_set_status (msg, SOUP_STATUS_NOT_MODIFIED);
+                server->not_modified++;
+        }
+        else {
+                soup_message_set_status (msg, SOUP_STATUS_OK);
+                soup_message_headers_append (msg->response_headers, "ETag", path);
+                soup_message_set_response (msg, "image/png", SOUP_MEMORY_COPY, path, strlen (path));
+        }
+
+        server->active++;
+        server->max_active = MAX (server->max_active, server->active);
+
+        d = g_new0 (Delayed, 1);
+        d->server = server;
+        d->msg = g_object_ref (msg);
+        soup_server_pause_message (soup_server, msg);
+        g_timeout_add (server->delay, unpause, d);
+}
+
+static Server *
+server_new (void)
+{
+        Server *server;
+        g_autoptr(GError) error = NULL;
+        GSList *uris;
+        char *uri;
+
+        server = g_new0 (Server, 1);
+        server->paths = g_ptr_array_new_with_free_func (g_free);
+        server->delay = 10;
+        server->server = soup_server_new (NULL, NULL);
+        soup_server_add_handler (server->server, NULL, server_callback, server, NULL);
+        soup_server_listen_local (server->server, 0, 0, &error);
+        g_assert_no_error (error);
+
+        uris = soup_server_get_uris (server->server);
+        uri = soup_uri_to_string (uris->data, FALSE);
+        server->base_url = g_strndup (uri, strlen (uri) - 1);
+        g_free (uri);
+        g_slist_free_full (uris, (GDestroyNotify)soup_uri_free);
+
+        return server;
+}
+
+static void
+server_free (Server *server)
+{
+        soup_server_disconnect (server->server);
+        g_object_unref (server->server);
+        g_ptr_array_unref (server->paths);
+        g_free (server->base_url);
+        g_free (server);
+}
+
+typedef struct {
+        Server *server;
+        SoupSession *session;
+        GrCacheIndex *index;
+        GrImageFetcher *fetcher;
+        char *dir;
+        int outstanding;
+        int succeeded;
+        int failed;
+} Fixture;
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  data)
+{
+        g_autoptr(GError) error = NULL;
+        g_autofree char *path = NULL;
+
+        fixture->dir = g_dir_make_tmp ("image-fetcher-XXXXXX", &error);
+        g_assert_no_error (error);
+
+        path = g_build_filename (fixture->dir, "cache.index", NULL);
+        fixture->index = gr_cache_index_new (path);
+        fixture->server = server_new ();
+        fixture->session = soup_session_new ();
+        fixture->fetcher = gr_image_fetcher_new (fixture->session, fixture->index, GPOINTER_TO_UINT (data));
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  data)
+{
+        g_autoptr(GDir) dir = NULL;
+        const char *name;
+
+        gr_image_fetcher_free (fixture->fetcher);
+        gr_cache_index_free (fixture->index);
+        g_object_unref (fixture->session);
+        server_free (fixture->server);
+
+        dir = g_dir_open (fixture->dir, 0, NULL);
+        while ((name = g_dir_read_name (dir)) != NULL) {
+                g_autofree char *path = g_build_filename (fixture->dir, name, NULL);
+                g_remove (path);
+        }
+        g_rmdir (fixture->dir);
+        g_free (fixture->dir);
+}
+
+static void
+fetched (gboolean success,
+         gpointer data)
+{
+        Fixture *fixture = data;
+
+        if (success)
+                fixture->succeeded++;
+        else
+                fixture->failed++;
+
+        fixture->outstanding--;
+}
+
+static void
+fetch (Fixture         *fixture,
+       const char      *name,
+       GrFetchPriority  priority,
+       GCancellable    *cancellable)
+{
+        g_autofree char *url = NULL;
+        g_autofree char *path = NULL;
+
+        url = g_strconcat (fixture->server->base_url, "/", name, NULL);
+        path = g_build_filename (fixture->dir, name, NULL);
+
+        if (!g_cancellable_is_cancelled (cancellable))
+                fixture->outstanding++;
+
+        gr_image_fetcher_fetch (fixture->fetcher, url, path, priority, cancellable, fetched, fixture);
+}
+
+static void
+wait_for_fetches (Fixture *fixture)
+{
+        while (fixture->outstanding > 0 ||
+               gr_image_fetcher_get_in_flight (fixture->fetcher) > 0)
+                g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+test_fetcher_coalesce (Fixture       *fixture,
+                       gconstpointer  data)
+{
+        g_autofree char *path = NULL;
+        g_autofree char *contents = NULL;
+
+        fetch (fixture, "a", GR_FETCH_PRIORITY_LOW, NULL);
+        fetch (fixture, "a", GR_FETCH_PRIORITY_HIGH, NULL);
+        fetch (fixture, "a", GR_FETCH_PRIORITY_LOW, NULL);
+        wait_for_fetches (fixture);
+
+        g_assert_cmpint (fixture->server->paths->len, ==, 1);
+        g_assert_cmpint (fixture->succeeded, ==, 3);
+
+        path = g_build_filename (fixture->dir, "a", NULL);
+        g_file_get_contents (path, &contents, NULL, NULL);
+        g_assert_cmpstr (contents, ==, "/a");
+}
+
+static void
+test_fetcher_revalidate (Fixture       *fixture,
+                         gconstpointer  data)
+{
+        g_autofree char *path = NULL;
+        g_autoptr(GrCacheEntry) entry = NULL;
+
+        fetch (fixture, "a", GR_FETCH_PRIORITY_HIGH, NULL);
+        wait_for_fetches (fixture);
+
+        path = g_build_filename (fixture->dir, "a", NULL);
+        entry = gr_cache_index_lookup (fixture->index, path);
+        g_assert_nonnull (entry);
+        g_assert_cmpstr (entry->etag, ==, "/a");
+        g_assert_cmpuint (entry->size, ==, 2);
+        g_assert_false (entry->failed);
+
+        /* The second time around, the server says it hasn't changed */
+        fetch (fixture, "a", GR_FETCH_PRIORITY_HIGH, NULL);
+        wait_for_fetches (fixture);
+
+        g_assert_cmpint (fixture->server->paths->len, ==, 2);
+        g_assert_cmpint (fixture->server->not_modified, ==, 1);
+        g_assert_cmpint (fixture->succeeded, ==, 2);
+}
+
+static void
+test_fetcher_limit (Fixture       *fixture,
+                    gconstpointer  data)
+{
+        int i;
+
+        for (i = 0; i < 10; i++) {
+                g_autofree char *name = g_strdup_printf ("image%d", i);
+                fetch (fixture, name, GR_FETCH_PRIORITY_LOW, NULL);
+        }
+        wait_for_fetches (fixture);
+
+        g_assert_cmpint (fixture->server->paths->len, ==, 10);
+        g_assert_cmpint (fixture->succeeded, ==, 10);
+        g_assert_cmpint (fixture->server->max_active, <=, 2);
+}
+
+static void
+test_fetcher_priority (Fixture       *fixture,
+                       gconstpointer  data)
+{
+        g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+
+        fetch (fixture, "first", GR_FETCH_PRIORITY_LOW, NULL);
+        fetch (fixture, "image", GR_FETCH_PRIORITY_LOW, NULL);
+        fetch (fixture, "gone", GR_FETCH_PRIORITY_HIGH, cancellable);
+        fetch (fixture, "thumbnail", GR_FETCH_PRIORITY_HIGH, NULL);
+        fetch (fixture, "recent", GR_FETCH_PRIORITY_LOW, NULL);
+        g_cancellable_cancel (cancellable);
+        fixture->outstanding--;
+        wait_for_fetches (fixture);
+
+        /* The first request goes out right away, the others wait */
+        g_assert_cmpint (fixture->server->paths->len, ==, 4);
+        g_assert_cmpstr (g_ptr_array_index (fixture->server->paths, 0), ==, "/first");
+        g_assert_cmpstr (g_ptr_array_index (fixture->server->paths, 1), ==, "/thumbnail");
+        g_assert_cmpstr (g_ptr_array_index (fixture->server->paths, 2), ==, "/recent");
+        g_assert_cmpstr (g_ptr_array_index (fixture->server->paths, 3), ==, "/image");
+}
+
+static void
+test_fetcher_failure (Fixture       *fixture,
+                      gconstpointer  data)
+{
+        g_autofree char *path = NULL;
+        g_autoptr(GrCacheEntry) entry = NULL;
+
+        fetch (fixture, "missing", GR_FETCH_PRIORITY_HIGH, NULL);
+        wait_for_fetches (fixture);
+
+        g_assert_cmpint (fixture->failed, ==, 1);
+
+        path = g_build_filename (fixture->dir, "missing", NULL);
+        g_assert_false (g_file_test (path, G_FILE_TEST_EXISTS));
+
+        entry = gr_cache_index_lookup (fixture->index, path);
+        g_assert_nonnull (entry);
+        g_assert_true (entry->failed);
+}
+
+/* Measures how many images per second are downloaded when many
+ * tiles ask for them at once, half of them for the same images.
+ */
+static void
+test_fetcher_throughput (Fixture       *fixture,
+                         gconstpointer  data)
+{
+        int n = 200;
+        double elapsed;
+        int i;
+
+        fixture->server->delay = 5;
+
+        g_test_timer_start ();
+        for (i = 0; i < n; i++) {
+                g_autofree char *name = g_strdup_printf ("image%d", i % (n / 2));
+                fetch (fixture, name, i % 2 ? GR_FETCH_PRIORITY_LOW : GR_FETCH_PRIORITY_HIGH, NULL);
+        }
+        wait_for_fetches (fixture);
+        elapsed = g_test_timer_elapsed ();
+
+        g_assert_cmpint (fixture->server->paths->len, ==, n / 2);
+        g_test_maximized_result (n / elapsed, "%.0f images per second", n / elapsed);
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add ("/image-fetcher/coalesce", Fixture, GUINT_TO_POINTER (2),
+                    fixture_setup, test_fetcher_coalesce, fixture_teardown);
+        g_test_add ("/image-fetcher/revalidate", Fixture, GUINT_TO_POINTER (2),
+                    fixture_setup, test_fetcher_revalidate, fixture_teardown);
+        g_test_add ("/image-fetcher/limit", Fixture, GUINT_TO_POINTER (2),
+                    fixture_setup, test_fetcher_limit, fixture_teardown);
+        g_test_add ("/image-fetcher/priority", Fixture, GUINT_TO_POINTER (1),
+                    fixture_setup, test_fetcher_priority, fixture_teardown);
+        g_test_add ("/image-fetcher/failure", Fixture, GUINT_TO_POINTER (2),
+                    fixture_setup, test_fetcher_failure, fixture_teardown);
+
+        if (g_test_perf ())
+                g_test_add ("/image-fetcher/throughput", Fixture, GUINT_TO_POINTER (6),
+                            fixture_setup, test_fetcher_throughput, fixture_teardown);
+
+        return g_test_run ();
+}
@@ -0,0 +1,118 @@
+/* ingredient.c
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <locale.h>
+#include <glib.h>
+#include "gr-ingredients-list.h"
+#include "gr-ingredient.h"
+
+static char **
+load_names (void)
+{
+        g_autofree char *path = NULL;
+        g_autofree char *contents = NULL;
+        g_autoptr(GError) error = NULL;
+        GPtrArray *lines;
+        char **strv;
+        int i;
+
+        path = g_test_build_filename (G_TEST_DIST, "..", "data", "ingredients.list", NULL);
+        g_file_get_contents (path, &contents, NULL, &error);
+        g_assert_no_error (error);
+
+        strv = g_strsplit (contents, "\n", -1);
+        lines = g_ptr_array_new ();
+        for (i = 0; strv[i]; i++) {
+                if (strv[i][0] != '\0')
+                        g_ptr_array_add (lines, g_strdup (strv[i]));
+        }
+        g_ptr_array_add (lines, NULL);
+        g_strfreev (strv);
+
+        return (char **)g_ptr_array_free (lines, FALSE);
+}
+
+static void
+test_find (void)
+{
+        g_auto(GStrv) names = NULL;
+        int i;
+
+        names = load_names ();
+        for (i = 0; names[i]; i++) {
+                g_autofree char *upper = NULL;
+
+                upper = g_utf8_strup (names[i], -1);
+
+                g_assert_cmpstr (gr_ingredient_find (names[i]), ==, names[i]);
+                g_assert_cmpstr (gr_ingredient_find (upper), ==, names[i]);
+                g_assert_cmpstr (gr_ingredient_get_id (upper), ==, names[i]);
+                g_assert_nonnull (gr_ingredient_get_negation (names[i]));
+        }
+
+        g_assert_null (gr_ingredient_find ("Unobtainium"));
+        g_assert_null (gr_ingredient_get_id ("Unobtainium"));
+        g_assert_null (gr_ingredient_get_negation ("Unobtainium"));
+}
+
+/* Measures how many ingredient lines per second can be parsed,
+ * with one line for each of the known ingredients.
+ */
+static void
+test_throughput (void)
+{
+        g_auto(GStrv) names = NULL;
+        g_autoptr(GString) text = NULL;
+        int iterations = 200;
+        double elapsed;
+        int i, n;
+
+        names = load_names ();
+        n = g_strv_length (names);
+
+        text = g_string_new ("");
+        for (i = 0; names[i]; i++)
+                g_string_append_printf (text, "%d\tg\t%s\t\n", i % 7 + 1, names[i]);
+
+        g_test_timer_start ();
+        for (i = 0; i < iterations; i++) {
+                g_autoptr(GrIngredientsList) ingredients = NULL;
+
+                ingredients = gr_ingredients_list_new (text->str);
+        }
+        elapsed = g_test_timer_elapsed ();
+
+        g_test_maximized_result (n * iterations / elapsed, "%.0f lines per second", n * iterations / elapsed);
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_setenv ("LC_ALL", "en_US.UTF-8", TRUE);
+        setlocale (LC_ALL, "");
+
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/ingredient/find", test_find);
+
+        if (g_test_perf ())
+                g_test_add_func ("/ingredient/throughput", test_throughput);
+
+        return g_test_run ();
+}
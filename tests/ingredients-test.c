@@ -17,18 +17,12 @@
  */
 
 #include "config.h"
+#include <stdio.h>
 #include <locale.h>
 #include <glib.h>
 #include "gr-ingredients-list.h"
-#include "gr-ingredients-list.c"
-#include "gr-ingredient.h"
-#include "gr-ingredient.c"
-#include "gr-number.h"
-#include "gr-number.c"
+#include "gr-ingredients-list-private.h"
 #include "gr-unit.h"
-#include "gr-unit.c"
-#include "gr-utils.h"
-#include "gr-utils.c"
 
 static GString *string;
 
@@ -49,11 +43,11 @@ test_file (const char *filename)
         }
         else {
                 g_autoptr(GrIngredientsList) ingredients = NULL;
-                GList *l;
+                guint i;
 
                 ingredients = gr_ingredients_list_new (contents);
-                for (l = ingredients->ingredients; l; l = l->next) {
-                        Ingredient *ing = (Ingredient *)l->data;
+                for (i = 0; i < ingredients->ingredients->len; i++) {
+                        Ingredient *ing = &g_array_index (ingredients->ingredients, Ingredient, i);
                         g_string_append_printf (string, "AMOUNT %f\n", ing->amount);
                         g_string_append_printf (string, "UNIT %s\n", gr_unit_get_name (ing->unit));
                         g_string_append_printf (string, "NAME %s\n", ing->name);
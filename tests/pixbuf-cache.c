@@ -0,0 +1,135 @@
+/* pixbuf-cache.c
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <glib.h>
+#include "gr-pixbuf-cache.h"
+
+static GdkPixbuf *
+make_pixbuf (void)
+{
+        /* 10 rows of 40 bytes */
+        return gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 10, 10);
+}
+
+static gboolean
+cache_contains (GrPixbufCache *cache,
+                const char    *path,
+                GdkPixbuf     *pixbuf)
+{
+        g_autoptr(GdkPixbuf) found = NULL;
+
+        found = gr_pixbuf_cache_lookup (cache, path, 10, 10, 0);
+
+        return found != NULL && found == pixbuf;
+}
+
+static void
+test_pixbuf_cache_lru (void)
+{
+        g_autoptr(GrPixbufCache) cache = NULL;
+        g_autoptr(GdkPixbuf) a = make_pixbuf ();
+        g_autoptr(GdkPixbuf) b = make_pixbuf ();
+        g_autoptr(GdkPixbuf) c = make_pixbuf ();
+        guint hits, misses;
+        gsize size;
+
+        cache = gr_pixbuf_cache_new (1000);
+
+        gr_pixbuf_cache_insert (cache, "a", 10, 10, 0, a);
+        gr_pixbuf_cache_insert (cache, "b", 10, 10, 0, b);
+        g_assert_true (cache_contains (cache, "a", a));
+
+        /* b is now the least recently used */
+        gr_pixbuf_cache_insert (cache, "c", 10, 10, 0, c);
+        g_assert_true (cache_contains (cache, "a", a));
+        g_assert_false (cache_contains (cache, "b", b));
+        g_assert_true (cache_contains (cache, "c", c));
+
+        gr_pixbuf_cache_get_stats (cache, &hits, &misses, &size);
+        g_assert_cmpuint (hits, ==, 3);
+        g_assert_cmpuint (misses, ==, 1);
+        g_assert_cmpuint (size, ==, 800);
+
+        gr_pixbuf_cache_set_budget (cache, 500);
+        gr_pixbuf_cache_get_stats (cache, NULL, NULL, &size);
+        g_assert_cmpuint (size, ==, 400);
+        g_assert_true (cache_contains (cache, "c", c));
+}
+
+static void
+test_pixbuf_cache_keys (void)
+{
+        g_autoptr(GrPixbufCache) cache = NULL;
+        g_autoptr(GdkPixbuf) a = make_pixbuf ();
+        g_autoptr(GdkPixbuf) found = NULL;
+
+        cache = gr_pixbuf_cache_new (10000);
+
+        gr_pixbuf_cache_insert (cache, "a", 10, 10, 0, a);
+
+        found = gr_pixbuf_cache_lookup (cache, "a", 10, 10, GR_PIXBUF_CACHE_FIT);
+        g_assert_null (found);
+        found = gr_pixbuf_cache_lookup (cache, "a", 10, 10, GR_PIXBUF_CACHE_BLURRED);
+        g_assert_null (found);
+        found = gr_pixbuf_cache_lookup (cache, "a", 20, 10, 0);
+        g_assert_null (found);
+        found = gr_pixbuf_cache_lookup (cache, "a", 10, 10, 0);
+        g_assert_true (found == a);
+}
+
+static void
+test_pixbuf_cache_invalidate (void)
+{
+        g_autoptr(GrPixbufCache) cache = NULL;
+        g_autoptr(GdkPixbuf) a = make_pixbuf ();
+        g_autoptr(GdkPixbuf) b = make_pixbuf ();
+        g_autoptr(GdkPixbuf) found = NULL;
+        gsize size;
+
+        cache = gr_pixbuf_cache_new (10000);
+
+        gr_pixbuf_cache_insert (cache, "a", 10, 10, 0, a);
+        gr_pixbuf_cache_insert (cache, "a", 10, 10, GR_PIXBUF_CACHE_FIT, a);
+        gr_pixbuf_cache_insert (cache, "a", 10, 10, GR_PIXBUF_CACHE_BLURRED, a);
+        gr_pixbuf_cache_insert (cache, "b", 10, 10, 0, b);
+
+        gr_pixbuf_cache_invalidate (cache, "a");
+
+        found = gr_pixbuf_cache_lookup (cache, "a", 10, 10, GR_PIXBUF_CACHE_FIT);
+        g_assert_null (found);
+        found = gr_pixbuf_cache_lookup (cache, "a", 10, 10, GR_PIXBUF_CACHE_BLURRED);
+        g_assert_null (found);
+        g_assert_false (cache_contains (cache, "a", a));
+        g_assert_true (cache_contains (cache, "b", b));
+
+        gr_pixbuf_cache_get_stats (cache, NULL, NULL, &size);
+        g_assert_cmpuint (size, ==, 400);
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/pixbuf-cache/lru", test_pixbuf_cache_lru);
+        g_test_add_func ("/pixbuf-cache/keys", test_pixbuf_cache_keys);
+        g_test_add_func ("/pixbuf-cache/invalidate", test_pixbuf_cache_invalidate);
+
+        return g_test_run ();
+}
@@ -0,0 +1,145 @@
+/* recipe-index.c
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <glib.h>
+#include "gr-recipe-index.h"
+
+static const char *cake[] = { "apple cake", "a simple cake with apples", NULL };
+static const char *pie[] = { "cherry pie", "sour cherries in a crust", NULL };
+static const char *salad[] = { "apple salad", NULL };
+
+static GrRecipeIndex *
+create_index (void)
+{
+        GrRecipeIndex *index;
+
+        index = gr_recipe_index_new ();
+        gr_recipe_index_add (index, (gpointer)cake, cake);
+        gr_recipe_index_add (index, (gpointer)pie, pie);
+        gr_recipe_index_add (index, (gpointer)salad, salad);
+
+        return index;
+}
+
+static gboolean
+lookup_contains (GPtrArray  *result,
+                 const char **item)
+{
+        guint i;
+
+        for (i = 0; i < result->len; i++) {
+                if (g_ptr_array_index (result, i) == (gpointer)item)
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
+static void
+test_index_lookup (void)
+{
+        g_autoptr(GrRecipeIndex) index = NULL;
+        g_autoptr(GPtrArray) result = NULL;
+        const char *apple[] = { "apple", NULL };
+        const char *apple_cake[] = { "apple", "cake", NULL };
+        const char *crust[] = { "na:pie", "rust", NULL };
+        const char *none[] = { "banana", NULL };
+
+        index = create_index ();
+
+        result = gr_recipe_index_lookup (index, apple);
+        g_assert_cmpint (result->len, ==, 2);
+        g_assert_true (lookup_contains (result, cake));
+        g_assert_true (lookup_contains (result, salad));
+        g_clear_pointer (&result, g_ptr_array_unref);
+
+        result = gr_recipe_index_lookup (index, apple_cake);
+        g_assert_cmpint (result->len, ==, 1);
+        g_assert_true (lookup_contains (result, cake));
+        g_clear_pointer (&result, g_ptr_array_unref);
+
+        result = gr_recipe_index_lookup (index, crust);
+        g_assert_cmpint (result->len, ==, 1);
+        g_assert_true (lookup_contains (result, pie));
+        g_clear_pointer (&result, g_ptr_array_unref);
+
+        result = gr_recipe_index_lookup (index, none);
+        g_assert_cmpint (result->len, ==, 0);
+}
+
+static void
+test_index_unconstrained (void)
+{
+        g_autoptr(GrRecipeIndex) index = NULL;
+        const char *short_term[] = { "ap", NULL };
+        const char *qualified[] = { "by:someone", "s+:2", NULL };
+
+        index = create_index ();
+
+        g_assert_null (gr_recipe_index_lookup (index, short_term));
+        g_assert_null (gr_recipe_index_lookup (index, qualified));
+}
+
+static void
+test_index_update (void)
+{
+        g_autoptr(GrRecipeIndex) index = NULL;
+        g_autoptr(GPtrArray) result = NULL;
+        const char *apple[] = { "apple", NULL };
+        const char *cherry[] = { "cherry", NULL };
+        const char *changed[] = { "cherry salad", NULL };
+
+        index = create_index ();
+
+        gr_recipe_index_remove (index, (gpointer)cake);
+        result = gr_recipe_index_lookup (index, apple);
+        g_assert_cmpint (result->len, ==, 1);
+        g_assert_true (lookup_contains (result, salad));
+        g_clear_pointer (&result, g_ptr_array_unref);
+
+        /* Re-adding an item replaces its texts */
+        gr_recipe_index_add (index, (gpointer)salad, changed);
+        result = gr_recipe_index_lookup (index, apple);
+        g_assert_cmpint (result->len, ==, 0);
+        g_clear_pointer (&result, g_ptr_array_unref);
+
+        result = gr_recipe_index_lookup (index, cherry);
+        g_assert_cmpint (result->len, ==, 2);
+        g_assert_true (lookup_contains (result, pie));
+        g_assert_true (lookup_contains (result, salad));
+        g_clear_pointer (&result, g_ptr_array_unref);
+
+        /* Freed ordinals get reused */
+        gr_recipe_index_add (index, (gpointer)cake, cake);
+        result = gr_recipe_index_lookup (index, apple);
+        g_assert_cmpint (result->len, ==, 1);
+        g_assert_true (lookup_contains (result, cake));
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/index/lookup", test_index_lookup);
+        g_test_add_func ("/index/unconstrained", test_index_unconstrained);
+        g_test_add_func ("/index/update", test_index_update);
+
+        return g_test_run ();
+}
@@ -0,0 +1,370 @@
+/* recipe-journal.c
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "gr-recipe-journal.h"
+
+static char *
+make_dir (void)
+{
+        g_autoptr(GError) error = NULL;
+        char *dir;
+
+        dir = g_dir_make_tmp ("recipe-journal-XXXXXX", &error);
+        g_assert_no_error (error);
+
+        return dir;
+}
+
+static void
+remove_dir (const char *dir)
+{
+        g_autoptr(GDir) d = NULL;
+        const char *name;
+
+        d = g_dir_open (dir, 0, NULL);
+        while ((name = g_dir_read_name (d)) != NULL) {
+                g_autofree char *path = g_build_filename (dir, name, NULL);
+                g_remove (path);
+        }
+        g_rmdir (dir);
+}
+
+/* Entries are named like the store names them. Resetting the count
+ * gives the same names again, as after a restart.
+ */
+static int n_entries = 0;
+
+/* Adds an entry that sets the name of a recipe, or removes it if
+ * name is NULL, to entries and to the expected keyfile.
+ */
+static void
+add_entry (GString    *entries,
+           GKeyFile   *expected,
+           const char *id,
+           const char *name)
+{
+        g_autoptr(GKeyFile) entry = NULL;
+        g_autofree char *group = NULL;
+
+        entry = g_key_file_new ();
+        group = g_strdup_printf ("Entry %d", ++n_entries);
+
+        g_key_file_set_string (entry, group, "Id", id);
+        g_key_file_remove_group (expected, id, NULL);
+        if (name) {
+                g_key_file_set_string (entry, group, "Name", name);
+                g_key_file_set_string (entry, group, "Cuisine", "italian");
+                g_key_file_set_string (expected, id, "Name", name);
+                g_key_file_set_string (expected, id, "Cuisine", "italian");
+        }
+        else {
+                g_key_file_set_boolean (entry, group, "Removed", TRUE);
+        }
+
+        gr_recipe_journal_add_entry (entries, entry);
+}
+
+static void
+append_entries (const char *path,
+                GString    *entries)
+{
+        g_autoptr(GError) error = NULL;
+
+        gr_recipe_journal_append (path, entries->str, entries->len, &error);
+        g_assert_no_error (error);
+
+        g_string_truncate (entries, 0);
+}
+
+static GKeyFile *
+create_db (void)
+{
+        GKeyFile *db;
+
+        db = g_key_file_new ();
+        g_key_file_set_integer (db, "Metadata", "Version", 1);
+        g_key_file_set_string (db, "a", "Name", "Apple pie");
+        g_key_file_set_string (db, "a", "Cuisine", "american");
+        g_key_file_set_string (db, "b", "Name", "Borscht");
+        g_key_file_set_string (db, "b", "Cuisine", "russian");
+
+        return db;
+}
+
+/* The order of groups differs after replaying, so compare them one by one */
+static void
+assert_keyfiles_equal (GKeyFile *keyfile,
+                       GKeyFile *expected)
+{
+        g_auto(GStrv) groups = NULL;
+        g_auto(GStrv) expected_groups = NULL;
+        int i, j;
+
+        groups = g_key_file_get_groups (keyfile, NULL);
+        expected_groups = g_key_file_get_groups (expected, NULL);
+        g_assert_cmpint (g_strv_length (groups), ==, g_strv_length (expected_groups));
+
+        for (i = 0; expected_groups[i]; i++) {
+                g_auto(GStrv) keys = NULL;
+                g_auto(GStrv) expected_keys = NULL;
+
+                g_assert_true (g_key_file_has_group (keyfile, expected_groups[i]));
+
+                keys = g_key_file_get_keys (keyfile, expected_groups[i], NULL, NULL);
+                expected_keys = g_key_file_get_keys (expected, expected_groups[i], NULL, NULL);
+                g_assert_cmpint (g_strv_length (keys), ==, g_strv_length (expected_keys));
+
+                for (j = 0; expected_keys[j]; j++) {
+                        g_autofree char *value = NULL;
+                        g_autofree char *expected_value = NULL;
+
+                        value = g_key_file_get_value (keyfile, expected_groups[i], expected_keys[j], NULL);
+                        expected_value = g_key_file_get_value (expected, expected_groups[i], expected_keys[j], NULL);
+                        g_assert_cmpstr (value, ==, expected_value);
+                }
+        }
+}
+
+static void
+test_journal_replay (void)
+{
+        g_autofree char *dir = NULL;
+        g_autofree char *path = NULL;
+        g_autoptr(GKeyFile) db = NULL;
+        g_autoptr(GKeyFile) expected = NULL;
+        g_autoptr(GString) entries = NULL;
+        g_autoptr(GError) error = NULL;
+        g_autofree char *name = NULL;
+
+        dir = make_dir ();
+        path = g_build_filename (dir, "recipes.journal", NULL);
+        db = create_db ();
+        expected = create_db ();
+        entries = g_string_new ("");
+
+        /* Two flushes, with later entries for the same recipe winning */
+        add_entry (entries, expected, "a", "Apple crumble");
+        add_entry (entries, expected, "c", "Carbonara");
+        append_entries (path, entries);
+
+        add_entry (entries, expected, "b", NULL);
+        add_entry (entries, expected, "a", "Apple strudel");
+        append_entries (path, entries);
+
+        gr_recipe_journal_apply (db, path, &error);
+        g_assert_no_error (error);
+
+        assert_keyfiles_equal (db, expected);
+        g_assert_false (g_key_file_has_group (db, "b"));
+
+        name = g_key_file_get_string (db, "a", "Name", NULL);
+        g_assert_cmpstr (name, ==, "Apple strudel");
+
+        remove_dir (dir);
+}
+
+static void
+test_journal_torn (void)
+{
+        g_autofree char *dir = NULL;
+        g_autofree char *path = NULL;
+        g_autoptr(GKeyFile) db = NULL;
+        g_autoptr(GKeyFile) expected = NULL;
+        g_autoptr(GKeyFile) unchanged = NULL;
+        g_autoptr(GString) entries = NULL;
+        g_autoptr(GError) error = NULL;
+        g_autofree char *name = NULL;
+        const char *torn = "[Entry 99]\nId=b\nName=Bors";
+
+        dir = make_dir ();
+        path = g_build_filename (dir, "recipes.journal", NULL);
+        entries = g_string_new ("");
+
+        /* A journal with nothing but a torn entry changes nothing */
+        g_file_set_contents (path, torn, -1, &error);
+        g_assert_no_error (error);
+
+        db = create_db ();
+        unchanged = create_db ();
+        gr_recipe_journal_apply (db, path, &error);
+        g_assert_no_error (error);
+        assert_keyfiles_equal (db, unchanged);
+        g_remove (path);
+
+        /* A complete entry followed by a torn one, as left by a crash */
+        g_clear_pointer (&db, g_key_file_unref);
+        db = create_db ();
+        expected = create_db ();
+
+        add_entry (entries, expected, "c", "Carbonara");
+        g_string_append (entries, torn);
+        append_entries (path, entries);
+
+        gr_recipe_journal_apply (db, path, &error);
+        g_assert_no_error (error);
+
+        assert_keyfiles_equal (db, expected);
+
+        name = g_key_file_get_string (db, "b", "Name", NULL);
+        g_assert_cmpstr (name, ==, "Borscht");
+
+        remove_dir (dir);
+}
+
+static void
+test_journal_compact (void)
+{
+        g_autofree char *dir = NULL;
+        g_autofree char *db_path = NULL;
+        g_autofree char *journal = NULL;
+        g_autofree char *compacting = NULL;
+        g_autoptr(GKeyFile) db = NULL;
+        g_autoptr(GKeyFile) expected = NULL;
+        g_autoptr(GKeyFile) compacted = NULL;
+        g_autoptr(GString) entries = NULL;
+        g_autoptr(GError) error = NULL;
+        const char *journals[3];
+
+        dir = make_dir ();
+        db_path = g_build_filename (dir, "recipes.db", NULL);
+        journal = g_build_filename (dir, "recipes.journal", NULL);
+        compacting = g_build_filename (dir, "recipes.journal.compacting", NULL);
+        entries = g_string_new ("");
+
+        /* The expected keyfile is what saving the whole db used to write */
+        db = create_db ();
+        expected = create_db ();
+        g_key_file_save_to_file (db, db_path, &error);
+        g_assert_no_error (error);
+
+        /* As left at startup: a journal being compacted, and a newer one */
+        add_entry (entries, expected, "a", "Apple crumble");
+        add_entry (entries, expected, "b", NULL);
+        append_entries (compacting, entries);
+
+        add_entry (entries, expected, "b", "Borscht");
+        add_entry (entries, expected, "d", "Dal");
+        append_entries (journal, entries);
+
+        journals[0] = compacting;
+        journals[1] = journal;
+        journals[2] = NULL;
+
+        gr_recipe_journal_compact (dir, journals, &error);
+        g_assert_no_error (error);
+
+        g_assert_false (g_file_test (journal, G_FILE_TEST_EXISTS));
+        g_assert_false (g_file_test (compacting, G_FILE_TEST_EXISTS));
+
+        compacted = g_key_file_new ();
+        g_key_file_load_from_file (compacted, db_path, G_KEY_FILE_NONE, &error);
+        g_assert_no_error (error);
+
+        assert_keyfiles_equal (compacted, expected);
+
+        /* Compacting again without journals leaves the db alone */
+        gr_recipe_journal_compact (dir, journals, &error);
+        g_assert_no_error (error);
+
+        g_clear_pointer (&compacted, g_key_file_unref);
+        compacted = g_key_file_new ();
+        g_key_file_load_from_file (compacted, db_path, G_KEY_FILE_NONE, &error);
+        g_assert_no_error (error);
+
+        assert_keyfiles_equal (compacted, expected);
+
+        remove_dir (dir);
+}
+
+static void
+test_journal_leftover (void)
+{
+        g_autofree char *dir = NULL;
+        g_autofree char *db_path = NULL;
+        g_autofree char *journal = NULL;
+        g_autofree char *compacting = NULL;
+        g_autoptr(GKeyFile) expected = NULL;
+        g_autoptr(GKeyFile) compacted = NULL;
+        g_autoptr(GString) entries = NULL;
+        g_autoptr(GError) error = NULL;
+        g_autofree char *name = NULL;
+        const char *journals[2];
+
+        dir = make_dir ();
+        db_path = g_build_filename (dir, "recipes.db", NULL);
+        journal = g_build_filename (dir, "recipes.journal", NULL);
+        compacting = g_build_filename (dir, "recipes.journal.compacting", NULL);
+        entries = g_string_new ("");
+
+        expected = create_db ();
+        g_key_file_save_to_file (expected, db_path, &error);
+        g_assert_no_error (error);
+
+        /* A journal left behind by a failed compaction, ending in a torn entry */
+        n_entries = 0;
+        add_entry (entries, expected, "a", NULL);
+        add_entry (entries, expected, "b", "Borscht with dill");
+        g_string_append (entries, "[Entry 3]\nId=b\nName=Bors");
+        append_entries (compacting, entries);
+
+        /* Entries from a later run reuse the same names */
+        n_entries = 0;
+        add_entry (entries, expected, "a", "Apple crumble");
+        add_entry (entries, expected, "c", "Carbonara");
+        append_entries (journal, entries);
+
+        gr_recipe_journal_concat (compacting, journal, &error);
+        g_assert_no_error (error);
+
+        g_assert_false (g_file_test (journal, G_FILE_TEST_EXISTS));
+
+        journals[0] = compacting;
+        journals[1] = NULL;
+
+        gr_recipe_journal_compact (dir, journals, &error);
+        g_assert_no_error (error);
+
+        compacted = g_key_file_new ();
+        g_key_file_load_from_file (compacted, db_path, G_KEY_FILE_NONE, &error);
+        g_assert_no_error (error);
+
+        assert_keyfiles_equal (compacted, expected);
+
+        /* The removal of a doesn't leak into the later entry of the same name */
+        name = g_key_file_get_string (compacted, "a", "Name", NULL);
+        g_assert_cmpstr (name, ==, "Apple crumble");
+
+        remove_dir (dir);
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/journal/replay", test_journal_replay);
+        g_test_add_func ("/journal/torn", test_journal_torn);
+        g_test_add_func ("/journal/compact", test_journal_compact);
+        g_test_add_func ("/journal/leftover", test_journal_leftover);
+
+        return g_test_run ();
+}
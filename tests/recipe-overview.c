@@ -0,0 +1,142 @@
+/* recipe-overview.c
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "config.h"
+#include <glib.h>
+#include "gr-recipe-overview.h"
+
+static char cake[] = "cake";
+static char pie[] = "pie";
+static char salad[] = "salad";
+
+static const GrOverviewFields cake_fields = { "cake", "alice", "french", "winter", GR_DIET_VEGETARIAN, FALSE };
+static const GrOverviewFields pie_fields = { "pie", "bob", "french", "summer", GR_DIET_VEGAN | GR_DIET_VEGETARIAN, TRUE };
+static const GrOverviewFields salad_fields = { "salad", "alice", "greek", NULL, 0, FALSE };
+
+static GrRecipeOverview *
+create_overview (void)
+{
+        GrRecipeOverview *overview;
+
+        overview = gr_recipe_overview_new ();
+        gr_recipe_overview_add (overview, cake, &cake_fields);
+        gr_recipe_overview_add (overview, pie, &pie_fields);
+        gr_recipe_overview_add (overview, salad, &salad_fields);
+
+        return overview;
+}
+
+static void
+test_overview_counts (void)
+{
+        g_autoptr(GrRecipeOverview) overview = NULL;
+        g_autofree char **contributors = NULL;
+        guint length;
+
+        overview = create_overview ();
+
+        g_assert_cmpuint (gr_recipe_overview_get_chef_count (overview, "alice"), ==, 2);
+        g_assert_cmpuint (gr_recipe_overview_get_chef_count (overview, "bob"), ==, 1);
+        g_assert_cmpuint (gr_recipe_overview_get_chef_count (overview, "carol"), ==, 0);
+        g_assert_cmpuint (gr_recipe_overview_get_cuisine_count (overview, "french"), ==, 2);
+        g_assert_cmpuint (gr_recipe_overview_get_season_count (overview, "summer"), ==, 1);
+        g_assert_true (gr_recipe_overview_has_diet (overview, GR_DIET_VEGAN));
+        g_assert_false (gr_recipe_overview_has_diet (overview, GR_DIET_NUT_FREE));
+
+        contributors = gr_recipe_overview_get_contributors (overview, &length);
+        g_assert_cmpuint (length, ==, 1);
+        g_assert_cmpstr (contributors[0], ==, "bob");
+}
+
+static void
+test_overview_changes (void)
+{
+        g_autoptr(GrRecipeOverview) overview = NULL;
+        GrOverviewFields fields;
+
+        overview = create_overview ();
+
+        /* Updating without changes to the counted fields changes nothing */
+        g_assert_cmpuint (gr_recipe_overview_add (overview, cake, &cake_fields), ==, 0);
+
+        /* Moving between existing keys changes nothing either */
+        fields = cake_fields;
+        fields.cuisine = "greek";
+        g_assert_cmpuint (gr_recipe_overview_add (overview, cake, &fields), ==, 0);
+        g_assert_cmpuint (gr_recipe_overview_get_cuisine_count (overview, "french"), ==, 1);
+
+        fields.season = "spring";
+        g_assert_cmpuint (gr_recipe_overview_add (overview, cake, &fields), ==, GR_OVERVIEW_SEASONS);
+
+        fields.diets = GR_DIET_NUT_FREE;
+        g_assert_cmpuint (gr_recipe_overview_add (overview, cake, &fields), ==, GR_OVERVIEW_DIETS);
+        g_assert_true (gr_recipe_overview_has_diet (overview, GR_DIET_NUT_FREE));
+
+        g_assert_cmpuint (gr_recipe_overview_remove (overview, pie), ==,
+                          GR_OVERVIEW_CHEFS | GR_OVERVIEW_CONTRIBUTORS | GR_OVERVIEW_CUISINES |
+                          GR_OVERVIEW_SEASONS | GR_OVERVIEW_DIETS);
+        g_assert_cmpuint (gr_recipe_overview_remove (overview, pie), ==, 0);
+        g_assert_false (gr_recipe_overview_has_diet (overview, GR_DIET_VEGAN));
+}
+
+static void
+test_overview_featured (void)
+{
+        g_autoptr(GrRecipeOverview) overview = NULL;
+        g_autoptr(GPtrArray) items = NULL;
+        const char *todays[] = { "cake", "bread", NULL };
+        const char *picks[] = { "salad", NULL };
+        GrOverviewFields fields;
+
+        overview = create_overview ();
+        gr_recipe_overview_set_featured (overview, todays, picks);
+
+        items = gr_recipe_overview_get_todays (overview);
+        g_assert_cmpuint (items->len, ==, 1);
+        g_assert_true (g_ptr_array_index (items, 0) == cake);
+        g_clear_pointer (&items, g_ptr_array_unref);
+
+        /* Changes to featured items are reported */
+        g_assert_cmpuint (gr_recipe_overview_add (overview, cake, &cake_fields), ==, GR_OVERVIEW_TODAYS);
+        g_assert_cmpuint (gr_recipe_overview_add (overview, pie, &pie_fields), ==, 0);
+
+        fields = salad_fields;
+        fields.id = "salad2";
+        g_assert_cmpuint (gr_recipe_overview_add (overview, salad, &fields), ==, GR_OVERVIEW_PICKS);
+        items = gr_recipe_overview_get_picks (overview);
+        g_assert_cmpuint (items->len, ==, 0);
+        g_clear_pointer (&items, g_ptr_array_unref);
+
+        g_assert_cmpuint (gr_recipe_overview_remove (overview, cake), ==,
+                          GR_OVERVIEW_SEASONS | GR_OVERVIEW_DIETS | GR_OVERVIEW_TODAYS);
+        items = gr_recipe_overview_get_todays (overview);
+        g_assert_cmpuint (items->len, ==, 0);
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/overview/counts", test_overview_counts);
+        g_test_add_func ("/overview/changes", test_overview_changes);
+        g_test_add_func ("/overview/featured", test_overview_featured);
+
+        return g_test_run ();
+}
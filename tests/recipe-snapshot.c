@@ -0,0 +1,324 @@
+/* recipe-snapshot.c
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <locale.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "gr-recipe-snapshot.h"
+
+static const char *keys[] = {
+        "Name", "Author", "Description", "Cuisine", "Season", "Category",
+        "PrepTime", "CookTime", "Ingredients", "Instructions", "Notes",
+        "Serves", "Yield", "Spiciness", "Diets", "DefaultImage", "Images",
+        "Created", "Modified", NULL
+};
+
+typedef struct {
+        char *dir;
+        char *keyfile_path;
+        char *snapshot_path;
+} Fixture;
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  data)
+{
+        g_autoptr(GError) error = NULL;
+
+        fixture->dir = g_dir_make_tmp ("recipe-snapshot-XXXXXX", &error);
+        g_assert_no_error (error);
+
+        fixture->keyfile_path = g_build_filename (fixture->dir, "recipes.db", NULL);
+        fixture->snapshot_path = g_build_filename (fixture->dir, "recipes.snapshot", NULL);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  data)
+{
+        g_unlink (fixture->keyfile_path);
+        g_unlink (fixture->snapshot_path);
+        g_rmdir (fixture->dir);
+
+        g_free (fixture->keyfile_path);
+        g_free (fixture->snapshot_path);
+        g_free (fixture->dir);
+}
+
+static void
+copy_recipe_db (Fixture *fixture)
+{
+        g_autofree char *source = NULL;
+        g_autofree char *contents = NULL;
+        gsize length;
+        g_autoptr(GError) error = NULL;
+
+        source = g_test_build_filename (G_TEST_DIST, "..", "data", "recipes.db", NULL);
+        g_file_get_contents (source, &contents, &length, &error);
+        g_assert_no_error (error);
+        g_file_set_contents (fixture->keyfile_path, contents, length, &error);
+        g_assert_no_error (error);
+}
+
+static void
+test_snapshot_compile (Fixture       *fixture,
+                       gconstpointer  data)
+{
+        g_autoptr(GKeyFile) keyfile = NULL;
+        g_autoptr(GVariant) records = NULL;
+        g_autoptr(GError) error = NULL;
+        g_auto(GStrv) groups = NULL;
+        gsize length;
+        int i, n;
+
+        copy_recipe_db (fixture);
+
+        keyfile = g_key_file_new ();
+        g_key_file_load_from_file (keyfile, fixture->keyfile_path, G_KEY_FILE_NONE, &error);
+        g_assert_no_error (error);
+        groups = g_key_file_get_groups (keyfile, &length);
+
+        records = gr_recipe_snapshot_load (fixture->keyfile_path, fixture->snapshot_path, &error);
+        g_assert_no_error (error);
+        g_assert_nonnull (records);
+        g_assert_true (g_file_test (fixture->snapshot_path, G_FILE_TEST_EXISTS));
+
+        for (i = 0, n = 0; i < length; i++) {
+                g_autoptr(GVariant) record = NULL;
+                g_autofree char *name = NULL;
+                g_autofree char *instructions = NULL;
+
+                if (strcmp (groups[i], "Metadata") == 0)
+                        continue;
+
+                record = g_variant_get_child_value (records, n++);
+                name = g_key_file_get_string (keyfile, groups[i], "Name", NULL);
+                instructions = g_key_file_get_string (keyfile, groups[i], "Instructions", NULL);
+
+                g_assert_cmpstr (gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_ID), ==, groups[i]);
+                g_assert_cmpstr (gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_NAME), ==, name);
+                g_assert_cmpstr (gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_INSTRUCTIONS), ==, instructions);
+        }
+
+        g_assert_cmpint (g_variant_n_children (records), ==, n);
+
+        /* The second time around, the mmapped snapshot is used */
+        g_clear_pointer (&records, g_variant_unref);
+        records = gr_recipe_snapshot_load (fixture->keyfile_path, fixture->snapshot_path, &error);
+        g_assert_no_error (error);
+        g_assert_cmpint (g_variant_n_children (records), ==, n);
+}
+
+static void
+test_snapshot_regenerate (Fixture       *fixture,
+                          gconstpointer  data)
+{
+        g_autoptr(GVariant) records = NULL;
+        g_autoptr(GError) error = NULL;
+        g_autoptr(GVariant) record = NULL;
+        gint64 time;
+
+        g_file_set_contents (fixture->keyfile_path,
+                             "[R_a_by_b]\n"
+                             "Name=A\n"
+                             "Author=b\n",
+                             -1, &error);
+        g_assert_no_error (error);
+
+        records = gr_recipe_snapshot_load (fixture->keyfile_path, fixture->snapshot_path, &error);
+        g_assert_no_error (error);
+        g_assert_cmpint (g_variant_n_children (records), ==, 1);
+
+        record = g_variant_get_child_value (records, 0);
+        g_assert_cmpstr (gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_NAME), ==, "A");
+        g_assert_null (gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_CUISINE));
+        g_assert_null (gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_YIELD_UNIT));
+        g_assert_false (gr_recipe_snapshot_get_time (record, GR_SNAPSHOT_CTIME, &time));
+        g_clear_pointer (&record, g_variant_unref);
+        g_clear_pointer (&records, g_variant_unref);
+
+        g_file_set_contents (fixture->keyfile_path,
+                             "[R_a_by_b]\n"
+                             "Name=A\n"
+                             "Author=b\n"
+                             "Created=2017-01-02 03:04:05\n"
+                             "\n"
+                             "[R_c_by_d]\n"
+                             "Name=C\n"
+                             "Author=d\n"
+                             "Yield=3 loaves\n",
+                             -1, &error);
+        g_assert_no_error (error);
+
+        records = gr_recipe_snapshot_load (fixture->keyfile_path, fixture->snapshot_path, &error);
+        g_assert_no_error (error);
+        g_assert_cmpint (g_variant_n_children (records), ==, 2);
+
+        record = g_variant_get_child_value (records, 0);
+        g_assert_true (gr_recipe_snapshot_get_time (record, GR_SNAPSHOT_CTIME, &time));
+        g_assert_cmpint (time, ==, 1483326245);
+        g_clear_pointer (&record, g_variant_unref);
+
+        record = g_variant_get_child_value (records, 1);
+        g_assert_cmpstr (gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_YIELD_UNIT), ==, "loaves");
+        g_assert_cmpfloat (gr_recipe_snapshot_get_double (record, GR_SNAPSHOT_YIELD), ==, 3.0);
+}
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+static void
+write_keyfile_at (Fixture    *fixture,
+                  const char *contents,
+                  long        nsec)
+{
+        g_autoptr(GError) error = NULL;
+        struct timespec times[2];
+
+        g_file_set_contents (fixture->keyfile_path, contents, -1, &error);
+        g_assert_no_error (error);
+
+        times[0].tv_sec = times[1].tv_sec = 1500000000;
+        times[0].tv_nsec = times[1].tv_nsec = nsec;
+        g_assert_cmpint (utimensat (AT_FDCWD, fixture->keyfile_path, times, 0), ==, 0);
+}
+
+/* An edit within the same second that keeps the size is still noticed */
+static void
+test_snapshot_same_second (Fixture       *fixture,
+                           gconstpointer  data)
+{
+        g_autoptr(GVariant) records = NULL;
+        g_autoptr(GVariant) record = NULL;
+        g_autoptr(GError) error = NULL;
+
+        write_keyfile_at (fixture, "[R_a_by_b]\nName=A\nAuthor=b\n", 100);
+
+        records = gr_recipe_snapshot_load (fixture->keyfile_path, fixture->snapshot_path, &error);
+        g_assert_no_error (error);
+        g_clear_pointer (&records, g_variant_unref);
+
+        write_keyfile_at (fixture, "[R_a_by_b]\nName=B\nAuthor=b\n", 200);
+
+        records = gr_recipe_snapshot_load (fixture->keyfile_path, fixture->snapshot_path, &error);
+        g_assert_no_error (error);
+
+        record = g_variant_get_child_value (records, 0);
+        g_assert_cmpstr (gr_recipe_snapshot_get_string (record, GR_SNAPSHOT_NAME), ==, "B");
+}
+#endif
+
+static void
+test_snapshot_missing (Fixture       *fixture,
+                       gconstpointer  data)
+{
+        g_autoptr(GVariant) records = NULL;
+        g_autoptr(GError) error = NULL;
+
+        records = gr_recipe_snapshot_load (fixture->keyfile_path, fixture->snapshot_path, &error);
+        g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+        g_assert_null (records);
+}
+
+/* Compares the time it takes to get at the data of all recipes,
+ * by parsing the keyfile the way load_recipes() used to, or by
+ * mapping the snapshot.
+ */
+static void
+test_snapshot_startup (Fixture       *fixture,
+                       gconstpointer  data)
+{
+        g_autoptr(GVariant) records = NULL;
+        g_autoptr(GError) error = NULL;
+        double keyfile_time, snapshot_time;
+        int iterations = 20;
+        int i, j, k;
+        gsize n;
+
+        copy_recipe_db (fixture);
+
+        records = gr_recipe_snapshot_load (fixture->keyfile_path, fixture->snapshot_path, &error);
+        g_assert_no_error (error);
+        g_clear_pointer (&records, g_variant_unref);
+
+        g_test_timer_start ();
+        for (i = 0; i < iterations; i++) {
+                g_autoptr(GKeyFile) keyfile = NULL;
+                g_auto(GStrv) groups = NULL;
+                gsize length;
+
+                keyfile = g_key_file_new ();
+                g_key_file_load_from_file (keyfile, fixture->keyfile_path, G_KEY_FILE_NONE, &error);
+                g_assert_no_error (error);
+
+                groups = g_key_file_get_groups (keyfile, &length);
+                for (j = 0; j < length; j++) {
+                        for (k = 0; keys[k]; k++)
+                                g_free (g_key_file_get_string (keyfile, groups[j], keys[k], NULL));
+                }
+        }
+        keyfile_time = g_test_timer_elapsed ();
+
+        g_test_timer_start ();
+        for (i = 0; i < iterations; i++) {
+                records = gr_recipe_snapshot_load (fixture->keyfile_path, fixture->snapshot_path, &error);
+                g_assert_no_error (error);
+
+                n = g_variant_n_children (records);
+                for (j = 0; j < n; j++) {
+                        g_autoptr(GVariant) record = NULL;
+
+                        /* Everything but the lazily loaded instructions */
+                        record = g_variant_get_child_value (records, j);
+                        for (k = GR_SNAPSHOT_ID; k <= GR_SNAPSHOT_NOTES; k++) {
+                                if (k != GR_SNAPSHOT_INSTRUCTIONS)
+                                        gr_recipe_snapshot_get_string (record, k);
+                        }
+                }
+
+                g_clear_pointer (&records, g_variant_unref);
+        }
+        snapshot_time = g_test_timer_elapsed ();
+
+        g_test_message ("keyfile: %.3f ms per load", keyfile_time * 1000 / iterations);
+        g_test_message ("snapshot: %.3f ms per load", snapshot_time * 1000 / iterations);
+        g_test_minimized_result (snapshot_time / iterations, "snapshot load time: %.6f s", snapshot_time / iterations);
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_setenv ("LC_ALL", "en_US.UTF-8", TRUE);
+        setlocale (LC_ALL, "");
+
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add ("/snapshot/compile", Fixture, NULL, fixture_setup, test_snapshot_compile, fixture_teardown);
+        g_test_add ("/snapshot/regenerate", Fixture, NULL, fixture_setup, test_snapshot_regenerate, fixture_teardown);
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+        g_test_add ("/snapshot/same-second", Fixture, NULL, fixture_setup, test_snapshot_same_second, fixture_teardown);
+#endif
+        g_test_add ("/snapshot/missing", Fixture, NULL, fixture_setup, test_snapshot_missing, fixture_teardown);
+
+        if (g_test_perf ())
+                g_test_add ("/snapshot/startup", Fixture, NULL, fixture_setup, test_snapshot_startup, fixture_teardown);
+
+        return g_test_run ();
+}
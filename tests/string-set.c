@@ -0,0 +1,135 @@
+/* string-set.c
+ *
+ * Copyright (C) 2017 Matthias Clasen <mclasen@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <glib.h>
+#include "gr-string-set.h"
+
+static void
+test_string_set_order (void)
+{
+        g_autoptr(GrStringSet) set = NULL;
+        const char *initial[] = { "c", "b", "a", NULL };
+        const char **strv;
+
+        set = gr_string_set_new (initial);
+        g_assert_cmpuint (gr_string_set_get_length (set), ==, 3);
+
+        g_assert_true (gr_string_set_prepend (set, "d"));
+        g_assert_false (gr_string_set_prepend (set, "b"));
+
+        strv = gr_string_set_get_strv (set);
+        g_assert_cmpuint (g_strv_length ((char **)strv), ==, 4);
+        g_assert_cmpstr (strv[0], ==, "d");
+        g_assert_cmpstr (strv[1], ==, "c");
+        g_assert_cmpstr (strv[2], ==, "b");
+        g_assert_cmpstr (strv[3], ==, "a");
+
+        g_assert_true (gr_string_set_remove (set, "c"));
+        g_assert_false (gr_string_set_remove (set, "c"));
+
+        strv = gr_string_set_get_strv (set);
+        g_assert_cmpuint (g_strv_length ((char **)strv), ==, 3);
+        g_assert_cmpstr (strv[0], ==, "d");
+        g_assert_cmpstr (strv[1], ==, "b");
+        g_assert_cmpstr (strv[2], ==, "a");
+
+        gr_string_set_remove_all (set);
+        strv = gr_string_set_get_strv (set);
+        g_assert_null (strv[0]);
+}
+
+static void
+test_string_set_contains (void)
+{
+        g_autoptr(GrStringSet) set = NULL;
+        const char *initial[] = { "a", "b", "a", NULL };
+
+        set = gr_string_set_new (initial);
+        g_assert_cmpuint (gr_string_set_get_length (set), ==, 2);
+        g_assert_true (gr_string_set_contains (set, "a"));
+        g_assert_true (gr_string_set_contains (set, "b"));
+        g_assert_false (gr_string_set_contains (set, "c"));
+
+        gr_string_set_remove (set, "a");
+        g_assert_false (gr_string_set_contains (set, "a"));
+}
+
+/* An "is:favorite" search checks every recipe against the favorites.
+ * Compare this with looking the ids up in the string array that the
+ * favorites are stored as in GSettings.
+ */
+static void
+test_string_set_favorites (void)
+{
+        g_autoptr(GrStringSet) set = NULL;
+        g_autoptr(GPtrArray) favorites = NULL;
+        int n_recipes = 10000;
+        int n_favorites = 5000;
+        double strv_time;
+        double set_time;
+        int found;
+        int i;
+
+        favorites = g_ptr_array_new_with_free_func (g_free);
+        for (i = 0; i < n_favorites; i++)
+                g_ptr_array_add (favorites, g_strdup_printf ("recipe-%d", 2 * i));
+        g_ptr_array_add (favorites, NULL);
+
+        set = gr_string_set_new ((const char * const *)favorites->pdata);
+
+        g_test_timer_start ();
+        found = 0;
+        for (i = 0; i < n_recipes; i++) {
+                g_autofree char *id = g_strdup_printf ("recipe-%d", i);
+
+                if (g_strv_contains ((const char * const *)favorites->pdata, id))
+                        found++;
+        }
+        strv_time = g_test_timer_elapsed ();
+        g_assert_cmpint (found, ==, n_favorites);
+
+        g_test_timer_start ();
+        found = 0;
+        for (i = 0; i < n_recipes; i++) {
+                g_autofree char *id = g_strdup_printf ("recipe-%d", i);
+
+                if (gr_string_set_contains (set, id))
+                        found++;
+        }
+        set_time = g_test_timer_elapsed ();
+        g_assert_cmpint (found, ==, n_favorites);
+
+        g_test_message ("%d lookups in %d favorites: strv %.3f ms, set %.3f ms",
+                        n_recipes, n_favorites, strv_time * 1000, set_time * 1000);
+        g_test_minimized_result (set_time, "%.3f seconds for %d lookups", set_time, n_recipes);
+}
+
+int
+main (int argc, char *argv[])
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/string-set/order", test_string_set_order);
+        g_test_add_func ("/string-set/contains", test_string_set_contains);
+
+        if (g_test_perf ())
+                g_test_add_func ("/string-set/favorites", test_string_set_favorites);
+
+        return g_test_run ();
+}